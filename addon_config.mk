@@ -8,8 +8,9 @@ common:
 	ADDON_DEPENDENCIES = ofxDropdown ofxGui
 
 	# Feature flags needed by the addon sources
-	ADDON_DEFINES = USE_ONNX USE_SENTENCEPIECE USE_FAISS
-	ADDON_CPPFLAGS = -DUSE_ONNX -DUSE_SENTENCEPIECE -DUSE_FAISS
+	# USE_BLAS enables sgemm-based batched search; the BLAS comes with FAISS's link line
+	ADDON_DEFINES = USE_ONNX USE_SENTENCEPIECE USE_FAISS USE_BLAS
+	ADDON_CPPFLAGS = -DUSE_ONNX -DUSE_SENTENCEPIECE -DUSE_FAISS -DUSE_BLAS
 
 	# Headers
 	ADDON_INCLUDES = src src/embeddings src/store src/ui
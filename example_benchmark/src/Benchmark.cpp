@@ -0,0 +1,340 @@
+/*
+ * ofxRAG
+ *
+ * Copyright (c) 2025 Yannick Hofmann
+ * <contact@yannickhofmann.de>
+ *
+ * BSD Simplified License.
+ * For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ * WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include "Benchmark.h"
+#include "store/VectorStore_Cosine.h"
+#include "store/VectorStore_FAISS.h"
+#include "store/VectorStore_HNSW.h"
+#include "store/VectorStore_Int8.h"
+#include "store/SimdKernels.h"
+#include "store/ThreadPool.h"
+#include "store/TopK.h"
+
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <numeric>
+#include <random>
+#include <unordered_set>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace {
+// Vectors handed to addBatch at a time while building.
+const size_t BUILD_BATCH = 10000;
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void normalize(float* v, size_t dimension) {
+    float norm = std::sqrt(ofxragDotProduct(v, v, dimension));
+    if (norm > 0.0f) {
+        for (size_t i = 0; i < dimension; ++i) {
+            v[i] /= norm;
+        }
+    }
+}
+
+// Fills 'out' with count unit vectors: gaussian noise, optionally around a random center.
+void fillVectors(std::vector<float>& out, size_t count, size_t dimension, const std::vector<float>& centers, float spread, std::mt19937& rng) {
+    std::normal_distribution<float> gaussian(0.0f, 1.0f);
+    size_t clusters = dimension ? centers.size() / dimension : 0;
+    std::uniform_int_distribution<size_t> pickCluster(0, clusters ? clusters - 1 : 0);
+    // Per-coordinate sigma giving a noise vector of norm ~'spread'
+    float sigma = clusters ? spread / std::sqrt((float)dimension) : 1.0f;
+    out.resize(count * dimension);
+    for (size_t i = 0; i < count; ++i) {
+        float* v = out.data() + i * dimension;
+        const float* center = clusters ? centers.data() + pickCluster(rng) * dimension : nullptr;
+        for (size_t j = 0; j < dimension; ++j) {
+            v[j] = (center ? center[j] : 0.0f) + sigma * gaussian(rng);
+        }
+        normalize(v, dimension);
+    }
+}
+
+std::vector<Embedding> slice(const std::vector<float>& vectors, size_t dimension, size_t begin, size_t end) {
+    std::vector<Embedding> embeddings;
+    embeddings.reserve(end - begin);
+    for (size_t i = begin; i < end; ++i) {
+        embeddings.emplace_back(vectors.begin() + i * dimension, vectors.begin() + (i + 1) * dimension);
+    }
+    return embeddings;
+}
+
+double recallOf(const std::vector<std::vector<int>>& found, const std::vector<std::vector<int>>& groundTruth, size_t k) {
+    if (groundTruth.empty() || k == 0) {
+        return 0.0;
+    }
+    size_t hits = 0;
+    for (size_t q = 0; q < groundTruth.size(); ++q) {
+        std::unordered_set<int> truth(groundTruth[q].begin(), groundTruth[q].end());
+        for (int id : found[q]) {
+            hits += truth.count(id);
+        }
+    }
+    return (double)hits / (double)(groundTruth.size() * k);
+}
+
+std::vector<std::vector<int>> idsOf(const std::vector<SearchHits>& results) {
+    std::vector<std::vector<int>> ids(results.size());
+    for (size_t q = 0; q < results.size(); ++q) {
+        for (const auto& hit : results[q]) {
+            ids[q].push_back(hit.id);
+        }
+    }
+    return ids;
+}
+
+double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    size_t index = (size_t)std::ceil(p * sorted.size()) - 1;
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+} // namespace
+
+//--------------------------------------------------------------
+BenchmarkData makeUniformData(size_t count, size_t queryCount, size_t dimension, uint32_t seed) {
+    BenchmarkData data;
+    data.name = "uniform";
+    data.dimension = dimension;
+    std::mt19937 rng(seed);
+    fillVectors(data.base, count, dimension, {}, 0.0f, rng);
+    fillVectors(data.queries, queryCount, dimension, {}, 0.0f, rng);
+    return data;
+}
+
+//--------------------------------------------------------------
+BenchmarkData makeClusteredData(size_t count, size_t queryCount, size_t dimension, size_t clusters, float spread, uint32_t seed) {
+    BenchmarkData data;
+    data.name = "clustered";
+    data.dimension = dimension;
+    std::mt19937 rng(seed);
+    std::vector<float> centers;
+    fillVectors(centers, std::max<size_t>(clusters, 1), dimension, {}, 0.0f, rng);
+    fillVectors(data.base, count, dimension, centers, spread, rng);
+    fillVectors(data.queries, queryCount, dimension, centers, spread, rng);
+    return data;
+}
+
+//--------------------------------------------------------------
+BenchmarkData loadDumpData(const std::string& path, size_t queryCount, size_t dimension) {
+    BenchmarkData data;
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        ofLogError("Benchmark") << "Cannot open embedding dump " << path;
+        return data;
+    }
+
+    std::vector<float> all;
+    if (ofToLower(ofFilePath::getFileExt(path)) == "fvecs") {
+        // The dimension is stored with every vector.
+        dimension = 0;
+        int32_t d;
+        while (file.read(reinterpret_cast<char*>(&d), sizeof(d))) {
+            if (d <= 0 || (dimension && (size_t)d != dimension)) {
+                ofLogError("Benchmark") << path << " mixes vector dimensions or is not an .fvecs file.";
+                return data;
+            }
+            dimension = (size_t)d;
+            size_t offset = all.size();
+            all.resize(offset + dimension);
+            if (!file.read(reinterpret_cast<char*>(all.data() + offset), dimension * sizeof(float))) {
+                all.resize(offset); // truncated last vector
+                break;
+            }
+        }
+    } else {
+        if (dimension == 0) {
+            ofLogError("Benchmark") << "Raw float32 dumps need the 'dimension' setting.";
+            return data;
+        }
+        file.seekg(0, std::ios::end);
+        size_t rows = (size_t)file.tellg() / (dimension * sizeof(float));
+        file.seekg(0);
+        all.resize(rows * dimension);
+        file.read(reinterpret_cast<char*>(all.data()), all.size() * sizeof(float));
+    }
+
+    size_t rows = dimension ? all.size() / dimension : 0;
+    if (rows <= queryCount) {
+        ofLogError("Benchmark") << path << " holds " << rows << " vectors, not enough for " << queryCount << " queries.";
+        return data;
+    }
+    for (size_t i = 0; i < rows; ++i) {
+        normalize(all.data() + i * dimension, dimension);
+    }
+    size_t baseCount = rows - queryCount;
+    data.name = ofFilePath::getFileName(path);
+    data.dimension = dimension;
+    data.queries.assign(all.begin() + baseCount * dimension, all.end());
+    all.resize(baseCount * dimension);
+    data.base = std::move(all);
+    return data;
+}
+
+//--------------------------------------------------------------
+std::vector<std::vector<int>> computeGroundTruth(const BenchmarkData& data, size_t k, size_t threads) {
+    std::vector<std::vector<int>> truth(data.queryCount());
+    auto scan = [&](size_t q) {
+        const float* query = data.queries.data() + q * data.dimension;
+        TopKSelector selector(k);
+        for (size_t i = 0; i < data.count(); ++i) {
+            selector.push(ofxragDotProduct(query, data.base.data() + i * data.dimension, data.dimension), (int64_t)i);
+        }
+        for (const auto& best : selector.take()) {
+            truth[q].push_back((int)best.row);
+        }
+    };
+    size_t workers = ThreadPool::resolveThreadCount(threads);
+    if (workers <= 1) {
+        for (size_t q = 0; q < data.queryCount(); ++q) {
+            scan(q);
+        }
+        return truth;
+    }
+    ThreadPool pool(workers - 1);
+    pool.parallelFor(data.queryCount(), [&](size_t q, size_t) {
+        scan(q);
+    });
+    return truth;
+}
+
+//--------------------------------------------------------------
+std::shared_ptr<VectorStoreBase> createBenchmarkStore(const std::string& spec, size_t dimension) {
+    if (spec == "Cosine") {
+        return std::make_shared<VectorStore_Cosine>();
+    }
+    if (spec == "Int8") {
+        return std::make_shared<VectorStore_Int8>();
+    }
+    if (spec == "HNSW") {
+        return std::make_shared<VectorStore_HNSW>();
+    }
+    if (spec.rfind("FAISS", 0) == 0) {
+        std::string factory = spec.size() > 6 ? spec.substr(6) : "Flat";
+        return std::make_shared<VectorStore_FAISS>((int)dimension, factory);
+    }
+    ofLogError("Benchmark") << "Unknown store '" << spec << "'.";
+    return nullptr;
+}
+
+//--------------------------------------------------------------
+void setBenchmarkThreads(VectorStoreBase& store, size_t threads) {
+    if (auto* cosine = dynamic_cast<VectorStore_Cosine*>(&store)) {
+        cosine->setNumThreads(threads);
+    } else if (auto* int8 = dynamic_cast<VectorStore_Int8*>(&store)) {
+        int8->setNumThreads(threads);
+    } else if (auto* hnsw = dynamic_cast<VectorStore_HNSW*>(&store)) {
+        hnsw->setNumThreads(threads);
+    } else if (dynamic_cast<VectorStore_FAISS*>(&store)) {
+#ifdef _OPENMP
+        omp_set_num_threads((int)ThreadPool::resolveThreadCount(threads));
+#endif
+    }
+}
+
+//--------------------------------------------------------------
+ofJson runStoreBenchmark(const std::string& spec, const BenchmarkData& data, const std::vector<std::vector<int>>& groundTruth,
+                         size_t k, const std::vector<size_t>& threadCounts, const std::string& scratchDirectory) {
+    ofJson result;
+    result["store"] = spec;
+    std::shared_ptr<VectorStoreBase> store = createBenchmarkStore(spec, data.dimension);
+    if (!store) {
+        result["error"] = "unknown store";
+        return result;
+    }
+    setBenchmarkThreads(*store, 0);
+    ofLogNotice("Benchmark") << "--- " << spec << " ---";
+
+    // Build: ids are the row numbers, so hits compare directly with the ground truth.
+    auto start = std::chrono::steady_clock::now();
+    for (size_t begin = 0; begin < data.count(); begin += BUILD_BATCH) {
+        size_t end = std::min(data.count(), begin + BUILD_BATCH);
+        std::vector<VectorMetadata> metadata;
+        std::vector<std::string> contents;
+        for (size_t i = begin; i < end; ++i) {
+            metadata.push_back({(int)i, "benchmark", "vector"});
+            contents.push_back(ofToString(i));
+        }
+        store->addBatch(slice(data.base, data.dimension, begin, end), metadata, contents);
+    }
+    if (auto* faiss = dynamic_cast<VectorStore_FAISS*>(store.get())) {
+        if (!faiss->isTrained()) {
+            faiss->train();
+        }
+    }
+    result["build_seconds"] = secondsSince(start);
+    result["size"] = store->size();
+
+    // Single-query latency on one thread, the interactive case.
+    std::vector<Embedding> queries = slice(data.queries, data.dimension, 0, data.queryCount());
+    setBenchmarkThreads(*store, 1);
+    std::vector<double> latencies;
+    std::vector<std::vector<int>> found(queries.size());
+    for (size_t q = 0; q < queries.size(); ++q) {
+        auto queryStart = std::chrono::steady_clock::now();
+        SearchHits hits = store->searchHits(queries[q], (int)k);
+        latencies.push_back(secondsSince(queryStart) * 1000.0);
+        for (const auto& hit : hits) {
+            found[q].push_back(hit.id);
+        }
+    }
+    double recall = recallOf(found, groundTruth, k);
+    std::vector<double> sorted = latencies;
+    std::sort(sorted.begin(), sorted.end());
+    double mean = sorted.empty() ? 0.0 : std::accumulate(sorted.begin(), sorted.end(), 0.0) / sorted.size();
+    result["recall_at_k"] = recall;
+    result["latency_ms"] = {{"mean", mean}, {"p50", percentile(sorted, 0.50)}, {"p95", percentile(sorted, 0.95)}, {"p99", percentile(sorted, 0.99)}};
+
+    // Batched throughput per thread count.
+    result["qps"] = ofJson::array();
+    for (size_t threads : threadCounts) {
+        setBenchmarkThreads(*store, threads);
+        auto batchStart = std::chrono::steady_clock::now();
+        std::vector<SearchHits> batch = store->searchHitsBatch(queries, (int)k);
+        double seconds = secondsSince(batchStart);
+        result["qps"].push_back({{"threads", threads}, {"qps", seconds > 0.0 ? queries.size() / seconds : 0.0}, {"recall_at_k", recallOf(idsOf(batch), groundTruth, k)}});
+    }
+    setBenchmarkThreads(*store, 0);
+
+    // Persistence: a fresh store loaded from the file must answer like the original.
+    std::string path = scratchDirectory + ofToString(std::hash<std::string>()(spec)) + ".bin";
+    start = std::chrono::steady_clock::now();
+    bool saved = store->save(path);
+    result["save_seconds"] = secondsSince(start);
+    if (saved) {
+        uint64_t bytes = ofFile(path, ofFile::Reference).getSize();
+        result["file_bytes"] = bytes;
+        result["bytes_per_vector"] = data.count() ? (double)bytes / data.count() : 0.0;
+
+        std::shared_ptr<VectorStoreBase> loaded = createBenchmarkStore(spec, data.dimension);
+        start = std::chrono::steady_clock::now();
+        bool ok = loaded->load(path);
+        result["load_seconds"] = secondsSince(start);
+        if (ok) {
+            result["loaded_recall_at_k"] = recallOf(idsOf(loaded->searchHitsBatch(queries, (int)k)), groundTruth, k);
+        }
+        loaded.reset();
+        ofFile::removeFile(path, false);
+    } else {
+        result["error"] = "save failed";
+    }
+
+    ofLogNotice("Benchmark") << spec << ": recall@" << k << " " << ofToString(recall, 4) << ", p50 " << ofToString(percentile(sorted, 0.50), 3)
+                             << " ms, p99 " << ofToString(percentile(sorted, 0.99), 3) << " ms, build " << ofToString(result["build_seconds"].get<double>(), 2) << " s";
+    return result;
+}
@@ -0,0 +1,52 @@
+/*
+ * ofxRAG
+ *
+ * Copyright (c) 2025 Yannick Hofmann
+ * <contact@yannickhofmann.de>
+ *
+ * BSD Simplified License.
+ * For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ * WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#include "ofMain.h"
+#include "store/VectorStoreBase.h"
+
+// Vectors to index plus held-out queries, all scaled to unit length so that cosine
+// similarity and L2 distance rank neighbors the same way for every store.
+struct BenchmarkData {
+    std::string name;
+    size_t dimension = 0;
+    std::vector<float> base;    // count x dimension
+    std::vector<float> queries; // queryCount x dimension
+
+    size_t count() const { return dimension ? base.size() / dimension : 0; }
+    size_t queryCount() const { return dimension ? queries.size() / dimension : 0; }
+};
+
+// --- Datasets ---
+// Points spread evenly over the unit sphere; the hardest case for approximate indexes.
+BenchmarkData makeUniformData(size_t count, size_t queryCount, size_t dimension, uint32_t seed);
+// Points scattered around 'clusters' random centers, closer to real embeddings.
+// 'spread' is the noise norm relative to the unit-length centers.
+BenchmarkData makeClusteredData(size_t count, size_t queryCount, size_t dimension, size_t clusters, float spread, uint32_t seed);
+// Embeddings dumped from a real corpus: '.fvecs' (int32 dimension before every
+// vector) or raw float32 rows of 'dimension' values. The last 'queryCount'
+// vectors become the queries. Returns an empty set on error.
+BenchmarkData loadDumpData(const std::string& path, size_t queryCount, size_t dimension);
+
+// Exact top-k ids per query by brute force, the reference for recall.
+std::vector<std::vector<int>> computeGroundTruth(const BenchmarkData& data, size_t k, size_t threads);
+
+// --- Stores ---
+// "Cosine", "Int8", "HNSW" or "FAISS:<index factory>", e.g. "FAISS:IVF1024,Flat".
+std::shared_ptr<VectorStoreBase> createBenchmarkStore(const std::string& spec, size_t dimension);
+// Search threads of the store (its own pool, or OpenMP for FAISS).
+void setBenchmarkThreads(VectorStoreBase& store, size_t threads);
+
+// Builds the store from the data, then measures recall@k, single-query latency,
+// batched throughput for each thread count, and save/load time and size.
+ofJson runStoreBenchmark(const std::string& spec, const BenchmarkData& data, const std::vector<std::vector<int>>& groundTruth,
+                         size_t k, const std::vector<size_t>& threadCounts, const std::string& scratchDirectory);
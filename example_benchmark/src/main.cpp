@@ -0,0 +1,13 @@
+#include "ofMain.h"
+#include "ofAppNoWindow.h"
+#include "ofApp.h"
+
+//========================================================================
+int main(int argc, char* argv[]) {
+    // Headless: the benchmark runs in setup() and the app exits when it is done.
+    ofAppNoWindow window;
+    ofSetupOpenGL(&window, 0, 0, OF_WINDOW);
+
+    // Optional argument: settings file (default data/benchmark_settings.json)
+    return ofRunApp(new ofApp(argc > 1 ? argv[1] : "benchmark_settings.json"));
+}
@@ -0,0 +1,86 @@
+/*
+ * ofxRAG
+ *
+ * Copyright (c) 2025 Yannick Hofmann
+ * <contact@yannickhofmann.de>
+ *
+ * BSD Simplified License.
+ * For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ * WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include "ofApp.h"
+#include "store/SimdKernels.h"
+
+#include <chrono>
+#include <thread>
+
+//--------------------------------------------------------------
+ofApp::ofApp(const std::string& settingsFile) : settingsFile(settingsFile) {}
+
+//--------------------------------------------------------------
+void ofApp::setup() {
+    ofSetLogLevel(OF_LOG_NOTICE);
+    bool ok = runBenchmark();
+    ofExit(ok ? 0 : 1);
+}
+
+//--------------------------------------------------------------
+bool ofApp::runBenchmark() {
+    // Every setting is optional; missing ones fall back to these defaults.
+    ofJson settings = ofFile::doesFileExist(settingsFile) ? ofLoadJson(settingsFile) : ofJson::object();
+    std::string dataset = settings.value("dataset", "clustered");
+    size_t count = settings.value("count", 100000);
+    size_t dimension = settings.value("dimension", 768);
+    size_t queryCount = settings.value("queries", 1000);
+    size_t clusters = settings.value("clusters", 100);
+    float spread = settings.value("spread", 0.6f);
+    uint32_t seed = settings.value("seed", 42);
+    size_t k = settings.value("k", 10);
+    std::vector<std::string> stores = settings.value("stores", std::vector<std::string>{"Cosine", "Int8", "HNSW", "FAISS:Flat"});
+    std::vector<size_t> threads = settings.value("threads", std::vector<size_t>{1, 2, 4, 8});
+    std::string output = settings.value("output", "benchmark_results.json");
+
+    ofLogNotice("Benchmark") << "Preparing dataset '" << dataset << "'...";
+    BenchmarkData data;
+    if (dataset == "uniform") {
+        data = makeUniformData(count, queryCount, dimension, seed);
+    } else if (dataset == "clustered") {
+        data = makeClusteredData(count, queryCount, dimension, clusters, spread, seed);
+    } else {
+        data = loadDumpData(ofToDataPath(dataset, true), queryCount, dimension);
+    }
+    if (data.count() == 0 || data.queryCount() == 0) {
+        ofLogError("Benchmark") << "No data to benchmark.";
+        return false;
+    }
+    ofLogNotice("Benchmark") << data.count() << " vectors, " << data.queryCount() << " queries, dimension " << data.dimension;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::vector<int>> groundTruth = computeGroundTruth(data, k, 0);
+    ofLogNotice("Benchmark") << "Ground truth in " << ofToString(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), 2) << " s";
+
+    std::string scratchDirectory = ofToDataPath("benchmark_scratch/", true);
+    ofDirectory::createDirectory(scratchDirectory, false, true);
+
+    ofJson report;
+    report["version"] = 1;
+    report["timestamp"] = ofGetTimestampString("%Y-%m-%dT%H:%M:%S");
+    report["hardware_threads"] = std::thread::hardware_concurrency();
+    report["dot_kernel"] = ofxragSimdKernelName();
+    report["int8_kernel"] = ofxragInt8KernelName();
+    report["dataset"] = {{"name", data.name}, {"count", data.count()}, {"queries", data.queryCount()}, {"dimension", data.dimension}};
+    report["k"] = k;
+    report["results"] = ofJson::array();
+    for (const auto& store : stores) {
+        report["results"].push_back(runStoreBenchmark(store, data, groundTruth, k, threads, scratchDirectory));
+    }
+    ofDirectory::removeDirectory(scratchDirectory, true, false);
+
+    if (!ofSavePrettyJson(output, report)) {
+        ofLogError("Benchmark") << "Failed to write " << output;
+        return false;
+    }
+    ofLogNotice("Benchmark") << "Results written to " << ofToDataPath(output, true);
+    return true;
+}
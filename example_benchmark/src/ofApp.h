@@ -0,0 +1,30 @@
+/*
+ * ofxRAG
+ *
+ * Copyright (c) 2025 Yannick Hofmann
+ * <contact@yannickhofmann.de>
+ *
+ * BSD Simplified License.
+ * For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ * WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#include "ofMain.h"
+#include "Benchmark.h"
+
+// Headless recall/latency benchmark of the vector stores. Reads its settings from a
+// JSON file in the data folder, writes the results as JSON next to it and exits.
+class ofApp : public ofBaseApp {
+public:
+    explicit ofApp(const std::string& settingsFile);
+
+    void setup();
+
+private:
+    // Returns false if the benchmark could not run.
+    bool runBenchmark();
+
+    std::string settingsFile;
+};
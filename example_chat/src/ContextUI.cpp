@@ -17,6 +17,11 @@ void ContextUI::setup(const std::string& fontPath, int fontSize) {
 
 void ContextUI::update(const std::vector<std::string>& sources) {
     this->sources = sources;
+    // Forget ticks of sources that are gone
+    std::set<std::string> current(sources.begin(), sources.end());
+    for (auto it = unticked.begin(); it != unticked.end();) {
+        it = current.count(*it) ? std::next(it) : unticked.erase(it);
+    }
 }
 
 void ContextUI::draw(const ofRectangle& viewport) {
@@ -35,7 +40,7 @@ void ContextUI::draw(const ofRectangle& viewport) {
 
     // Draw the list of sources below the title
     float listStartY = viewport.y + 20 + titleBounds.height + 10;
-    ofRectangle listViewport(viewport.x, listStartY, viewport.width, viewport.height - (listStartY - viewport.y));
+    listViewport.set(viewport.x, listStartY, viewport.width, viewport.height - (listStartY - viewport.y));
 
     float contentHeight = 0;
     for (const auto& source : sources) {
@@ -48,12 +53,28 @@ void ContextUI::draw(const ofRectangle& viewport) {
     scrollbar.draw();
 
     float textY = listViewport.y - scrollbar.getScrollY();
+    rowBounds.clear();
 
+    // Each source gets a tick box; only ticked sources are searched
     for (const auto& source : sources) {
         std::string displayText = ofFilePath::getFileName(source);
         ofRectangle bounds = font.getStringBoundingBox(displayText, 0, 0);
-        ofSetColor(255);
-        font.drawString(displayText, listViewport.x + 10, textY + bounds.height);
+        float boxSize = std::max(8.0f, bounds.height - 2);
+        ofRectangle box(listViewport.x + 10, textY + (bounds.height - boxSize) / 2 + 1, boxSize, boxSize);
+        bool ticked = !unticked.count(source);
+
+        ofSetColor(150);
+        ofNoFill();
+        ofDrawRectangle(box);
+        if (ticked) {
+            ofFill();
+            ofDrawRectangle(box.x + 2, box.y + 2, box.width - 4, box.height - 4);
+        }
+        ofFill();
+
+        ofSetColor(ticked ? 255 : 120);
+        font.drawString(displayText, box.getRight() + 8, textY + bounds.height);
+        rowBounds.emplace_back(listViewport.x, textY - 5, listViewport.width - 20, bounds.height + 10);
         textY += bounds.height + 10;
     }
 
@@ -90,6 +111,17 @@ void ContextUI::mouseScrolled(int x, int y, float scrollX, float scrollY) {
 void ContextUI::mousePressed(int x, int y, int button) {
     if (viewport.inside(x, y)) {
         scrollbar.mousePressed(x, y);
+        if (!listViewport.inside(x, y)) {
+            return;
+        }
+        for (size_t i = 0; i < rowBounds.size() && i < sources.size(); ++i) {
+            if (rowBounds[i].inside(x, y)) {
+                if (!unticked.erase(sources[i])) {
+                    unticked.insert(sources[i]);
+                }
+                break;
+            }
+        }
     }
 }
 
@@ -108,3 +140,17 @@ void ContextUI::setViewport(const ofRectangle& viewport) {
 bool ContextUI::isInside(int x, int y) const {
     return viewport.inside(x, y);
 }
+
+std::set<std::string> ContextUI::getSelectedSources() const {
+    std::set<std::string> selected;
+    for (const auto& source : sources) {
+        if (!unticked.count(source)) {
+            selected.insert(source);
+        }
+    }
+    return selected;
+}
+
+bool ContextUI::allSourcesSelected() const {
+    return unticked.empty();
+}
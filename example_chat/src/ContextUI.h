@@ -28,10 +28,18 @@ public:
     void setViewport(const ofRectangle& viewport);
     bool isInside(int x, int y) const;
 
+    // Sources ticked in the list; newly added sources start ticked.
+    std::set<std::string> getSelectedSources() const;
+    bool allSourcesSelected() const;
+
 private:
     ofTrueTypeFont font;
     std::vector<std::string> sources;
+    std::set<std::string> unticked;
     ofRectangle viewport;
+    ofRectangle listViewport;
+    // Clickable rows of the last draw, one per source
+    std::vector<ofRectangle> rowBounds;
 
     Scrollbar scrollbar;
 
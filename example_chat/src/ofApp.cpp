@@ -14,6 +14,8 @@
 #include "ofxPoDoFo.h"
 #include "store/VectorStore_Cosine.h" // Specific vector store for Cosine similarity
 #include "store/VectorStore_FAISS.h" // Specific vector store for FAISS
+#include "store/VectorStore_Concurrent.h" // Lets searches run while files are ingested
+#include "store/VectorStore_Logged.h" // Persists each change as it happens
 
 // --- HELPER FUNCTIONS ---
 
@@ -41,7 +43,17 @@ void ofApp::setup() {
     // Initialize ofxRAG and set the T5 Text Embedder
     rag.setup();
     rag.setTextEmbedder(std::make_shared<TextEmbedding_T5>());
-    rag.setVectorStore(std::make_shared<VectorStore_FAISS>(768)); // Initialize with FAISS store
+    // FAISS store wrapped so that replies can search it while dropped files are ingested,
+    // and logged so that every dropped file is kept on disk as soon as it is added
+    rag.setVectorStore(std::make_shared<VectorStore_Logged>(std::make_shared<VectorStore_Concurrent>([] {
+        return std::make_shared<VectorStore_FAISS>(768);
+    })));
+    std::string storePath = ofToDataPath("rag_store.faiss", true);
+    if (!rag.loadStore(storePath)) {
+        rag.saveStore(storePath); // first run: start an empty snapshot and its log
+    }
+    mContextUI.update(rag.getContextSources());
+    ingestThread = std::thread(&ofApp::ingestLoop, this);
 
     // Add some sample text to the RAG store
     
@@ -254,13 +266,20 @@ void ofApp::startReplyGeneration() {
     }
 
     std::string ragContext = "";
-    if (!latestUserQuery.empty()) {
-        std::vector<SearchResult> results = rag.searchText(latestUserQuery, 5); // Increased top_k from 3 to 5
+    // Only the files ticked in the knowledge base list are searched
+    SearchFilter filter;
+    if (!mContextUI.allSourcesSelected()) {
+        filter.sources = mContextUI.getSelectedSources();
+    }
+    bool anySelected = filter.empty() || !filter.sources.empty();
+    if (!latestUserQuery.empty() && anySelected) {
+        // The hits view the stored chunks; their text is copied once, straight into the prompt.
+        SearchHits results = rag.searchTextHits(latestUserQuery, 5, filter); // Increased top_k from 3 to 5
         if (!results.empty()) {
             ragContext += "[RAG CONTEXT]\n";
             for (const auto& result : results) {
-                ragContext += "Source: " + result.metadata.source + "\n";
-                ragContext += "Text: " + result.content + "\n\n";
+                ragContext.append("Source: ").append(result.source).append("\n");
+                ragContext.append("Text: ").append(result.content).append("\n\n");
             }
         }
     }
@@ -309,6 +328,11 @@ void ofApp::startReplyGeneration() {
 
 //--------------------------------------------------------------
 void ofApp::update() {
+    // Refresh the source list once the ingestion thread has added a file
+    if (sourcesChanged.exchange(false)) {
+        mContextUI.update(rag.getContextSources());
+    }
+
     if (!ready) return; // Don't do anything if the model isn't loaded
 
     // State machine for handling model generation (replying vs. summarizing)
@@ -474,7 +498,31 @@ void ofApp::dragEvent(ofDragInfo dragInfo){
         return; 
     }
 
-    for(auto& file : dragInfo.files) {
+    // Reading, chunking and embedding happen on the ingestion thread, so the UI and
+    // replies keep running while large files are added.
+    {
+        std::lock_guard<std::mutex> lock(ingestMutex);
+        for (auto& file : dragInfo.files) {
+            ingestQueue.push_back(file);
+        }
+    }
+    ingestCondition.notify_one();
+}
+
+//--------------------------------------------------------------
+void ofApp::ingestLoop() {
+    while (true) {
+        std::string file;
+        {
+            std::unique_lock<std::mutex> lock(ingestMutex);
+            ingestCondition.wait(lock, [this] { return ingestStopping || !ingestQueue.empty(); });
+            if (ingestStopping) {
+                return;
+            }
+            file = ingestQueue.front();
+            ingestQueue.pop_front();
+        }
+
         std::string content = "";
         std::string fileExtension = ofToLower(ofFilePath::getFileExt(file));
 
@@ -495,8 +543,9 @@ void ofApp::dragEvent(ofDragInfo dragInfo){
         }
 
         if(!content.empty()) {
+            rag.removeSource(file); // re-dropping a file replaces its old chunks
             rag.addText(content, file);
-            mContextUI.update(rag.getContextSources());
+            sourcesChanged = true;
             ofLogNotice("ofApp") << "Dragged and added: " << file << ". RAG store size: " << rag.getStoreSize();
         } else {
             ofLogWarning("ofApp") << "Dragged file is empty or could not be processed: " << file;
@@ -504,6 +553,19 @@ void ofApp::dragEvent(ofDragInfo dragInfo){
     }
 }
 
+//--------------------------------------------------------------
+void ofApp::exit() {
+    // Files still queued are dropped; one being embedded is finished first.
+    {
+        std::lock_guard<std::mutex> lock(ingestMutex);
+        ingestStopping = true;
+    }
+    ingestCondition.notify_one();
+    if (ingestThread.joinable()) {
+        ingestThread.join();
+    }
+}
+
 
 
 //--------------------------------------------------------------
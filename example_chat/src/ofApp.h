@@ -23,7 +23,12 @@
 #include "AppTypes.h"
 #include "TemplateManager.h"
 #include "ContextUI.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <map>
+#include <mutex>
+#include <thread>
 
 // class ofApp
 // The main application class that orchestrates the entire chat application.
@@ -40,6 +45,9 @@ public:
     
     // Called repeatedly to draw the application's visuals.
     void draw();
+
+    // Called once on shutdown; stops the ingestion thread.
+    void exit();
     
     void keyPressed(ofKeyEventArgs &args);
     void mouseScrolled(int x, int y, float scrollX, float scrollY);
@@ -77,6 +85,15 @@ private:
 
     // --- RAG ---
     ofxRAG rag; // RAG instance
+
+    // --- Background Ingestion ---
+    void ingestLoop(); // Reads and embeds queued files until exit() is called.
+    std::thread ingestThread; // Thread running ingestLoop().
+    std::deque<std::string> ingestQueue; // Dropped files waiting to be added to the RAG store.
+    std::mutex ingestMutex; // Guards ingestQueue and ingestStopping.
+    std::condition_variable ingestCondition; // Wakes the ingestion thread.
+    bool ingestStopping = false; // Set by exit() to end ingestLoop().
+    std::atomic<bool> sourcesChanged{false}; // Set after a file is added; update() refreshes the context UI.
     // --- Llama Engine ---
     ofxLlamaCpp llama; // The core Llama language model object.
     bool ready = false; // Flag indicating if the model is loaded and ready.
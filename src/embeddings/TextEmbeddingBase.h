@@ -35,6 +35,19 @@ public:
         return embeddings;
     }
 
+    // Like embedBatch, but also reports for each text whether its embedding is real
+    // (true) or a placeholder returned after a failure. Callers that keep embeddings,
+    // like caches, should only keep valid ones. The default marks every result as
+    // valid exactly when isReady().
+    virtual std::vector<Embedding> embedBatchChecked(const std::vector<std::string>& texts, std::vector<bool>& valid) {
+        std::vector<Embedding> embeddings = embedBatch(texts);
+        valid.assign(embeddings.size(), isReady());
+        return embeddings;
+    }
+
+    // Whether the embedder can produce real embeddings, e.g. its model loaded.
+    virtual bool isReady() const { return true; }
+
     // Returns the name of the model/implementation.
     virtual std::string getName() const = 0;
     
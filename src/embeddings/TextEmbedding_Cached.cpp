@@ -0,0 +1,418 @@
+/*
+ * ofxRAG
+ *
+ * Copyright (c) 2025 Yannick Hofmann
+ * <contact@yannickhofmann.de>
+ *
+ * BSD Simplified License.
+ * For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ * WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include "TextEmbedding_Cached.h"
+#include "store/BinaryIO.h"
+
+#include <cctype>
+#include <cstring>
+
+namespace {
+// File layout: header, then fixed-size records of
+// key (16 bytes) | checksum of key and vector (8 bytes) | dimension floats.
+const char CACHE_MAGIC[8] = {'O', 'X', 'R', 'A', 'G', 'E', 'C', '1'};
+const uint32_t CACHE_VERSION = 1;
+const size_t HEADER_SIZE = sizeof(CACHE_MAGIC) + 2 * sizeof(uint32_t); // magic, version, dimension
+const size_t RECORD_PREFIX_SIZE = 2 * sizeof(uint64_t) + sizeof(uint64_t);
+
+// Per-entry bookkeeping of the memory tier beyond the vector itself (list and map nodes).
+const size_t ENTRY_OVERHEAD = 96;
+
+// Prepended to the key material for the second half of the key, so the two
+// 64-bit halves come from differently seeded hashes.
+const uint8_t KEY_SALT[32] = {
+    0x9e, 0x37, 0x79, 0xb9, 0x7f, 0x4a, 0x7c, 0x15, 0xf3, 0x9c, 0xc0, 0x60, 0x5c, 0xed, 0xc8, 0x34,
+    0x10, 0x82, 0x27, 0x6b, 0xf3, 0xa2, 0x72, 0x37, 0x0b, 0x3d, 0x2a, 0x4c, 0x5e, 0x81, 0x6f, 0xd2};
+
+uint64_t recordChecksum(const void* key, const float* values, size_t dimension) {
+    Checksum checksum;
+    checksum.update(key, 2 * sizeof(uint64_t));
+    checksum.update(values, dimension * sizeof(float));
+    return checksum.value();
+}
+} // namespace
+
+//--------------------------------------------------------------
+TextEmbedding_Cached::TextEmbedding_Cached(std::shared_ptr<TextEmbeddingBase> embedder, size_t memoryBudget)
+    : embedder(std::move(embedder)), memoryBudget(memoryBudget) {
+    modelId = this->embedder->getName() + "/" + ofToString(this->embedder->getDimension());
+}
+
+//--------------------------------------------------------------
+TextEmbedding_Cached::~TextEmbedding_Cached() {
+    closeDiskCache();
+}
+
+//--------------------------------------------------------------
+Embedding TextEmbedding_Cached::embed(const std::string& text) {
+    return embedBatch({text})[0];
+}
+
+//--------------------------------------------------------------
+std::vector<Embedding> TextEmbedding_Cached::embedBatch(const std::vector<std::string>& texts) {
+    std::vector<bool> valid;
+    return embedBatchChecked(texts, valid);
+}
+
+//--------------------------------------------------------------
+std::vector<Embedding> TextEmbedding_Cached::embedBatchChecked(const std::vector<std::string>& texts, std::vector<bool>& valid) {
+    valid.assign(texts.size(), true); // hits are valid; misses take the embedder's verdict
+    std::vector<Embedding> embeddings(texts.size());
+    std::vector<Key> keys(texts.size());
+    for (size_t i = 0; i < texts.size(); ++i) {
+        keys[i] = makeKey(texts[i]);
+    }
+
+    // Misses, each distinct text once; missOf[i] is text i's position among them
+    const size_t HIT = (size_t)-1;
+    std::vector<size_t> missOf(texts.size(), HIT);
+    std::vector<std::string> missTexts;
+    std::vector<Key> missKeys;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::unordered_map<Key, size_t, KeyHash> pending;
+        for (size_t i = 0; i < texts.size(); ++i) {
+            if (lookupLocked(keys[i], embeddings[i])) {
+                continue;
+            }
+            ++misses;
+            auto inserted = pending.emplace(keys[i], missTexts.size());
+            if (inserted.second) {
+                missTexts.push_back(texts[i]);
+                missKeys.push_back(keys[i]);
+            }
+            missOf[i] = inserted.first->second;
+        }
+    }
+    if (missTexts.empty()) {
+        return embeddings;
+    }
+
+    std::vector<bool> computedValid;
+    std::vector<Embedding> computed = embedder->embedBatchChecked(missTexts, computedValid);
+    if (computed.size() != missTexts.size()) {
+        ofLogError("TextEmbedding_Cached") << "Embedder returned " << computed.size() << " embeddings for " << missTexts.size() << " texts.";
+        computed.resize(missTexts.size());
+    }
+    computedValid.resize(missTexts.size(), false);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t dimension = getDimension();
+        std::vector<Key> storeKeys;
+        std::vector<const Embedding*> storeEmbeddings;
+        for (size_t j = 0; j < computed.size(); ++j) {
+            // Never cache a failed result or a placeholder
+            if (!computedValid[j] || computed[j].size() != dimension) {
+                continue;
+            }
+            insertMemoryLocked(missKeys[j], computed[j]);
+            if (!diskIndex.count(missKeys[j])) {
+                storeKeys.push_back(missKeys[j]);
+                storeEmbeddings.push_back(&computed[j]);
+            }
+        }
+        appendDiskLocked(storeKeys, storeEmbeddings);
+    }
+
+    for (size_t i = 0; i < texts.size(); ++i) {
+        if (missOf[i] != HIT) {
+            embeddings[i] = computed[missOf[i]];
+            valid[i] = computedValid[missOf[i]];
+        }
+    }
+    return embeddings;
+}
+
+//--------------------------------------------------------------
+bool TextEmbedding_Cached::openDiskCache(const std::string& path) {
+    closeDiskCache();
+    std::lock_guard<std::mutex> lock(mutex);
+
+    uint32_t dimension = (uint32_t)getDimension();
+    size_t recordSize = RECORD_PREFIX_SIZE + dimension * sizeof(float);
+
+    // Index the records already on disk; they are only verified when read
+    uint64_t size = 0;
+    if (ofFile::doesFileExist(path, false) && diskMapping.open(path)) {
+        size = diskMapping.size();
+        if (size > 0) {
+            const uint32_t* header = diskMapping.at<uint32_t>(sizeof(CACHE_MAGIC), 2);
+            if (size < HEADER_SIZE || std::memcmp(diskMapping.data(), CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0) {
+                ofLogError("TextEmbedding_Cached") << "Not an embedding cache: " << path;
+                diskMapping.close();
+                return false;
+            }
+            if (!header || header[0] != CACHE_VERSION || header[1] != dimension) {
+                ofLogError("TextEmbedding_Cached") << "Embedding cache " << path << " has dimension " << (header ? header[1] : 0)
+                                                   << ", the embedder " << dimension << ".";
+                diskMapping.close();
+                return false;
+            }
+            for (uint64_t offset = HEADER_SIZE; offset + recordSize <= size; offset += recordSize) {
+                Key key;
+                std::memcpy(&key, diskMapping.data() + offset, sizeof(Key));
+                diskIndex[key] = offset; // a later record for the same key wins
+            }
+        }
+    }
+
+    diskFile = std::fopen(path.c_str(), "ab");
+    if (!diskFile) {
+        ofLogError("TextEmbedding_Cached") << "Could not open embedding cache: " << path;
+        diskMapping.close();
+        diskIndex.clear();
+        return false;
+    }
+    if (size == 0) {
+        uint32_t header[2] = {CACHE_VERSION, dimension};
+        std::fwrite(CACHE_MAGIC, 1, sizeof(CACHE_MAGIC), diskFile);
+        std::fwrite(header, 1, sizeof(header), diskFile);
+        size = HEADER_SIZE;
+    } else if ((size - HEADER_SIZE) % recordSize != 0) {
+        // A record torn by a crash: pad it to full size so later records stay aligned.
+        // Its checksum no longer matches, so it is never served.
+        size_t padding = recordSize - (size_t)((size - HEADER_SIZE) % recordSize);
+        std::vector<uint8_t> zeros(padding, 0);
+        std::fwrite(zeros.data(), 1, zeros.size(), diskFile);
+        size += padding;
+        ofLogWarning("TextEmbedding_Cached") << "Embedding cache " << path << " ended in a partial record.";
+    }
+    if (std::fflush(diskFile) != 0) {
+        ofLogError("TextEmbedding_Cached") << "Could not write embedding cache: " << path;
+    }
+    diskPath = path;
+    diskSize = size;
+    ofLogNotice("TextEmbedding_Cached") << "Opened embedding cache with " << diskIndex.size() << " entries: " << path;
+    return true;
+}
+
+//--------------------------------------------------------------
+void TextEmbedding_Cached::closeDiskCache() {
+    std::lock_guard<std::mutex> lock(mutex);
+    closeDiskLocked();
+}
+
+//--------------------------------------------------------------
+void TextEmbedding_Cached::closeDiskLocked() {
+    if (diskFile) {
+        std::fclose(diskFile);
+        diskFile = nullptr;
+    }
+    diskMapping.close();
+    diskIndex.clear();
+    diskPath.clear();
+    diskSize = 0;
+}
+
+//--------------------------------------------------------------
+bool TextEmbedding_Cached::isDiskCacheOpen() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return diskFile != nullptr;
+}
+
+//--------------------------------------------------------------
+void TextEmbedding_Cached::setMemoryBudget(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    memoryBudget = bytes;
+    evictLocked();
+}
+
+//--------------------------------------------------------------
+size_t TextEmbedding_Cached::getMemoryBudget() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return memoryBudget;
+}
+
+//--------------------------------------------------------------
+void TextEmbedding_Cached::clearMemory() {
+    std::lock_guard<std::mutex> lock(mutex);
+    lru.clear();
+    memoryIndex.clear();
+    memoryBytes = 0;
+}
+
+//--------------------------------------------------------------
+void TextEmbedding_Cached::setModelId(const std::string& id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    modelId = id;
+}
+
+//--------------------------------------------------------------
+std::string TextEmbedding_Cached::getModelId() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return modelId;
+}
+
+//--------------------------------------------------------------
+TextEmbedding_Cached::Stats TextEmbedding_Cached::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats stats;
+    stats.memoryHits = memoryHits;
+    stats.diskHits = diskHits;
+    stats.misses = misses;
+    stats.memoryEntries = lru.size();
+    stats.memoryBytes = memoryBytes;
+    stats.diskEntries = diskIndex.size();
+    return stats;
+}
+
+//--------------------------------------------------------------
+void TextEmbedding_Cached::resetStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    memoryHits = 0;
+    diskHits = 0;
+    misses = 0;
+}
+
+//--------------------------------------------------------------
+std::string TextEmbedding_Cached::normalize(const std::string& text) {
+    std::string normalized;
+    normalized.reserve(text.size());
+    bool pendingSpace = false;
+    for (char c : text) {
+        if (std::isspace((unsigned char)c)) {
+            pendingSpace = !normalized.empty();
+            continue;
+        }
+        if (pendingSpace) {
+            normalized.push_back(' ');
+            pendingSpace = false;
+        }
+        normalized.push_back(c);
+    }
+    return normalized;
+}
+
+//--------------------------------------------------------------
+TextEmbedding_Cached::Key TextEmbedding_Cached::makeKey(const std::string& text) const {
+    std::string material = getModelId();
+    material.push_back('\0');
+    material += normalize(text);
+
+    Key key;
+    key.low = ofxragChecksum(material.data(), material.size());
+    Checksum salted;
+    salted.update(KEY_SALT, sizeof(KEY_SALT));
+    salted.update(material.data(), material.size());
+    key.high = salted.value();
+    return key;
+}
+
+//--------------------------------------------------------------
+bool TextEmbedding_Cached::lookupLocked(const Key& key, Embedding& embedding) {
+    auto found = memoryIndex.find(key);
+    if (found != memoryIndex.end()) {
+        lru.splice(lru.begin(), lru, found->second);
+        embedding = found->second->embedding;
+        ++memoryHits;
+        return true;
+    }
+
+    auto onDisk = diskIndex.find(key);
+    if (onDisk == diskIndex.end()) {
+        return false;
+    }
+    if (!readDiskLocked(onDisk->second, key, embedding)) {
+        ofLogWarning("TextEmbedding_Cached") << "Skipping a damaged record in embedding cache: " << diskPath;
+        diskIndex.erase(onDisk);
+        return false;
+    }
+    insertMemoryLocked(key, embedding);
+    ++diskHits;
+    return true;
+}
+
+//--------------------------------------------------------------
+void TextEmbedding_Cached::insertMemoryLocked(const Key& key, const Embedding& embedding) {
+    auto found = memoryIndex.find(key);
+    if (found != memoryIndex.end()) {
+        lru.splice(lru.begin(), lru, found->second);
+        return;
+    }
+    size_t bytes = entryBytes();
+    if (bytes > memoryBudget) {
+        return;
+    }
+    lru.push_front({key, embedding});
+    memoryIndex[key] = lru.begin();
+    memoryBytes += bytes;
+    evictLocked();
+}
+
+//--------------------------------------------------------------
+bool TextEmbedding_Cached::readDiskLocked(uint64_t offset, const Key& key, Embedding& embedding) {
+    size_t dimension = getDimension();
+    size_t recordSize = RECORD_PREFIX_SIZE + dimension * sizeof(float);
+
+    const uint8_t* record = diskMapping.at<uint8_t>(offset, recordSize);
+    if (!record && offset + recordSize <= diskSize) {
+        // Appended after the file was mapped; map it again to cover the new records
+        diskMapping.open(diskPath);
+        record = diskMapping.at<uint8_t>(offset, recordSize);
+    }
+    if (!record) {
+        return false;
+    }
+
+    Key stored;
+    uint64_t checksum;
+    std::memcpy(&stored, record, sizeof(Key));
+    std::memcpy(&checksum, record + sizeof(Key), sizeof(checksum));
+    embedding.resize(dimension);
+    std::memcpy(embedding.data(), record + RECORD_PREFIX_SIZE, dimension * sizeof(float));
+    return stored == key && checksum == recordChecksum(&stored, embedding.data(), dimension);
+}
+
+//--------------------------------------------------------------
+void TextEmbedding_Cached::appendDiskLocked(const std::vector<Key>& keys, const std::vector<const Embedding*>& embeddings) {
+    if (!diskFile || keys.empty()) {
+        return;
+    }
+    size_t dimension = getDimension();
+    size_t recordSize = RECORD_PREFIX_SIZE + dimension * sizeof(float);
+
+    std::vector<uint8_t> records(keys.size() * recordSize);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        uint8_t* record = records.data() + i * recordSize;
+        uint64_t checksum = recordChecksum(&keys[i], embeddings[i]->data(), dimension);
+        std::memcpy(record, &keys[i], sizeof(Key));
+        std::memcpy(record + sizeof(Key), &checksum, sizeof(checksum));
+        std::memcpy(record + RECORD_PREFIX_SIZE, embeddings[i]->data(), dimension * sizeof(float));
+    }
+
+    if (std::fwrite(records.data(), 1, records.size(), diskFile) != records.size() || std::fflush(diskFile) != 0) {
+        // Part of the batch may have reached the file, leaving the records after it
+        // misaligned. Stop using the tier; reopening pads the torn record.
+        ofLogError("TextEmbedding_Cached") << "Could not append to embedding cache, closing it: " << diskPath;
+        closeDiskLocked();
+        return;
+    }
+    for (size_t i = 0; i < keys.size(); ++i) {
+        diskIndex[keys[i]] = diskSize + i * recordSize;
+    }
+    diskSize += records.size();
+}
+
+//--------------------------------------------------------------
+void TextEmbedding_Cached::evictLocked() {
+    size_t bytes = entryBytes();
+    while (memoryBytes > memoryBudget && !lru.empty()) {
+        memoryIndex.erase(lru.back().key);
+        lru.pop_back();
+        memoryBytes -= bytes;
+    }
+}
+
+//--------------------------------------------------------------
+size_t TextEmbedding_Cached::entryBytes() const {
+    return getDimension() * sizeof(float) + ENTRY_OVERHEAD;
+}
@@ -0,0 +1,136 @@
+/*
+ * ofxRAG
+ *
+ * Copyright (c) 2025 Yannick Hofmann
+ * <contact@yannickhofmann.de>
+ *
+ * BSD Simplified License.
+ * For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ * WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#include "TextEmbeddingBase.h"
+#include "store/MappedFile.h"
+
+#include <cstdio>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+// Wraps any embedder and remembers its results, so text that was embedded before,
+// e.g. unchanged chunks of a re-indexed document or a repeated query, skips inference.
+//
+// Entries are keyed by a 128-bit hash of the model id and the normalized text.
+// They live in an in-memory LRU cache bounded by a byte budget and, once
+// openDiskCache() was called, in an append-only file that survives restarts.
+// On opening, the file is memory-mapped and indexed; each record carries a
+// checksum that is verified when it is read, and a damaged record counts as a miss.
+// Thread-safe; inference for misses runs outside the lock.
+//
+// Only results the wrapped embedder's embedBatchChecked marks valid are cached, so
+// placeholder vectors (from a model that failed to load, or a failed inference call)
+// are returned to the caller but never stored.
+class TextEmbedding_Cached : public TextEmbeddingBase {
+public:
+    struct Stats {
+        uint64_t memoryHits = 0;
+        uint64_t diskHits = 0;
+        uint64_t misses = 0;
+        size_t memoryEntries = 0;
+        size_t memoryBytes = 0;
+        size_t diskEntries = 0;
+    };
+
+    // 'memoryBudget' bounds the bytes held by the in-memory tier (default 64 MiB).
+    explicit TextEmbedding_Cached(std::shared_ptr<TextEmbeddingBase> embedder, size_t memoryBudget = 64u << 20);
+    ~TextEmbedding_Cached() override;
+
+    Embedding embed(const std::string& text) override;
+    // Looks every text up first and passes only the misses, each distinct text
+    // once, to the wrapped embedder's embedBatch.
+    std::vector<Embedding> embedBatch(const std::vector<std::string>& texts) override;
+    std::vector<Embedding> embedBatchChecked(const std::vector<std::string>& texts, std::vector<bool>& valid) override;
+
+    bool isReady() const override { return embedder->isReady(); }
+    std::string getName() const override { return embedder->getName(); }
+    int getDimension() const override { return embedder->getDimension(); }
+
+    // Opens the on-disk tier at 'path', creating it if needed. Entries already in
+    // the file are served from it; new ones are appended and flushed to the OS.
+    // A failed append closes the tier, so it never indexes misaligned records.
+    bool openDiskCache(const std::string& path);
+    void closeDiskCache();
+    bool isDiskCacheOpen() const;
+
+    void setMemoryBudget(size_t bytes);
+    size_t getMemoryBudget() const;
+    // Empties the in-memory tier; the disk tier is kept.
+    void clearMemory();
+
+    // Identifies the model in the cache keys. Defaults to the wrapped embedder's
+    // name and dimension; set it to something that changes with the model file
+    // (e.g. its version) when several models share that name.
+    void setModelId(const std::string& id);
+    std::string getModelId() const;
+
+    Stats getStats() const;
+    void resetStats();
+
+    // Text as it is keyed: leading and trailing whitespace removed, inner runs of
+    // whitespace collapsed to one space. SentencePiece does the same before
+    // tokenizing, so texts that differ only there embed identically.
+    static std::string normalize(const std::string& text);
+
+    std::shared_ptr<TextEmbeddingBase> getEmbedder() const { return embedder; }
+
+private:
+    struct Key {
+        uint64_t low;
+        uint64_t high;
+        bool operator==(const Key& other) const { return low == other.low && high == other.high; }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& key) const { return (size_t)key.low; }
+    };
+    struct Entry {
+        Key key;
+        Embedding embedding;
+    };
+
+    Key makeKey(const std::string& text) const;
+
+    // Both expect 'mutex' to be held.
+    bool lookupLocked(const Key& key, Embedding& embedding);
+    void insertMemoryLocked(const Key& key, const Embedding& embedding);
+    bool readDiskLocked(uint64_t offset, const Key& key, Embedding& embedding);
+    void closeDiskLocked();
+    void appendDiskLocked(const std::vector<Key>& keys, const std::vector<const Embedding*>& embeddings);
+    void evictLocked();
+    size_t entryBytes() const;
+
+    std::shared_ptr<TextEmbeddingBase> embedder;
+    std::string modelId;
+
+    mutable std::mutex mutex;
+
+    // Memory tier: most recently used first
+    std::list<Entry> lru;
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> memoryIndex;
+    size_t memoryBudget;
+    size_t memoryBytes = 0;
+
+    // Disk tier: records are appended through 'diskFile' and read from the mapping,
+    // which is renewed when a record appended after mapping is needed
+    MappedFile diskMapping;
+    std::FILE* diskFile = nullptr;
+    std::string diskPath;
+    uint64_t diskSize = 0;
+    std::unordered_map<Key, uint64_t, KeyHash> diskIndex; // key -> record offset
+
+    uint64_t memoryHits = 0;
+    uint64_t diskHits = 0;
+    uint64_t misses = 0;
+};
@@ -13,8 +13,18 @@
 #include "ofFileUtils.h" // For ofFilePath::join
 #include "../ModelPath.h"
 
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+
+//--------------------------------------------------------------
+TextEmbedding_T5::TextEmbedding_T5() : TextEmbedding_T5(OnnxRuntimeOptions()) {
+}
+
 //--------------------------------------------------------------
-TextEmbedding_T5::TextEmbedding_T5() {
+TextEmbedding_T5::TextEmbedding_T5(const OnnxRuntimeOptions& options)
+    : runtimeOptions(options), constructionTime(std::chrono::steady_clock::now()) {
 #ifdef USE_ONNX
     ofLogNotice("TextEmbedding_T5") << "T5 Text Embedder (ONNX) initializing. Attempting to load models.";
     
@@ -22,11 +32,27 @@ TextEmbedding_T5::TextEmbedding_T5() {
     std::string fullModelPath = ofxragJoinModelPath("/text_embeddings/sentence-t5-base/model.onnx");
     
     try {
-        env = Ort::Env(ORT_LOGGING_LEVEL_WARNING, "T5_TextEmbedder");
-        sessionOptions = Ort::SessionOptions();
-        sessionOptions.SetIntraOpNumThreads(1); 
+        if (runtimeOptions.useGlobalThreadPool) {
+            env = getGlobalThreadPoolEnv(runtimeOptions);
+        } else {
+            env = std::make_shared<Ort::Env>(ORT_LOGGING_LEVEL_WARNING, "T5_TextEmbedder");
+        }
+        sessionOptions = createSessionOptions(runtimeOptions);
 
-        session = std::make_unique<Ort::Session>(env, fullModelPath.c_str(), sessionOptions);
+        auto loadStart = std::chrono::steady_clock::now();
+        try {
+            session = createSession(fullModelPath);
+        } catch (const Ort::Exception& e) {
+            if (!runtimeOptions.useGlobalThreadPool) throw;
+            // The process-wide environment was created earlier without global pools,
+            // so a session that disables its own threads cannot run.
+            ofLogWarning("TextEmbedding_T5") << "Global thread pool unavailable, another ONNX Runtime environment was created first ("
+                                             << e.what() << "). Falling back to per-session threads.";
+            runtimeOptions.useGlobalThreadPool = false;
+            sessionOptions = createSessionOptions(runtimeOptions);
+            session = createSession(fullModelPath);
+        }
+        modelLoadMillis = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
 
         Ort::AllocatorWithDefaultOptions allocator;
         // Get input names
@@ -39,6 +65,22 @@ TextEmbedding_T5::TextEmbedding_T5() {
             outputNames.push_back(std::string(session->GetOutputNameAllocated(i, allocator).get()));
         }
 
+        // A [batch, dimension] output can be written straight into preallocated buffers
+        std::vector<int64_t> outputShape = session->GetOutputTypeInfo(0).GetTensorTypeAndShapeInfo().GetShape();
+        pooledOutput = outputShape.size() == 2 && outputShape[1] == getDimension();
+
+        // Preallocate the buffers of every concurrent run for a full batch of the longest sequences
+        size_t runCount = std::max(1, runtimeOptions.concurrentRuns);
+        for (size_t i = 0; i < runCount; ++i) {
+            auto context = std::make_unique<RunContext>();
+            context->runOptions.SetRunTag(("T5 run " + ofToString(i)).c_str());
+            context->inputIds.reserve(maxBatchSize * MAX_SEQUENCE_LENGTH);
+            context->attentionMask.reserve(maxBatchSize * MAX_SEQUENCE_LENGTH);
+            context->output.reserve(maxBatchSize * getDimension());
+            freeContexts.push_back(context.get());
+            contexts.push_back(std::move(context));
+        }
+
 #ifdef USE_SENTENCEPIECE
         ofLogNotice("TextEmbedding_T5") << "Initializing SentencePiece tokenizer.";
         tokenizer = std::make_unique<sentencepiece::SentencePieceProcessor>();
@@ -52,7 +94,8 @@ TextEmbedding_T5::TextEmbedding_T5() {
 #endif
 
         onnx_initialized = true;
-        ofLogNotice("TextEmbedding_T5") << "T5 ONNX model loaded from: " << fullModelPath;
+        ofLogNotice("TextEmbedding_T5") << "T5 ONNX model loaded from: " << fullModelPath << " in " << modelLoadMillis << " ms"
+                                        << (usingOptimizedModelCache ? " (cached optimized graph)." : ".");
         ofLogNotice("TextEmbedding_T5") << "Input name: " << inputNames[0];
         ofLogNotice("TextEmbedding_T5") << "Output name: " << outputNames[0];
 
@@ -86,7 +129,6 @@ TextEmbedding_T5::~TextEmbedding_T5() {
 
 //--------------------------------------------------------------
 Embedding TextEmbedding_T5::embed(const std::string& text) {
-    Embedding embedding;
 #ifdef USE_ONNX
     if (onnx_initialized) {
         // --- ONNX Inference ---
@@ -94,71 +136,345 @@ Embedding TextEmbedding_T5::embed(const std::string& text) {
         if (input_ids.empty()) {
             ofLogError("TextEmbedding_T5") << "Tokenization failed for text: " << text.substr(0, 50) << "...";
             ofLogWarning("TextEmbedding_T5") << "Returning dummy embedding after tokenization failure.";
-            embedding.resize(getDimension());
-            for (int i = 0; i < getDimension(); ++i) {
-                embedding[i] = ofRandomf();
-            }
-            return embedding;
+            return placeholderEmbedding();
         }
 
-        std::vector<int64_t> attention_mask(input_ids.size(), 1); // For T5, attention mask is typically all 1s for non-padding tokens
-        
-        Ort::MemoryInfo memoryInfo = Ort::MemoryInfo::CreateCpu(OrtAllocatorType::OrtArenaAllocator, OrtMemType::OrtMemTypeDefault);
-        
-        std::vector<Ort::Value> inputTensors;
-        
-        std::vector<int64_t> input_ids_shape = {1, (int64_t)input_ids.size()};
-        inputTensors.push_back(Ort::Value::CreateTensor<int64_t>(memoryInfo, input_ids.data(), input_ids.size(), input_ids_shape.data(), input_ids_shape.size()));
-        
-        std::vector<int64_t> attention_mask_shape = {1, (int64_t)attention_mask.size()};
-        inputTensors.push_back(Ort::Value::CreateTensor<int64_t>(memoryInfo, attention_mask.data(), attention_mask.size(), attention_mask_shape.data(), attention_mask_shape.size()));
-        
-        std::vector<const char*> c_inputNames;
-        for (const auto& name : inputNames) {
-            c_inputNames.push_back(name.c_str());
+        std::vector<Embedding> embeddings;
+        if (!runBatch({&input_ids}, embeddings)) {
+            ofLogWarning("TextEmbedding_T5") << "Returning dummy embedding after inference failure.";
+            return placeholderEmbedding();
         }
+        ofLogVerbose("TextEmbedding_T5") << "Generated ONNX embedding for text: '" << text.substr(0, 50) << "...'";
+        return std::move(embeddings[0]);
+    }
+    // Fallback if ONNX was defined but failed to initialize
+#endif
+    ofLogVerbose("TextEmbedding_T5") << "Generating placeholder embedding for text: '" << text.substr(0, 50) << "...'";
+    return placeholderEmbedding();
+}
 
-        std::vector<const char*> c_outputNames;
-        for (const auto& name : outputNames) {
-            c_outputNames.push_back(name.c_str());
-        }
+//--------------------------------------------------------------
+std::vector<Embedding> TextEmbedding_T5::embedBatch(const std::vector<std::string>& texts) {
+    std::vector<bool> valid;
+    return embedBatchChecked(texts, valid);
+}
 
-        std::vector<Ort::Value> outputTensors;
-        try {
-            outputTensors = session->Run(Ort::RunOptions{nullptr}, c_inputNames.data(), inputTensors.data(), inputTensors.size(), c_outputNames.data(), c_outputNames.size());
-        } catch (const Ort::Exception& e) {
-            ofLogError("TextEmbedding_T5") << "ONNX Runtime inference error: " << e.what();
-            ofLogWarning("TextEmbedding_T5") << "Returning dummy embedding after inference failure.";
-            embedding.resize(getDimension());
-            for (int i = 0; i < getDimension(); ++i) {
-                embedding[i] = ofRandomf();
+//--------------------------------------------------------------
+std::vector<Embedding> TextEmbedding_T5::embedBatchChecked(const std::vector<std::string>& texts, std::vector<bool>& valid) {
+    valid.assign(texts.size(), false);
+#ifdef USE_ONNX
+    if (onnx_initialized) {
+        std::vector<Embedding> embeddings(texts.size());
+        std::vector<std::vector<int64_t>> ids(texts.size());
+        std::vector<size_t> order;
+        order.reserve(texts.size());
+        for (size_t i = 0; i < texts.size(); ++i) {
+            ids[i] = tokenize(texts[i]);
+            if (ids[i].empty()) {
+                ofLogError("TextEmbedding_T5") << "Tokenization failed for text: " << texts[i].substr(0, 50) << "...";
+                embeddings[i] = placeholderEmbedding();
+            } else {
+                order.push_back(i);
             }
-            return embedding;
         }
 
-        float* floatData = outputTensors[0].GetTensorMutableData<float>();
-        embedding.assign(floatData, floatData + getDimension()); 
-        
-        ofLogVerbose("TextEmbedding_T5") << "Generated ONNX embedding for text: '" << text.substr(0, 50) << "...'";
+        // Length buckets: neighbours in sorted order have similar token counts, so
+        // cutting the sorted list into consecutive batches keeps padding small.
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return ids[a].size() < ids[b].size();
+        });
 
-    } else { // Fallback if ONNX was defined but failed to initialize, or not defined at all
-        ofLogVerbose("TextEmbedding_T5") << "Generating placeholder embedding for text: '" << text.substr(0, 50) << "...'";
-        embedding.resize(getDimension()); // Use getDimension() to respect DUMMY_T5_EMBEDDING_DIM
-        for (int i = 0; i < getDimension(); ++i) {
-            embedding[i] = ofRandomf(); 
+        size_t batchSize = maxBatchSize;
+        std::vector<const std::vector<int64_t>*> batch;
+        std::vector<Embedding> batchEmbeddings;
+        for (size_t begin = 0; begin < order.size(); begin += batchSize) {
+            size_t end = std::min(order.size(), begin + batchSize);
+            batch.clear();
+            for (size_t j = begin; j < end; ++j) {
+                batch.push_back(&ids[order[j]]);
+            }
+            bool ok = runBatch(batch, batchEmbeddings);
+            if (!ok) {
+                ofLogWarning("TextEmbedding_T5") << "Returning dummy embeddings for " << batch.size() << " texts after inference failure.";
+            }
+            for (size_t j = begin; j < end; ++j) {
+                embeddings[order[j]] = ok ? std::move(batchEmbeddings[j - begin]) : placeholderEmbedding();
+                valid[order[j]] = ok;
+            }
         }
-    }
-#else
-    ofLogVerbose("TextEmbedding_T5") << "Generating placeholder embedding for text: '" << text.substr(0, 50) << "...'";
-    embedding.resize(DUMMY_T5_EMBEDDING_DIM);
-    for (int i = 0; i < DUMMY_T5_EMBEDDING_DIM; ++i) {
-        embedding[i] = ofRandomf(); // Generate a random float
+        ofLogVerbose("TextEmbedding_T5") << "Generated " << texts.size() << " ONNX embeddings in "
+                                         << (order.size() + batchSize - 1) / batchSize << " batches.";
+        return embeddings;
     }
 #endif
+    // Placeholders only; 'valid' stays false
+    return TextEmbeddingBase::embedBatch(texts);
+}
+
+//--------------------------------------------------------------
+std::future<Embedding> TextEmbedding_T5::embedAsync(const std::string& text) {
+    return std::async(std::launch::async, [this, text]() {
+        return embed(text);
+    });
+}
+
+//--------------------------------------------------------------
+std::future<std::vector<Embedding>> TextEmbedding_T5::embedBatchAsync(const std::vector<std::string>& texts) {
+    return std::async(std::launch::async, [this, texts]() {
+        return embedBatch(texts);
+    });
+}
+
+//--------------------------------------------------------------
+void TextEmbedding_T5::setMaxBatchSize(size_t size) {
+    maxBatchSize = std::max<size_t>(1, size);
+}
+
+//--------------------------------------------------------------
+Embedding TextEmbedding_T5::placeholderEmbedding() const {
+    Embedding embedding(getDimension());
+    for (float& value : embedding) {
+        value = ofRandomf();
+    }
     return embedding;
 }
 
 #ifdef USE_ONNX
+//--------------------------------------------------------------
+std::shared_ptr<Ort::Env> TextEmbedding_T5::getGlobalThreadPoolEnv(const OnnxRuntimeOptions& options) {
+    static std::mutex mutex;
+    static std::weak_ptr<Ort::Env> global;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<Ort::Env> env = global.lock();
+    if (!env) {
+        Ort::ThreadingOptions threading;
+        threading.SetGlobalIntraOpNumThreads(options.intraOpThreads);
+        threading.SetGlobalInterOpNumThreads(options.interOpThreads);
+        threading.SetGlobalSpinControl(options.allowSpinning ? 1 : 0);
+        env = std::make_shared<Ort::Env>(threading, ORT_LOGGING_LEVEL_WARNING, "T5_TextEmbedder");
+        global = env;
+        ofLogNotice("TextEmbedding_T5") << "Created global ONNX Runtime thread pool with " << options.intraOpThreads
+                                        << " intra-op threads (0 = automatic).";
+    }
+    return env;
+}
+
+//--------------------------------------------------------------
+Ort::SessionOptions TextEmbedding_T5::createSessionOptions(const OnnxRuntimeOptions& options) {
+    Ort::SessionOptions sessionOptions;
+
+    if (options.useGlobalThreadPool) {
+        // Thread counts and spinning come from the environment's pool
+        sessionOptions.DisablePerSessionThreads();
+    } else {
+        sessionOptions.SetIntraOpNumThreads(options.intraOpThreads);
+        sessionOptions.SetInterOpNumThreads(options.interOpThreads);
+        const char* spinning = options.allowSpinning ? "1" : "0";
+        sessionOptions.AddConfigEntry("session.intra_op.allow_spinning", spinning);
+        sessionOptions.AddConfigEntry("session.inter_op.allow_spinning", spinning);
+    }
+
+    sessionOptions.SetExecutionMode(options.parallelExecution ? ExecutionMode::ORT_PARALLEL : ExecutionMode::ORT_SEQUENTIAL);
+
+    switch (options.graphOptimization) {
+    case OnnxRuntimeOptions::GraphOptimization::Disabled: sessionOptions.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_DISABLE_ALL); break;
+    case OnnxRuntimeOptions::GraphOptimization::Basic:    sessionOptions.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_BASIC); break;
+    case OnnxRuntimeOptions::GraphOptimization::Extended: sessionOptions.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_EXTENDED); break;
+    case OnnxRuntimeOptions::GraphOptimization::All:      sessionOptions.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL); break;
+    }
+
+    if (options.memoryArena) {
+        sessionOptions.EnableCpuMemArena();
+    } else {
+        sessionOptions.DisableCpuMemArena();
+    }
+    if (options.memoryPattern) {
+        sessionOptions.EnableMemPattern();
+    } else {
+        sessionOptions.DisableMemPattern();
+    }
+    return sessionOptions;
+}
+
+//--------------------------------------------------------------
+std::unique_ptr<Ort::Session> TextEmbedding_T5::createSession(const std::string& modelPath) {
+    if (!runtimeOptions.cacheOptimizedModel || runtimeOptions.graphOptimization == OnnxRuntimeOptions::GraphOptimization::Disabled) {
+        return std::make_unique<Ort::Session>(*env, modelPath.c_str(), sessionOptions);
+    }
+
+    std::string cachePath = ofFilePath::removeExt(modelPath) + ".optimized.onnx";
+    std::string stampPath = cachePath + ".stamp";
+    std::string stamp = optimizedModelStamp(modelPath);
+
+    std::stringstream cachedStamp;
+    cachedStamp << std::ifstream(stampPath).rdbuf();
+    if (!stamp.empty() && cachedStamp.str() == stamp && ofFile::doesFileExist(cachePath, false)) {
+        try {
+            // Already optimized; only the session-level settings still apply
+            Ort::SessionOptions cachedOptions = createSessionOptions(runtimeOptions);
+            cachedOptions.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_DISABLE_ALL);
+            auto cached = std::make_unique<Ort::Session>(*env, cachePath.c_str(), cachedOptions);
+            usingOptimizedModelCache = true;
+            return cached;
+        } catch (const Ort::Exception& e) {
+            ofLogWarning("TextEmbedding_T5") << "Could not load the cached optimized graph, optimizing again: " << e.what();
+        }
+    }
+
+    // Optimize the model and keep the result; written under a temporary name so an
+    // interrupted start never leaves a half-written graph behind
+    std::string tempPath = cachePath + ".tmp";
+    try {
+        Ort::SessionOptions writingOptions = createSessionOptions(runtimeOptions);
+        if (runtimeOptions.graphOptimization == OnnxRuntimeOptions::GraphOptimization::All) {
+            writingOptions.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_EXTENDED);
+        }
+        writingOptions.SetOptimizedModelFilePath(tempPath.c_str());
+        auto created = std::make_unique<Ort::Session>(*env, modelPath.c_str(), writingOptions);
+
+        std::remove(cachePath.c_str());
+        std::ofstream stampFile;
+        if (std::rename(tempPath.c_str(), cachePath.c_str()) == 0) {
+            stampFile.open(stampPath, std::ios::binary | std::ios::trunc);
+            stampFile << stamp;
+        }
+        if (stampFile.good() && stampFile.is_open()) {
+            ofLogNotice("TextEmbedding_T5") << "Cached the optimized graph at: " << cachePath;
+        } else {
+            ofLogWarning("TextEmbedding_T5") << "Could not cache the optimized graph at: " << cachePath;
+        }
+        return created;
+    } catch (const Ort::Exception& e) {
+        // E.g. a read-only model folder
+        ofLogWarning("TextEmbedding_T5") << "Could not write the optimized graph, loading without cache: " << e.what();
+        std::remove(tempPath.c_str());
+    }
+    return std::make_unique<Ort::Session>(*env, modelPath.c_str(), sessionOptions);
+}
+
+//--------------------------------------------------------------
+std::string TextEmbedding_T5::optimizedModelStamp(const std::string& modelPath) const {
+    std::error_code error;
+    uint64_t size = std::filesystem::file_size(modelPath, error);
+    if (error) {
+        return "";
+    }
+    auto modified = std::filesystem::last_write_time(modelPath, error);
+    if (error) {
+        return "";
+    }
+    std::stringstream stamp;
+    stamp << "onnxruntime " << OrtGetApiBase()->GetVersionString() << "\n"
+          << "optimization " << (int)runtimeOptions.graphOptimization << "\n"
+          << "model " << size << " " << modified.time_since_epoch().count() << "\n";
+    return stamp.str();
+}
+
+//--------------------------------------------------------------
+bool TextEmbedding_T5::runBatch(const std::vector<const std::vector<int64_t>*>& batch, std::vector<Embedding>& out) {
+    size_t batchSize = batch.size();
+    size_t maxLength = 0;
+    for (const auto* ids : batch) {
+        maxLength = std::max(maxLength, ids->size());
+    }
+
+    RunContext* context = acquireContext();
+
+    // Pad every row to the longest; the mask keeps padding out of attention and pooling
+    const int64_t PAD_TOKEN_ID = 0;
+    std::vector<int64_t>& input_ids = context->inputIds;
+    std::vector<int64_t>& attention_mask = context->attentionMask;
+    input_ids.assign(batchSize * maxLength, PAD_TOKEN_ID);
+    attention_mask.assign(batchSize * maxLength, 0);
+    for (size_t row = 0; row < batchSize; ++row) {
+        const std::vector<int64_t>& ids = *batch[row];
+        std::copy(ids.begin(), ids.end(), input_ids.begin() + row * maxLength);
+        std::fill_n(attention_mask.begin() + row * maxLength, ids.size(), 1);
+    }
+
+    Ort::MemoryInfo memoryInfo = Ort::MemoryInfo::CreateCpu(OrtAllocatorType::OrtArenaAllocator, OrtMemType::OrtMemTypeDefault);
+
+    std::vector<int64_t> shape = {(int64_t)batchSize, (int64_t)maxLength};
+    std::vector<Ort::Value> inputTensors;
+    inputTensors.push_back(Ort::Value::CreateTensor<int64_t>(memoryInfo, input_ids.data(), input_ids.size(), shape.data(), shape.size()));
+    inputTensors.push_back(Ort::Value::CreateTensor<int64_t>(memoryInfo, attention_mask.data(), attention_mask.size(), shape.data(), shape.size()));
+
+    std::vector<const char*> c_inputNames;
+    for (const auto& name : inputNames) {
+        c_inputNames.push_back(name.c_str());
+    }
+
+    size_t dimension = getDimension();
+    const float* floatData = nullptr;
+    size_t stride = dimension;
+    std::vector<Ort::Value> outputTensors;
+    try {
+        if (pooledOutput) {
+            // Only the first output is needed; ONNX Runtime writes it into the context's buffer
+            const char* outputName = outputNames[0].c_str();
+            std::vector<int64_t> outputShape = {(int64_t)batchSize, (int64_t)dimension};
+            context->output.resize(batchSize * dimension);
+            Ort::Value outputTensor = Ort::Value::CreateTensor<float>(memoryInfo, context->output.data(), context->output.size(), outputShape.data(), outputShape.size());
+            session->Run(context->runOptions, c_inputNames.data(), inputTensors.data(), inputTensors.size(), &outputName, &outputTensor, 1);
+            floatData = context->output.data();
+        } else {
+            std::vector<const char*> c_outputNames;
+            for (const auto& name : outputNames) {
+                c_outputNames.push_back(name.c_str());
+            }
+            outputTensors = session->Run(context->runOptions, c_inputNames.data(), inputTensors.data(), inputTensors.size(), c_outputNames.data(), c_outputNames.size());
+            // Each row's embedding is the first getDimension() values of its slice of the output
+            size_t total = outputTensors[0].GetTensorTypeAndShapeInfo().GetElementCount();
+            stride = total / batchSize;
+            floatData = outputTensors[0].GetTensorData<float>();
+        }
+    } catch (const Ort::Exception& e) {
+        ofLogError("TextEmbedding_T5") << "ONNX Runtime inference error: " << e.what();
+        releaseContext(context);
+        return false;
+    }
+
+    bool ok = stride >= dimension;
+    if (ok) {
+        out.resize(batchSize);
+        for (size_t row = 0; row < batchSize; ++row) {
+            const float* rowData = floatData + row * stride;
+            out[row].assign(rowData, rowData + dimension);
+        }
+        if (firstEmbeddingMillis < 0) {
+            float elapsed = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - constructionTime).count();
+            float expected = -1;
+            if (firstEmbeddingMillis.compare_exchange_strong(expected, elapsed)) {
+                ofLogNotice("TextEmbedding_T5") << "First embedding ready " << elapsed << " ms after construction (model load " << modelLoadMillis << " ms).";
+            }
+        }
+    } else {
+        ofLogError("TextEmbedding_T5") << "Unexpected output size " << stride * batchSize << " for a batch of " << batchSize << ".";
+    }
+    releaseContext(context);
+    return ok;
+}
+
+//--------------------------------------------------------------
+TextEmbedding_T5::RunContext* TextEmbedding_T5::acquireContext() {
+    std::unique_lock<std::mutex> lock(contextMutex);
+    contextReleased.wait(lock, [this]() { return !freeContexts.empty(); });
+    RunContext* context = freeContexts.back();
+    freeContexts.pop_back();
+    return context;
+}
+
+//--------------------------------------------------------------
+void TextEmbedding_T5::releaseContext(RunContext* context) {
+    {
+        std::lock_guard<std::mutex> lock(contextMutex);
+        freeContexts.push_back(context);
+    }
+    contextReleased.notify_one();
+}
+
+//--------------------------------------------------------------
 std::vector<int64_t> TextEmbedding_T5::tokenize(const std::string& text) {
 #ifdef USE_SENTENCEPIECE
     if (!tokenizer) {
@@ -172,13 +488,10 @@ std::vector<int64_t> TextEmbedding_T5::tokenize(const std::string& text) {
     std::vector<int> piece_ids;
     tokenizer->Encode(text, &piece_ids);
 
-    // Max length for sentence-t5-base is 256
-    const size_t MAX_LENGTH = 256; 
-
     std::vector<int64_t> input_ids;
 
     // Add encoded tokens, truncating if necessary
-    for (size_t i = 0; i < piece_ids.size() && input_ids.size() < (MAX_LENGTH - 1); ++i) { // -1 for EOS token
+    for (size_t i = 0; i < piece_ids.size() && input_ids.size() < (MAX_SEQUENCE_LENGTH - 1); ++i) { // -1 for EOS token
         input_ids.push_back(piece_ids[i]);
     }
 
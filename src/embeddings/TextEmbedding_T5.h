@@ -13,6 +13,12 @@
 
 #include "TextEmbeddingBase.h"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+
 #ifdef USE_ONNX
 #include <onnxruntime_cxx_api.h>
 #ifdef USE_SENTENCEPIECE
@@ -23,12 +29,78 @@
 #define DUMMY_T5_EMBEDDING_DIM 768
 #endif
 
+// ONNX Runtime threading and execution settings for an embedder's session.
+// Thread counts of 0 let ONNX Runtime choose (one thread per physical core).
+struct OnnxRuntimeOptions {
+    enum class GraphOptimization { Disabled, Basic, Extended, All };
+
+    int intraOpThreads = 1;         // threads working inside one operator
+    int interOpThreads = 0;         // threads running independent operators; only used by parallel execution
+    bool parallelExecution = false; // run independent branches of the graph concurrently
+    GraphOptimization graphOptimization = GraphOptimization::All;
+    bool memoryArena = true;        // reuse CPU allocations through an arena
+    bool memoryPattern = true;      // preplan allocations from the first run's shapes
+    bool allowSpinning = true;      // idle pool threads busy-wait for work; lower latency, more CPU
+
+    // Run every embedder that sets this on one process-wide thread pool instead of
+    // a pool per session, so several sessions don't oversubscribe the cores.
+    // The pool is sized by the thread counts of the first embedder that creates it.
+    // ONNX Runtime keeps a single environment per process, so this only takes effect
+    // when chosen before any other ONNX Runtime environment exists. Otherwise the
+    // embedder logs a warning and falls back to a thread pool per session.
+    bool useGlobalThreadPool = false;
+
+    // Keep the optimized graph next to the model ('model.optimized.onnx') and load it
+    // instead of optimizing again on later starts. It is rebuilt when the model file,
+    // the optimization level or the ONNX Runtime version changes. The cached graph is
+    // optimized up to Extended: the layout changes All adds are tied to the CPU they
+    // ran on and only matter for convolutions.
+    bool cacheOptimizedModel = true;
+
+    // Inference calls that may run at the same time on the embedder's session.
+    // Each has its own input and output buffers; further callers wait for one to free up.
+    int concurrentRuns = 2;
+};
+
+// Sentence-T5 embeddings through ONNX Runtime.
+// All embedding calls are thread-safe. The session is shared, and up to
+// OnnxRuntimeOptions::concurrentRuns inference calls run on it at once. Batches take
+// turns, so a single query embedding is not stuck behind a whole document's chunks.
 class TextEmbedding_T5 : public TextEmbeddingBase {
 public:
     TextEmbedding_T5();
+    explicit TextEmbedding_T5(const OnnxRuntimeOptions& options);
     ~TextEmbedding_T5() override;
 
     Embedding embed(const std::string& text) override;
+
+    // Embeds the texts in batches of up to getMaxBatchSize(), one ONNX run each.
+    // Inputs are sorted by token count first so every batch holds texts of similar
+    // length and little padding is computed; results come back in input order.
+    std::vector<Embedding> embedBatch(const std::vector<std::string>& texts) override;
+    // Texts that failed to tokenize or whose batch failed to run get placeholders marked invalid.
+    std::vector<Embedding> embedBatchChecked(const std::vector<std::string>& texts, std::vector<bool>& valid) override;
+
+    // False when the model failed to load (or ONNX is not compiled in) and embeddings are placeholders.
+    bool isReady() const override { return onnx_initialized; }
+
+    // embed() and embedBatch() on a separate thread. The embedder must outlive the futures.
+    std::future<Embedding> embedAsync(const std::string& text);
+    std::future<std::vector<Embedding>> embedBatchAsync(const std::vector<std::string>& texts);
+
+    // Texts per inference call (default 16). Larger batches amortize more call
+    // overhead but need more memory for activations.
+    void setMaxBatchSize(size_t size);
+    size_t getMaxBatchSize() const { return maxBatchSize; }
+
+    const OnnxRuntimeOptions& getRuntimeOptions() const { return runtimeOptions; }
+
+    // Startup timings in milliseconds: creating the session, and the time from
+    // construction until the first embedding was computed (negative until then).
+    float getModelLoadMillis() const { return modelLoadMillis; }
+    float getFirstEmbeddingMillis() const { return firstEmbeddingMillis; }
+    // Whether the session was created from a previously cached optimized graph.
+    bool isUsingOptimizedModelCache() const { return usingOptimizedModelCache; }
     
     std::string getName() const override {
 #ifdef USE_ONNX
@@ -49,7 +121,19 @@ public:
     
 private:
 #ifdef USE_ONNX
-    Ort::Env env;
+    // Longest token sequence fed to the model, including the EOS token
+    static const size_t MAX_SEQUENCE_LENGTH = 256;
+
+    // Per-call state of one concurrent inference run, reused across calls
+    struct RunContext {
+        Ort::RunOptions runOptions;
+        std::vector<int64_t> inputIds;
+        std::vector<int64_t> attentionMask;
+        std::vector<float> output;
+    };
+
+    // Declared before the session so it outlives it
+    std::shared_ptr<Ort::Env> env;
     Ort::SessionOptions sessionOptions;
     std::unique_ptr<Ort::Session> session;
     std::vector<std::string> inputNames;
@@ -64,8 +148,43 @@ private:
     std::unique_ptr<sentencepiece::SentencePieceProcessor> tokenizer;
 #endif
 
+    // The process-wide environment owning the global thread pool, created on first use
+    static std::shared_ptr<Ort::Env> getGlobalThreadPoolEnv(const OnnxRuntimeOptions& options);
+    static Ort::SessionOptions createSessionOptions(const OnnxRuntimeOptions& options);
+
+    // Creates the session from the cached optimized graph when it is current,
+    // otherwise from the model, writing the cache on the way if enabled.
+    std::unique_ptr<Ort::Session> createSession(const std::string& modelPath);
+    // Identifies the model file, optimization level and runtime the cache was built from
+    std::string optimizedModelStamp(const std::string& modelPath) const;
+
     // Helper to tokenize input text
     std::vector<int64_t> tokenize(const std::string& text);
+
+    // Runs the model once on the given token sequences, padded to the longest with
+    // a zero attention mask. Writes one embedding per sequence to 'out'.
+    bool runBatch(const std::vector<const std::vector<int64_t>*>& batch, std::vector<Embedding>& out);
+
+    // Blocks until a run context is free
+    RunContext* acquireContext();
+    void releaseContext(RunContext* context);
+
+    std::vector<std::unique_ptr<RunContext>> contexts;
+    std::vector<RunContext*> freeContexts;
+    std::mutex contextMutex;
+    std::condition_variable contextReleased;
+    // Whether the model outputs one pooled [batch, dimension] row per text, so the
+    // output can be written straight into the context's buffer
+    bool pooledOutput = false;
 #endif
+    Embedding placeholderEmbedding() const;
+
+    OnnxRuntimeOptions runtimeOptions;
+    std::atomic<size_t> maxBatchSize{16};
+
+    std::chrono::steady_clock::time_point constructionTime;
+    float modelLoadMillis = 0;
+    std::atomic<float> firstEmbeddingMillis{-1};
+    bool usingOptimizedModelCache = false;
     bool onnx_initialized = false; // Flag to track successful ONNX initialization (always declared)
 };
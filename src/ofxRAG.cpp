@@ -11,7 +11,17 @@
 
 #include "ofxRAG.h"
 
-ofxRAG::ofxRAG() : nextId(0), chunkSize(500), overlapSize(100) {}
+#include <future>
+#include <unordered_map>
+
+namespace {
+// Reciprocal rank fusion: a hit at rank r (from 1) in a ranking scores 1 / (k + r).
+const float RRF_K = 60.0f;
+// Each leg of a hybrid search ranks this many times top_k candidates for fusion.
+const int HYBRID_DEPTH = 4;
+} // namespace
+
+ofxRAG::ofxRAG() : nextId(0), hybridSearch(false), chunkSize(500), overlapSize(100) {}
 
 ofxRAG::~ofxRAG() {
     // Shared pointers will handle memory management automatically.
@@ -33,6 +43,15 @@ void ofxRAG::setVectorStore(std::shared_ptr<VectorStoreBase> store) {
     ofLogNotice("ofxRAG") << "Vector store set.";
 }
 
+void ofxRAG::setHybridSearch(bool enabled) {
+    hybridSearch = enabled;
+    ofLogNotice("ofxRAG") << "Hybrid search " << (enabled ? "enabled." : "disabled.");
+}
+
+bool ofxRAG::isHybridSearch() const {
+    return hybridSearch;
+}
+
 // --- Getters ---
 std::shared_ptr<TextEmbeddingBase> ofxRAG::getTextEmbedder() const {
     return textEmbedder;
@@ -57,22 +76,133 @@ void ofxRAG::addText(const std::string& text, const std::string& source) {
         chunks.push_back(text);
     }
     
+    // Embed and insert the chunks as one batch so embedders and stores can work on them together
+    std::vector<Embedding> embeddings = textEmbedder->embedBatch(chunks);
+    std::vector<VectorMetadata> metas;
+    metas.reserve(chunks.size());
     for (size_t i = 0; i < chunks.size(); ++i) {
-        Embedding embedding = embedText(chunks[i]);
-        std::string chunkSource = source;
-        VectorMetadata meta = {nextId++, chunkSource, "text"};
-        vectorStore->add(embedding, meta, chunks[i]);
+        metas.push_back({nextId++, source, "text"});
+    }
+    vectorStore->addBatch(embeddings, metas, chunks);
+
+    if (hybridSearch) {
+        std::unique_lock<std::shared_mutex> lock(lexicalMutex);
+        for (size_t i = 0; i < chunks.size(); ++i) {
+            lexicalIndex.add(metas[i].id, metas[i].source, metas[i].type, chunks[i]);
+        }
     }
 }
 
 // --- High-Level API: Search data ---
-std::vector<SearchResult> ofxRAG::searchText(const std::string& query, int top_k) {
+std::vector<SearchResult> ofxRAG::searchText(const std::string& query, int top_k, const SearchFilter& filter) {
     if (!textEmbedder || !vectorStore) {
         ofLogWarning("ofxRAG") << "Cannot search text, embedder or store not set.";
         return {};
     }
+    if (hybridSearch) {
+        return searchTextHits(query, top_k, filter).toResults();
+    }
     Embedding queryEmbedding = embedText(query);
-    return vectorStore->search(queryEmbedding, top_k);
+    return vectorStore->search(queryEmbedding, top_k, filter);
+}
+
+SearchHits ofxRAG::searchTextHits(const std::string& query, int top_k, const SearchFilter& filter) {
+    if (!textEmbedder || !vectorStore) {
+        ofLogWarning("ofxRAG") << "Cannot search text, embedder or store not set.";
+        return {};
+    }
+    if (hybridSearch) {
+        // The lexical leg runs on its own thread while the query is embedded and searched.
+        int depth = std::max(top_k, 1) * HYBRID_DEPTH;
+        auto lexicalLeg = std::async(std::launch::async, [&]() {
+            return searchLexical({query}, depth, filter);
+        });
+        Embedding queryEmbedding = embedText(query);
+        SearchHits vectorHits = vectorStore->searchHits(queryEmbedding, depth, filter);
+        return fuseHits(std::move(vectorHits), lexicalLeg.get()[0], top_k);
+    }
+    Embedding queryEmbedding = embedText(query);
+    return vectorStore->searchHits(queryEmbedding, top_k, filter);
+}
+
+std::vector<std::vector<SearchResult>> ofxRAG::searchTextBatch(const std::vector<std::string>& queries, int top_k, const SearchFilter& filter) {
+    if (!textEmbedder || !vectorStore) {
+        ofLogWarning("ofxRAG") << "Cannot search text, embedder or store not set.";
+        return std::vector<std::vector<SearchResult>>(queries.size());
+    }
+    if (hybridSearch) {
+        int depth = std::max(top_k, 1) * HYBRID_DEPTH;
+        auto lexicalLeg = std::async(std::launch::async, [&]() {
+            return searchLexical(queries, depth, filter);
+        });
+        std::vector<Embedding> queryEmbeddings = textEmbedder->embedBatch(queries);
+        std::vector<SearchHits> vectorHits = vectorStore->searchHitsBatch(queryEmbeddings, depth, filter);
+        std::vector<std::vector<LexicalIndex::Hit>> lexicalHits = lexicalLeg.get();
+        std::vector<std::vector<SearchResult>> results(queries.size());
+        for (size_t q = 0; q < queries.size() && q < vectorHits.size(); ++q) {
+            results[q] = fuseHits(std::move(vectorHits[q]), lexicalHits[q], top_k).toResults();
+        }
+        return results;
+    }
+    std::vector<Embedding> queryEmbeddings = textEmbedder->embedBatch(queries);
+    return vectorStore->searchBatch(queryEmbeddings, top_k, filter);
+}
+
+// --- Hybrid Search Helpers ---
+std::vector<std::vector<LexicalIndex::Hit>> ofxRAG::searchLexical(const std::vector<std::string>& queries, int top_k, const SearchFilter& filter) const {
+    std::shared_lock<std::shared_mutex> lock(lexicalMutex);
+    std::vector<std::vector<LexicalIndex::Hit>> results;
+    results.reserve(queries.size());
+    for (const auto& query : queries) {
+        results.push_back(lexicalIndex.search(query, top_k, filter));
+    }
+    return results;
+}
+
+SearchHits ofxRAG::fuseHits(SearchHits vectorHits, const std::vector<LexicalIndex::Hit>& lexicalHits, int top_k) {
+    std::unordered_map<int, float> fused;
+    for (size_t rank = 0; rank < vectorHits.hits.size(); ++rank) {
+        fused[vectorHits.hits[rank].id] += 1.0f / (RRF_K + rank + 1);
+    }
+    std::vector<int> lexicalOnly;
+    for (size_t rank = 0; rank < lexicalHits.size(); ++rank) {
+        int id = lexicalHits[rank].id;
+        auto it = fused.find(id);
+        if (it == fused.end()) {
+            lexicalOnly.push_back(id);
+        }
+        fused[id] += 1.0f / (RRF_K + rank + 1);
+    }
+
+    // Chunks only the lexical leg found are looked up in the store by id, which also
+    // provides their content and keeps it leased with the rest. The lexical leg
+    // already applied the filter.
+    SearchHits fetched;
+    if (!lexicalOnly.empty()) {
+        fetched = vectorStore->getHits(lexicalOnly);
+    }
+
+    SearchHits result;
+    result.hits = std::move(vectorHits.hits);
+    result.hits.insert(result.hits.end(), fetched.hits.begin(), fetched.hits.end());
+    for (auto& hit : result.hits) {
+        hit.distance = fused[hit.id];
+    }
+    size_t k = std::min<size_t>(std::max(top_k, 0), result.hits.size());
+    std::partial_sort(result.hits.begin(), result.hits.begin() + k, result.hits.end(), [](const SearchHit& a, const SearchHit& b) {
+        return a.distance != b.distance ? a.distance > b.distance : a.id < b.id;
+    });
+    result.hits.resize(k);
+
+    if (fetched.lease) {
+        auto leases = std::make_shared<std::vector<std::shared_ptr<const void>>>();
+        leases->push_back(std::move(vectorHits.lease));
+        leases->push_back(std::move(fetched.lease));
+        result.lease = leases;
+    } else {
+        result.lease = std::move(vectorHits.lease);
+    }
+    return result;
 }
 
 // --- Direct Embedding API ---
@@ -88,14 +218,49 @@ Embedding ofxRAG::embedText(const std::string& text) {
 void ofxRAG::clearStore() {
     if (vectorStore) {
         vectorStore->clear();
+        {
+            std::unique_lock<std::shared_mutex> lock(lexicalMutex);
+            lexicalIndex.clear();
+        }
         nextId = 0;
         ofLogNotice("ofxRAG") << "Vector store cleared.";
     }
 }
 
+bool ofxRAG::removeEntry(int id) {
+    if (vectorStore) {
+        {
+            std::unique_lock<std::shared_mutex> lock(lexicalMutex);
+            lexicalIndex.remove(id);
+        }
+        return vectorStore->remove(id);
+    }
+    ofLogWarning("ofxRAG") << "Cannot remove, no vector store set.";
+    return false;
+}
+
+size_t ofxRAG::removeSource(const std::string& source) {
+    if (vectorStore) {
+        {
+            std::unique_lock<std::shared_mutex> lock(lexicalMutex);
+            lexicalIndex.removeBySource(source);
+        }
+        return vectorStore->removeBySource(source);
+    }
+    ofLogWarning("ofxRAG") << "Cannot remove, no vector store set.";
+    return 0;
+}
+
 bool ofxRAG::saveStore(const std::string& filepath) {
     if (vectorStore) {
-        return vectorStore->save(filepath);
+        if (!vectorStore->save(filepath)) {
+            return false;
+        }
+        if (hybridSearch) {
+            std::unique_lock<std::shared_mutex> lock(lexicalMutex);
+            return lexicalIndex.save(filepath + ".lex");
+        }
+        return true;
     }
     ofLogWarning("ofxRAG") << "Cannot save, no vector store set.";
     return false;
@@ -105,7 +270,18 @@ bool ofxRAG::loadStore(const std::string& filepath) {
     if (vectorStore) {
         bool result = vectorStore->load(filepath);
         if(result) {
-            nextId = vectorStore->size(); // Simple way to reset ID counter
+            nextId = vectorStore->getMaxId() + 1; // continue after the largest stored id
+        }
+        if (result && hybridSearch) {
+            std::unique_lock<std::shared_mutex> lock(lexicalMutex);
+            std::string lexicalPath = filepath + ".lex";
+            bool loaded = ofFile::doesFileExist(lexicalPath, false) && lexicalIndex.load(lexicalPath);
+            // The store may have changed after the index was saved, e.g. through the log
+            // a VectorStore_Logged replays, so both must agree on their entries.
+            if (!loaded || lexicalIndex.size() != vectorStore->size() || lexicalIndex.getMaxId() != vectorStore->getMaxId()) {
+                ofLogNotice("ofxRAG") << "Lexical index " << lexicalPath << " is missing or out of date, rebuilding it from the store.";
+                rebuildLexicalIndex();
+            }
         }
         return result;
     }
@@ -113,6 +289,25 @@ bool ofxRAG::loadStore(const std::string& filepath) {
     return false;
 }
 
+void ofxRAG::rebuildLexicalIndex() {
+    lexicalIndex.clear();
+    // Ids are handed out from 0 up, so walking them in batches reaches every stored chunk.
+    const int batchSize = 4096;
+    int maxId = vectorStore->getMaxId();
+    std::vector<int> ids;
+    for (int first = 0; first <= maxId; first += batchSize) {
+        ids.clear();
+        for (int id = first; id <= maxId && id - first < batchSize; ++id) {
+            ids.push_back(id);
+        }
+        SearchHits hits = vectorStore->getHits(ids);
+        for (const auto& hit : hits) {
+            lexicalIndex.add(hit.id, hit.source, hit.type, hit.content);
+        }
+    }
+    ofLogNotice("ofxRAG") << "Rebuilt lexical index with " << lexicalIndex.size() << " chunks.";
+}
+
 size_t ofxRAG::getStoreSize() const {
     if (vectorStore) {
         return vectorStore->size();
@@ -128,6 +323,13 @@ std::vector<std::string> ofxRAG::getContextSources() const {
     return {};
 }
 
+std::vector<SourceStats> ofxRAG::getContextSourceStats() const {
+    if (vectorStore) {
+        return vectorStore->getSourceStats();
+    }
+    return {};
+}
+
 // --- Text Chunking Helper ---
 std::vector<std::string> ofxRAG::chunkText(const std::string& text, size_t chunkSize, size_t overlapSize) {
     std::vector<std::string> chunks;
@@ -15,7 +15,13 @@
 #include "embeddings/TextEmbeddingBase.h"
 
 #include "store/VectorStoreBase.h"
+#include "store/LexicalIndex.h"
 
+#include <atomic>
+#include <shared_mutex>
+
+// Searches may run on several threads while one thread adds or removes text,
+// provided the vector store supports it (see VectorStore_Concurrent).
 class ofxRAG {
 public:
     ofxRAG();
@@ -38,8 +44,29 @@ public:
     void addText(const std::string& text, const std::string& source = "");
 
     
-    // Search for similar items
-    std::vector<SearchResult> searchText(const std::string& query, int top_k = 5);
+    // Search for similar items, optionally restricted to entries matching the filter
+    // (e.g. a set of sources); the store applies the filter while scanning.
+    std::vector<SearchResult> searchText(const std::string& query, int top_k = 5, const SearchFilter& filter = SearchFilter());
+
+    // Search for several queries at once; the queries are embedded together and
+    // the store answers them in a single batched scan. Result i belongs to queries[i].
+    std::vector<std::vector<SearchResult>> searchTextBatch(const std::vector<std::string>& queries, int top_k = 5, const SearchFilter& filter = SearchFilter());
+
+    // Like searchText, but the hits view the store's strings instead of copying them.
+    // They stay valid for as long as the returned SearchHits is kept.
+    SearchHits searchTextHits(const std::string& query, int top_k = 5, const SearchFilter& filter = SearchFilter());
+
+    // Hybrid search also ranks chunks by BM25 over their exact terms and fuses both
+    // rankings with reciprocal rank fusion, so identifiers and codes the embedding
+    // misses still come up. Result distances are then fused scores (higher is better).
+    // Enable it before adding or loading text: only text seen while it is on is indexed.
+    // saveStore() writes the lexical index next to the store as '<path>.lex'.
+    // loadStore() checks it against the loaded store's size and largest id. The store can
+    // hold changes the index never saw, e.g. a VectorStore_Logged replays its log and
+    // checkpoints on its own. A missing or out-of-date index is rebuilt from the store's
+    // contents, which takes about as long as indexing the text again.
+    void setHybridSearch(bool enabled);
+    bool isHybridSearch() const;
 
 
     // --- Direct Embedding API ---
@@ -48,17 +75,29 @@ public:
 
     // --- Vector Store Management ---
     void clearStore();
+    // Removes one chunk by its metadata id, or every chunk of a source document.
+    // Ids are never reused, so re-adding a changed document after removeSource()
+    // does not collide with ids handed out before.
+    bool removeEntry(int id);
+    size_t removeSource(const std::string& source);
     bool saveStore(const std::string& filepath);
     bool loadStore(const std::string& filepath);
     size_t getStoreSize() const;
     std::vector<std::string> getContextSources() const;
+    // Chunk count and content size per source document.
+    std::vector<SourceStats> getContextSourceStats() const;
 
 private:
     std::shared_ptr<TextEmbeddingBase> textEmbedder;
 
     std::shared_ptr<VectorStoreBase> vectorStore;
     
-    int nextId;
+    std::atomic<int> nextId; // addText() may run on a worker thread while searches run elsewhere
+
+    // Lexical side of hybrid search; saved next to the store as '<path>.lex'
+    LexicalIndex lexicalIndex;
+    mutable std::shared_mutex lexicalMutex;
+    std::atomic<bool> hybridSearch;
     
     // Chunking parameters
     size_t chunkSize;
@@ -66,4 +105,10 @@ private:
 
     // --- Text Chunking Helper ---
     std::vector<std::string> chunkText(const std::string& text, size_t chunkSize, size_t overlapSize);
+
+    // --- Hybrid Search Helpers ---
+    std::vector<std::vector<LexicalIndex::Hit>> searchLexical(const std::vector<std::string>& queries, int top_k, const SearchFilter& filter) const;
+    SearchHits fuseHits(SearchHits vectorHits, const std::vector<LexicalIndex::Hit>& lexicalHits, int top_k);
+    // Re-indexes every chunk of the vector store; expects 'lexicalMutex' to be held.
+    void rebuildLexicalIndex();
 };
@@ -0,0 +1,66 @@
+/*
+ * ofxRAG
+ *
+ * Copyright (c) 2025 Yannick Hofmann
+ * <contact@yannickhofmann.de>
+ *
+ * BSD Simplified License.
+ * For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ * WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+// Minimal allocator that hands out memory aligned to Alignment bytes, so that
+// std::vector can back SIMD-friendly row-major matrices.
+template <typename T, std::size_t Alignment = 64>
+struct AlignedAllocator {
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() noexcept = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept {}
+
+    T* allocate(std::size_t n) {
+        if (n == 0) {
+            return nullptr;
+        }
+        // aligned_alloc requires the size to be a multiple of the alignment
+        std::size_t bytes = ((n * sizeof(T) + Alignment - 1) / Alignment) * Alignment;
+        void* ptr = std::aligned_alloc(Alignment, bytes);
+        if (!ptr) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(ptr);
+    }
+
+    void deallocate(T* ptr, std::size_t) noexcept {
+        std::free(ptr);
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>&) const noexcept { return true; }
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment>&) const noexcept { return false; }
+};
+
+// Row storage used by the flat vector stores: 64-byte aligned, so every row
+// padded to a multiple of 16 floats starts on a cache line boundary.
+using AlignedFloatVector = std::vector<float, AlignedAllocator<float, 64>>;
+
+// Number of floats each row is padded to. Keeps rows aligned for AVX-512.
+constexpr std::size_t OFXRAG_ROW_ALIGNMENT_FLOATS = 16;
+
+inline std::size_t ofxragPaddedStride(std::size_t dimension) {
+    return ((dimension + OFXRAG_ROW_ALIGNMENT_FLOATS - 1) / OFXRAG_ROW_ALIGNMENT_FLOATS) * OFXRAG_ROW_ALIGNMENT_FLOATS;
+}
@@ -0,0 +1,133 @@
+/*
+ * ofxRAG
+ *
+ * Copyright (c) 2025 Yannick Hofmann
+ * <contact@yannickhofmann.de>
+ *
+ * BSD Simplified License.
+ * For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ * WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include "BinaryIO.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+//--------------------------------------------------------------
+BinaryWriter::~BinaryWriter() {
+    if (file.is_open()) {
+        abort();
+    }
+}
+
+//--------------------------------------------------------------
+bool BinaryWriter::open(const std::string& path) {
+    finalPath = path;
+    tempPath = path + ".tmp";
+    position = 0;
+    file.open(tempPath, std::ios::binary | std::ios::trunc);
+    return file.is_open();
+}
+
+//--------------------------------------------------------------
+void BinaryWriter::writeBytes(const void* data, size_t size) {
+    if (size == 0) {
+        return;
+    }
+    file.write(static_cast<const char*>(data), (std::streamsize)size);
+    position += size;
+    if (tracked) {
+        tracked->update(data, size);
+    }
+}
+
+//--------------------------------------------------------------
+void BinaryWriter::pad(size_t alignment) {
+    static const char zeros[64] = {};
+    uint64_t target = ofxragAlignUp(position, alignment);
+    while (position < target) {
+        size_t chunk = (size_t)std::min<uint64_t>(sizeof(zeros), target - position);
+        writeBytes(zeros, chunk);
+    }
+}
+
+//--------------------------------------------------------------
+void BinaryWriter::patchBytes(uint64_t offset, const void* data, size_t size) {
+    file.seekp((std::streamoff)offset);
+    file.write(static_cast<const char*>(data), (std::streamsize)size);
+    file.seekp((std::streamoff)position);
+}
+
+//--------------------------------------------------------------
+bool BinaryWriter::commit() {
+    file.flush();
+    bool ok = file.good();
+    file.close();
+    if (!ok) {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    if (std::rename(tempPath.c_str(), finalPath.c_str()) != 0) {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+//--------------------------------------------------------------
+void BinaryWriter::abort() {
+    file.close();
+    std::remove(tempPath.c_str());
+}
+
+//--------------------------------------------------------------
+void Checksum::mix(const uint8_t* block) {
+    const uint64_t prime = 1099511628211ull;
+    for (int lane = 0; lane < 4; ++lane) {
+        uint64_t word;
+        std::memcpy(&word, block + lane * 8, sizeof(word));
+        uint64_t mixed = (lanes[lane] ^ word) * prime;
+        lanes[lane] = (mixed << 31) | (mixed >> 33); // carry high bits back down
+    }
+}
+
+//--------------------------------------------------------------
+void Checksum::update(const void* data, size_t size) {
+    if (size == 0) {
+        return;
+    }
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    total += size;
+    if (partialSize > 0) {
+        size_t take = std::min(size, sizeof(partial) - partialSize);
+        std::memcpy(partial + partialSize, bytes, take);
+        partialSize += take;
+        bytes += take;
+        size -= take;
+        if (partialSize < sizeof(partial)) {
+            return;
+        }
+        mix(partial);
+        partialSize = 0;
+    }
+    for (; size >= sizeof(partial); bytes += sizeof(partial), size -= sizeof(partial)) {
+        mix(bytes);
+    }
+    std::memcpy(partial, bytes, size);
+    partialSize = size;
+}
+
+//--------------------------------------------------------------
+uint64_t Checksum::value() const {
+    const uint64_t prime = 1099511628211ull;
+    uint64_t hash = lanes[0];
+    for (int lane = 1; lane < 4; ++lane) {
+        hash = (hash ^ lanes[lane]) * prime;
+    }
+    for (size_t i = 0; i < partialSize; ++i) {
+        hash = (hash ^ partial[i]) * prime;
+    }
+    return (hash ^ total) * prime;
+}
@@ -0,0 +1,93 @@
+/*
+ * ofxRAG
+ *
+ * Copyright (c) 2025 Yannick Hofmann
+ * <contact@yannickhofmann.de>
+ *
+ * BSD Simplified License.
+ * For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ * WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <type_traits>
+
+// 64-bit checksum for detecting torn or corrupted sections of a stored file. Four
+// independent multiply-rotate lanes over 8-byte words (FNV primes), fast enough to
+// verify every section on load. Data may be fed in pieces of any size.
+class Checksum {
+public:
+    void update(const void* data, size_t size);
+    uint64_t value() const;
+
+private:
+    void mix(const uint8_t* block);
+
+    uint64_t lanes[4] = {14695981039346656037ull, 14695981039346656037ull ^ 1, 14695981039346656037ull ^ 2, 14695981039346656037ull ^ 3};
+    uint8_t partial[32];
+    size_t partialSize = 0;
+    uint64_t total = 0;
+};
+
+inline uint64_t ofxragChecksum(const void* data, size_t size) {
+    Checksum checksum;
+    checksum.update(data, size);
+    return checksum.value();
+}
+
+// Sequential writer for the binary store formats.
+// Data goes to '<path>.tmp' and is renamed over 'path' in commit(), so a crash
+// mid-save never leaves a half-written store behind, and a store that is
+// currently memory-mapped from 'path' is never modified underneath its reader.
+class BinaryWriter {
+public:
+    ~BinaryWriter();
+
+    bool open(const std::string& path);
+
+    template <typename T>
+    void write(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "BinaryWriter::write needs a POD type");
+        writeBytes(&value, sizeof(T));
+    }
+    void writeBytes(const void* data, size_t size);
+
+    // Writes zero bytes until the position is a multiple of 'alignment'.
+    void pad(size_t alignment);
+
+    // Overwrites already written bytes, e.g. to patch a header once offsets are known.
+    void patchBytes(uint64_t offset, const void* data, size_t size);
+    template <typename T>
+    void patch(uint64_t offset, const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "BinaryWriter::patch needs a POD type");
+        patchBytes(offset, &value, sizeof(T));
+    }
+
+    // Feeds every byte written from now on (padding included) into 'checksum',
+    // until called again with nullptr.
+    void track(Checksum* checksum) { tracked = checksum; }
+
+    uint64_t tell() const { return position; }
+    bool good() const { return file.good(); }
+
+    // Flushes, closes and atomically moves the temp file into place.
+    bool commit();
+    // Discards the temp file.
+    void abort();
+
+private:
+    std::ofstream file;
+    std::string finalPath;
+    std::string tempPath;
+    uint64_t position = 0;
+    Checksum* tracked = nullptr;
+};
+
+// Size in bytes rounded up to a multiple of 'alignment'.
+inline uint64_t ofxragAlignUp(uint64_t value, uint64_t alignment) {
+    return ((value + alignment - 1) / alignment) * alignment;
+}
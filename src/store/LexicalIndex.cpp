@@ -0,0 +1,659 @@
+/*
+ * ofxRAG
+ *
+ * Copyright (c) 2025 Yannick Hofmann
+ * <contact@yannickhofmann.de>
+ *
+ * BSD Simplified License.
+ * For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ * WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include "LexicalIndex.h"
+#include "BinaryIO.h"
+#include "MappedFile.h"
+#include "TopK.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+const char LEXICAL_MAGIC[8] = {'O', 'X', 'R', 'A', 'G', 'L', 'X', '1'};
+const uint32_t NO_DOC = 0xffffffffu;
+
+void putVarint(std::vector<uint8_t>& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((uint8_t)value);
+}
+
+inline uint32_t getVarint(const uint8_t* bytes, size_t& pos) {
+    uint32_t value = 0;
+    int shift = 0;
+    uint8_t byte;
+    do {
+        byte = bytes[pos++];
+        value |= (uint32_t)(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return value;
+}
+
+// getVarint for untrusted data: fails instead of reading at or past 'end'.
+bool readVarint(const uint8_t* bytes, size_t end, size_t& pos, uint32_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 35 && pos < end; shift += 7) {
+        uint8_t byte = bytes[pos++];
+        if (shift == 28 && byte > 0x0f) {
+            return false;
+        }
+        value |= (uint32_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+inline bool isWordByte(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c >= 0x80;
+}
+
+std::string lowercase(std::string_view text) {
+    std::string term(text);
+    for (auto& c : term) {
+        if (c >= 'A' && c <= 'Z') {
+            c = (char)(c - 'A' + 'a');
+        }
+    }
+    return term;
+}
+
+// Bounds-checked sequential reader over a loaded index file.
+struct FileReader {
+    const MappedFile& file;
+    uint64_t offset = 0;
+
+    template <typename T>
+    const T* take(uint64_t count = 1) {
+        const T* data = file.at<T>(offset, count);
+        if (data) {
+            offset += count * sizeof(T);
+        }
+        return data;
+    }
+    bool readU32(uint32_t& value) {
+        const uint32_t* data = take<uint32_t>();
+        if (!data) {
+            return false;
+        }
+        std::memcpy(&value, data, sizeof(value));
+        return true;
+    }
+    bool readString(std::string& text) {
+        uint32_t length;
+        const char* data = readU32(length) ? take<char>(length) : nullptr;
+        if (!data) {
+            return false;
+        }
+        text.assign(data, length);
+        return true;
+    }
+};
+} // namespace
+
+// Walks one posting list; advance() skips whole blocks using their lastDoc.
+class LexicalIndex::Cursor {
+public:
+    explicit Cursor(const PostingList& list) : list(&list) {
+        loadBlock(0);
+    }
+
+    uint32_t doc() const { return current; }
+    uint32_t tf() const { return freq; }
+    bool atEnd() const { return current == NO_DOC; }
+
+    void next() {
+        if (pos >= end) {
+            loadBlock(block + 1);
+            return;
+        }
+        current += getVarint(list->bytes.data(), pos);
+        freq = getVarint(list->bytes.data(), pos);
+    }
+
+    // Moves to the first posting with doc >= target.
+    void advance(uint32_t target) {
+        if (atEnd() || current >= target) {
+            return;
+        }
+        if (list->blocks[block].lastDoc < target) {
+            size_t next = block + 1;
+            while (next < list->blocks.size() && list->blocks[next].lastDoc < target) {
+                ++next;
+            }
+            loadBlock(next);
+        }
+        while (!atEnd() && current < target) {
+            next();
+        }
+    }
+
+private:
+    void loadBlock(size_t index) {
+        block = index;
+        if (block >= list->blocks.size()) {
+            current = NO_DOC;
+            return;
+        }
+        pos = list->blocks[block].offset;
+        end = block + 1 < list->blocks.size() ? list->blocks[block + 1].offset : list->bytes.size();
+        current = block == 0 ? 0 : list->blocks[block - 1].lastDoc;
+        next();
+    }
+
+    const PostingList* list;
+    size_t block = 0;
+    size_t pos = 0;
+    size_t end = 0;
+    uint32_t current = NO_DOC;
+    uint32_t freq = 0;
+};
+
+//--------------------------------------------------------------
+void LexicalIndex::PostingList::append(uint32_t doc, uint32_t tf) {
+    uint32_t base;
+    if (count % BLOCK_SIZE == 0) {
+        base = blocks.empty() ? 0 : blocks.back().lastDoc;
+        blocks.push_back({doc, (uint32_t)bytes.size()});
+    } else {
+        base = blocks.back().lastDoc;
+    }
+    putVarint(bytes, doc - base);
+    putVarint(bytes, tf);
+    blocks.back().lastDoc = doc;
+    ++count;
+    maxTf = std::max(maxTf, tf);
+}
+
+//--------------------------------------------------------------
+bool LexicalIndex::PostingList::isValid(uint32_t docCount) const {
+    if (blocks.empty() || blocks.size() != ((uint64_t)count + BLOCK_SIZE - 1) / BLOCK_SIZE || blocks[0].offset != 0) {
+        return false;
+    }
+    uint32_t decoded = 0;
+    uint32_t highestTf = 0;
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        size_t pos = blocks[b].offset;
+        size_t end = b + 1 < blocks.size() ? blocks[b + 1].offset : bytes.size();
+        if (end <= pos || end > bytes.size()) {
+            return false;
+        }
+        uint64_t doc = b == 0 ? 0 : blocks[b - 1].lastDoc;
+        bool first = true;
+        while (pos < end) {
+            uint32_t delta, tf;
+            if (!readVarint(bytes.data(), end, pos, delta) || !readVarint(bytes.data(), end, pos, tf)) {
+                return false;
+            }
+            // Only the very first posting of the list may have a zero delta (doc 0)
+            if (delta == 0 && !(first && b == 0)) {
+                return false;
+            }
+            doc += delta;
+            if (doc >= docCount) {
+                return false;
+            }
+            highestTf = std::max(highestTf, tf);
+            ++decoded;
+            first = false;
+        }
+        if (doc != blocks[b].lastDoc) {
+            return false;
+        }
+    }
+    return decoded == count && highestTf == maxTf;
+}
+
+//--------------------------------------------------------------
+void LexicalIndex::tokenize(std::string_view text, std::vector<std::string>& terms) {
+    terms.clear();
+    size_t n = text.size();
+    size_t i = 0;
+    while (i < n) {
+        if (!isWordByte((unsigned char)text[i])) {
+            ++i;
+            continue;
+        }
+        // A run of words joined by '-' or '.', e.g. "X-100" or "1.2.3"
+        size_t start = i;
+        size_t parts = 0;
+        while (true) {
+            size_t wordStart = i;
+            while (i < n && isWordByte((unsigned char)text[i])) {
+                ++i;
+            }
+            terms.push_back(lowercase(text.substr(wordStart, i - wordStart)));
+            ++parts;
+            if (i + 1 < n && (text[i] == '-' || text[i] == '.') && isWordByte((unsigned char)text[i + 1])) {
+                ++i;
+                continue;
+            }
+            break;
+        }
+        if (parts > 1) {
+            terms.push_back(lowercase(text.substr(start, i - start)));
+        }
+    }
+}
+
+//--------------------------------------------------------------
+void LexicalIndex::add(int id, std::string_view source, std::string_view type, std::string_view text) {
+    remove(id); // re-adding an id replaces the old document
+
+    std::vector<std::string> terms;
+    tokenize(text, terms);
+    std::unordered_map<std::string, uint32_t> frequencies;
+    for (auto& term : terms) {
+        ++frequencies[std::move(term)];
+    }
+
+    uint32_t doc = (uint32_t)docs.size();
+    for (const auto& entry : frequencies) {
+        auto it = termIds.find(entry.first);
+        if (it == termIds.end()) {
+            it = termIds.emplace(entry.first, (uint32_t)postings.size()).first;
+            postings.emplace_back();
+        }
+        postings[it->second].append(doc, entry.second);
+    }
+
+    docs.push_back({id, (uint32_t)terms.size(), strings.intern(source), strings.intern(type)});
+    deleted.push_back(0);
+    totalLength += terms.size();
+    idToDoc[id] = doc;
+}
+
+//--------------------------------------------------------------
+void LexicalIndex::markDeleted(uint32_t doc) {
+    deleted[doc] = 1;
+    ++deletedCount;
+    totalLength -= docs[doc].length;
+    idToDoc.erase(docs[doc].id);
+}
+
+//--------------------------------------------------------------
+bool LexicalIndex::remove(int id) {
+    auto it = idToDoc.find(id);
+    if (it == idToDoc.end()) {
+        return false;
+    }
+    markDeleted(it->second);
+    if (deletedCount * 4 >= docs.size()) {
+        compact();
+    }
+    return true;
+}
+
+//--------------------------------------------------------------
+int LexicalIndex::getMaxId() const {
+    int maxId = -1;
+    for (const auto& entry : idToDoc) {
+        maxId = std::max(maxId, entry.first);
+    }
+    return maxId;
+}
+
+//--------------------------------------------------------------
+size_t LexicalIndex::removeBySource(const std::string& source) {
+    std::vector<uint8_t> matching(strings.size(), 0);
+    for (size_t i = 0; i < strings.size(); ++i) {
+        const std::string& candidate = strings.get((uint32_t)i);
+        matching[i] = candidate == source || VectorStoreBase::documentSource(candidate) == source;
+    }
+    size_t removed = 0;
+    for (uint32_t doc = 0; doc < docs.size(); ++doc) {
+        if (!deleted[doc] && matching[docs[doc].source]) {
+            markDeleted(doc);
+            ++removed;
+        }
+    }
+    if (removed > 0 && deletedCount * 4 >= docs.size()) {
+        compact();
+    }
+    return removed;
+}
+
+//--------------------------------------------------------------
+void LexicalIndex::clear() {
+    termIds.clear();
+    postings.clear();
+    docs.clear();
+    deleted.clear();
+    deletedCount = 0;
+    totalLength = 0;
+    idToDoc.clear();
+    strings.clear();
+}
+
+//--------------------------------------------------------------
+void LexicalIndex::compact() {
+    if (deletedCount == 0) {
+        return;
+    }
+    std::vector<uint32_t> remap(docs.size(), NO_DOC);
+    std::vector<Doc> keptDocs;
+    keptDocs.reserve(docs.size() - deletedCount);
+    for (uint32_t doc = 0; doc < docs.size(); ++doc) {
+        if (!deleted[doc]) {
+            remap[doc] = (uint32_t)keptDocs.size();
+            keptDocs.push_back(docs[doc]);
+        }
+    }
+
+    // Re-encode every posting list without the removed documents; terms left with no
+    // postings are dropped from the dictionary.
+    std::unordered_map<std::string, uint32_t> keptTermIds;
+    std::vector<PostingList> keptPostings;
+    for (const auto& entry : termIds) {
+        PostingList list;
+        for (Cursor cursor(postings[entry.second]); !cursor.atEnd(); cursor.next()) {
+            if (remap[cursor.doc()] != NO_DOC) {
+                list.append(remap[cursor.doc()], cursor.tf());
+            }
+        }
+        if (list.count > 0) {
+            keptTermIds.emplace(entry.first, (uint32_t)keptPostings.size());
+            keptPostings.push_back(std::move(list));
+        }
+    }
+
+    termIds = std::move(keptTermIds);
+    postings = std::move(keptPostings);
+    docs = std::move(keptDocs);
+    deleted.assign(docs.size(), 0);
+    deletedCount = 0;
+    idToDoc.clear();
+    for (uint32_t doc = 0; doc < docs.size(); ++doc) {
+        idToDoc[docs[doc].id] = doc;
+    }
+}
+
+//--------------------------------------------------------------
+float LexicalIndex::idf(uint32_t df) const {
+    // df still counts removed documents until the next compaction.
+    double n = (double)size();
+    return (float)std::log(1.0 + (n - df + 0.5) / (df + 0.5));
+}
+
+//--------------------------------------------------------------
+void LexicalIndex::buildMask(const SearchFilter& filter, std::vector<uint8_t>& allowed) const {
+    allowed.assign(docs.size(), 0);
+    std::vector<uint8_t> sourceAllowed;
+    if (!filter.sources.empty()) {
+        sourceAllowed.assign(strings.size(), 0);
+        for (size_t i = 0; i < strings.size(); ++i) {
+            const std::string& source = strings.get((uint32_t)i);
+            sourceAllowed[i] = filter.sources.count(source) || filter.sources.count(VectorStoreBase::documentSource(source));
+        }
+    }
+    uint32_t typeId = StringTable::NOT_FOUND;
+    if (!filter.type.empty()) {
+        typeId = strings.find(filter.type);
+        if (typeId == StringTable::NOT_FOUND) {
+            return;
+        }
+    }
+    for (uint32_t doc = 0; doc < docs.size(); ++doc) {
+        const Doc& d = docs[doc];
+        if (deleted[doc] || (typeId != StringTable::NOT_FOUND && d.type != typeId) ||
+            (!sourceAllowed.empty() && !sourceAllowed[d.source])) {
+            continue;
+        }
+        if (!filter.idRanges.empty() && std::none_of(filter.idRanges.begin(), filter.idRanges.end(), [&](const std::pair<int, int>& range) {
+                return d.id >= range.first && d.id <= range.second;
+            })) {
+            continue;
+        }
+        allowed[doc] = 1;
+    }
+}
+
+//--------------------------------------------------------------
+std::vector<LexicalIndex::Hit> LexicalIndex::search(const std::string& query, int top_k, const SearchFilter& filter) const {
+    std::vector<Hit> results;
+    if (top_k <= 0 || size() == 0) {
+        return results;
+    }
+
+    std::vector<std::string> terms;
+    tokenize(query, terms);
+    std::sort(terms.begin(), terms.end());
+    terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+
+    // One cursor per query term present in the index, with the most that term can
+    // add to any document's score.
+    struct Term {
+        const PostingList* list;
+        float weight;     // idf * (k1 + 1)
+        float upperBound;
+    };
+    std::vector<Term> queryTerms;
+    for (const auto& term : terms) {
+        auto it = termIds.find(term);
+        if (it == termIds.end()) {
+            continue;
+        }
+        const PostingList& list = postings[it->second];
+        float weight = idf(list.count) * (k1 + 1.0f);
+        // tf / (tf + k1 * (1 - b + b * len / avg)) is largest for the largest tf and len = 0.
+        float upperBound = weight * list.maxTf / (list.maxTf + k1 * (1.0f - b));
+        queryTerms.push_back({&list, weight, upperBound});
+    }
+    if (queryTerms.empty()) {
+        return results;
+    }
+    std::sort(queryTerms.begin(), queryTerms.end(), [](const Term& x, const Term& y) {
+        return x.upperBound < y.upperBound;
+    });
+
+    std::vector<Cursor> cursors;
+    std::vector<float> cumulative; // cumulative[i] = sum of upper bounds of terms 0..i
+    float sum = 0.0f;
+    for (const auto& term : queryTerms) {
+        cursors.emplace_back(*term.list);
+        sum += term.upperBound;
+        cumulative.push_back(sum);
+    }
+
+    std::vector<uint8_t> allowed;
+    bool masked = !filter.empty() || deletedCount > 0;
+    if (masked) {
+        buildMask(filter, allowed);
+    }
+
+    float averageLength = (float)totalLength / (float)size();
+    TopKSelector selector((size_t)top_k);
+    size_t n = cursors.size();
+    // Terms [0, firstEssential) cannot reach the threshold on their own; candidates
+    // come only from the essential terms, the others are probed for them.
+    size_t firstEssential = 0;
+    while (true) {
+        uint32_t doc = NO_DOC;
+        for (size_t i = firstEssential; i < n; ++i) {
+            doc = std::min(doc, cursors[i].doc());
+        }
+        if (doc == NO_DOC) {
+            break;
+        }
+
+        if (masked && !allowed[doc]) {
+            for (size_t i = firstEssential; i < n; ++i) {
+                if (cursors[i].doc() == doc) {
+                    cursors[i].next();
+                }
+            }
+            continue;
+        }
+
+        float norm = k1 * (1.0f - b + b * docs[doc].length / averageLength);
+        float score = 0.0f;
+        for (size_t i = firstEssential; i < n; ++i) {
+            if (cursors[i].doc() == doc) {
+                float tf = (float)cursors[i].tf();
+                score += queryTerms[i].weight * tf / (tf + norm);
+                cursors[i].next();
+            }
+        }
+        float threshold = selector.threshold();
+        for (size_t i = firstEssential; i-- > 0;) {
+            if (score + cumulative[i] <= threshold) {
+                break;
+            }
+            cursors[i].advance(doc);
+            if (cursors[i].doc() == doc) {
+                float tf = (float)cursors[i].tf();
+                score += queryTerms[i].weight * tf / (tf + norm);
+            }
+        }
+
+        selector.push(score, doc);
+        threshold = selector.threshold();
+        while (firstEssential < n && cumulative[firstEssential] <= threshold) {
+            ++firstEssential;
+        }
+    }
+
+    for (const auto& best : selector.take()) {
+        results.push_back({docs[best.row].id, best.score});
+    }
+    return results;
+}
+
+//--------------------------------------------------------------
+void LexicalIndex::setParameters(float k1, float b) {
+    this->k1 = k1;
+    this->b = b;
+}
+
+//--------------------------------------------------------------
+bool LexicalIndex::save(const std::string& filepath) {
+    compact();
+
+    BinaryWriter writer;
+    if (!writer.open(filepath)) {
+        ofLogError("LexicalIndex") << "Cannot open " << filepath << " for writing.";
+        return false;
+    }
+    writer.writeBytes(LEXICAL_MAGIC, sizeof(LEXICAL_MAGIC));
+
+    writer.write((uint32_t)strings.size());
+    for (size_t i = 0; i < strings.size(); ++i) {
+        const std::string& text = strings.get((uint32_t)i);
+        writer.write((uint32_t)text.size());
+        writer.writeBytes(text.data(), text.size());
+    }
+
+    writer.write((uint32_t)docs.size());
+    writer.writeBytes(docs.data(), docs.size() * sizeof(Doc));
+
+    writer.write((uint32_t)termIds.size());
+    for (const auto& entry : termIds) {
+        const PostingList& list = postings[entry.second];
+        writer.write((uint32_t)entry.first.size());
+        writer.writeBytes(entry.first.data(), entry.first.size());
+        writer.write(list.count);
+        writer.write(list.maxTf);
+        writer.write((uint32_t)list.blocks.size());
+        writer.writeBytes(list.blocks.data(), list.blocks.size() * sizeof(Block));
+        writer.write((uint32_t)list.bytes.size());
+        writer.writeBytes(list.bytes.data(), list.bytes.size());
+    }
+
+    if (!writer.commit()) {
+        ofLogError("LexicalIndex") << "Failed to write lexical index to " << filepath;
+        return false;
+    }
+    ofLogNotice("LexicalIndex") << "Saved " << docs.size() << " documents, " << termIds.size() << " terms to " << filepath;
+    return true;
+}
+
+//--------------------------------------------------------------
+bool LexicalIndex::load(const std::string& filepath) {
+    MappedFile file;
+    if (!file.open(filepath, false)) {
+        ofLogError("LexicalIndex") << "Failed to open " << filepath;
+        return false;
+    }
+    const char* magic = file.at<char>(0, sizeof(LEXICAL_MAGIC));
+    if (!magic || std::memcmp(magic, LEXICAL_MAGIC, sizeof(LEXICAL_MAGIC)) != 0) {
+        ofLogError("LexicalIndex") << filepath << " is not a lexical index.";
+        return false;
+    }
+
+    clear();
+    FileReader reader{file, sizeof(LEXICAL_MAGIC)};
+    auto corrupt = [&]() {
+        ofLogError("LexicalIndex") << "Lexical index " << filepath << " is truncated or corrupt.";
+        clear();
+        return false;
+    };
+
+    uint32_t stringCount;
+    if (!reader.readU32(stringCount)) {
+        return corrupt();
+    }
+    for (uint32_t i = 0; i < stringCount; ++i) {
+        std::string text;
+        if (!reader.readString(text)) {
+            return corrupt();
+        }
+        strings.intern(text);
+    }
+
+    uint32_t docCount;
+    const Doc* fileDocs = reader.readU32(docCount) ? reader.take<Doc>(docCount) : nullptr;
+    if (!fileDocs && docCount > 0) {
+        return corrupt();
+    }
+    docs.resize(docCount);
+    std::memcpy(docs.data(), fileDocs, docCount * sizeof(Doc));
+    for (uint32_t doc = 0; doc < docCount; ++doc) {
+        if (docs[doc].source >= strings.size() || docs[doc].type >= strings.size()) {
+            return corrupt();
+        }
+        idToDoc[docs[doc].id] = doc;
+        totalLength += docs[doc].length;
+    }
+    deleted.assign(docCount, 0);
+
+    uint32_t termCount;
+    if (!reader.readU32(termCount)) {
+        return corrupt();
+    }
+    postings.resize(termCount);
+    for (uint32_t t = 0; t < termCount; ++t) {
+        std::string term;
+        PostingList& list = postings[t];
+        uint32_t blockCount, byteCount;
+        if (!reader.readString(term) || !reader.readU32(list.count) || !reader.readU32(list.maxTf) || !reader.readU32(blockCount)) {
+            return corrupt();
+        }
+        const Block* blocks = reader.take<Block>(blockCount);
+        const uint8_t* bytes = (blocks || blockCount == 0) && reader.readU32(byteCount) ? reader.take<uint8_t>(byteCount) : nullptr;
+        if (!bytes || blockCount == 0) {
+            return corrupt();
+        }
+        list.blocks.assign(blocks, blocks + blockCount);
+        list.bytes.assign(bytes, bytes + byteCount);
+        if (!list.isValid(docCount) || !termIds.emplace(std::move(term), t).second) {
+            return corrupt();
+        }
+    }
+
+    ofLogNotice("LexicalIndex") << "Loaded " << docs.size() << " documents, " << termIds.size() << " terms from " << filepath;
+    return true;
+}
@@ -0,0 +1,112 @@
+/*
+ * ofxRAG
+ *
+ * Copyright (c) 2025 Yannick Hofmann
+ * <contact@yannickhofmann.de>
+ *
+ * BSD Simplified License.
+ * For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ * WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#include "VectorStoreBase.h"
+#include "MetadataTable.h"
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Inverted index with BM25 ranking, for the exact terms embeddings tend to miss:
+// identifiers, part numbers, error codes.
+//
+// Text is split into lowercase terms of letters, digits and '_' (bytes >= 0x80 are
+// kept as letters). Runs joined by '-' or '.' are also indexed as one term, so
+// "X-100" matches both "x-100" and "100".
+// Each term's postings are (document, term frequency) pairs, delta and varint
+// encoded in blocks of 128 with a skip entry per block. Top-k queries use MaxScore:
+// terms whose best possible contribution cannot lift a document into the current
+// top-k are only probed for documents the other terms already found.
+// Not thread-safe; ofxRAG guards it with a reader/writer lock.
+class LexicalIndex {
+public:
+    struct Hit {
+        int id;
+        float score;
+    };
+
+    // Indexes 'text' under the metadata id; the source and type are kept for filtering.
+    void add(int id, std::string_view source, std::string_view type, std::string_view text);
+    bool remove(int id);
+    size_t removeBySource(const std::string& source);
+    void clear();
+    size_t size() const { return docs.size() - deletedCount; }
+    // Largest live id, -1 when empty.
+    int getMaxId() const;
+
+    // The top_k documents by BM25 score, best first, among those passing the filter.
+    std::vector<Hit> search(const std::string& query, int top_k, const SearchFilter& filter = SearchFilter()) const;
+
+    // Drops removed documents from the postings. Runs on its own once they make up
+    // a quarter of the index.
+    void compact();
+
+    // Compacts first, so only live documents are written.
+    bool save(const std::string& filepath);
+    bool load(const std::string& filepath);
+
+    // BM25 parameters (defaults k1 = 1.2, b = 0.75).
+    void setParameters(float k1, float b);
+
+    static void tokenize(std::string_view text, std::vector<std::string>& terms);
+
+private:
+    static const uint32_t BLOCK_SIZE = 128;
+
+    struct Block {
+        uint32_t lastDoc; // last document in the block
+        uint32_t offset;  // byte offset of the block's first posting
+    };
+    // Postings of one term: per posting varint(doc delta) and varint(tf). The delta
+    // restarts from the previous block's lastDoc at every block.
+    struct PostingList {
+        std::vector<uint8_t> bytes;
+        std::vector<Block> blocks;
+        uint32_t count = 0;
+        uint32_t maxTf = 0;
+        void append(uint32_t doc, uint32_t tf);
+        // Decodes every posting once. False unless all blocks decode exactly within
+        // their byte ranges to increasing docs below 'docCount' that match lastDoc,
+        // count and maxTf, so a Cursor over a loaded list stays in bounds.
+        bool isValid(uint32_t docCount) const;
+    };
+    // Sequential reader over a posting list with block skipping.
+    class Cursor;
+
+    struct Doc {
+        int32_t id;
+        uint32_t length;
+        uint32_t source;
+        uint32_t type;
+    };
+
+    // allowed[doc] = 1 for live documents passing the filter.
+    void buildMask(const SearchFilter& filter, std::vector<uint8_t>& allowed) const;
+    void markDeleted(uint32_t doc);
+    float idf(uint32_t df) const;
+
+    std::unordered_map<std::string, uint32_t> termIds;
+    std::vector<PostingList> postings;
+
+    std::vector<Doc> docs;
+    std::vector<uint8_t> deleted;
+    size_t deletedCount = 0;
+    uint64_t totalLength = 0; // over live documents
+    std::unordered_map<int, uint32_t> idToDoc;
+    StringTable strings; // sources and types
+
+    float k1 = 1.2f;
+    float b = 0.75f;
+};
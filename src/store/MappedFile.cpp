@@ -0,0 +1,88 @@
+/*
+ * ofxRAG
+ *
+ * Copyright (c) 2025 Yannick Hofmann
+ * <contact@yannickhofmann.de>
+ *
+ * BSD Simplified License.
+ * For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ * WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include "MappedFile.h"
+
+#include <fstream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//--------------------------------------------------------------
+MappedFile::~MappedFile() {
+    close();
+}
+
+//--------------------------------------------------------------
+bool MappedFile::open(const std::string& filepath, bool useMmap) {
+    close();
+    path = filepath;
+
+#ifndef _WIN32
+    if (useMmap) {
+        int fd = ::open(filepath.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+            ::close(fd);
+            return false;
+        }
+        void* ptr = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd); // the mapping stays valid after the descriptor is closed
+        if (ptr == MAP_FAILED) {
+            return false;
+        }
+        bytes = static_cast<const uint8_t*>(ptr);
+        length = (size_t)st.st_size;
+        mapped = true;
+        return true;
+    }
+#endif
+
+    std::ifstream file(filepath, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return false;
+    }
+    std::streamsize fileSize = file.tellg();
+    if (fileSize <= 0) {
+        return false;
+    }
+    buffer.resize((size_t)fileSize);
+    file.seekg(0);
+    if (!file.read(reinterpret_cast<char*>(buffer.data()), fileSize)) {
+        buffer.clear();
+        return false;
+    }
+    bytes = buffer.data();
+    length = buffer.size();
+    mapped = false;
+    return true;
+}
+
+//--------------------------------------------------------------
+void MappedFile::close() {
+#ifndef _WIN32
+    if (mapped && bytes) {
+        munmap(const_cast<uint8_t*>(bytes), length);
+    }
+#endif
+    bytes = nullptr;
+    length = 0;
+    mapped = false;
+    buffer.clear();
+    buffer.shrink_to_fit();
+}
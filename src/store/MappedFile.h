@@ -0,0 +1,54 @@
+/*
+ * ofxRAG
+ *
+ * Copyright (c) 2025 Yannick Hofmann
+ * <contact@yannickhofmann.de>
+ *
+ * BSD Simplified License.
+ * For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ * WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Read-only view of a whole file. Uses mmap where available so large stores
+// can be searched in place; otherwise the file is read into memory.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Maps the file at 'path'. With useMmap == false the file is read into an owned buffer instead.
+    bool open(const std::string& path, bool useMmap = true);
+    void close();
+
+    bool isOpen() const { return bytes != nullptr; }
+    bool isMapped() const { return mapped; }
+    const uint8_t* data() const { return bytes; }
+    size_t size() const { return length; }
+    const std::string& getPath() const { return path; }
+
+    // Typed pointer at a byte offset, or nullptr if [offset, offset + count * sizeof(T)) is out of range.
+    template <typename T>
+    const T* at(uint64_t offset, uint64_t count = 1) const {
+        if (offset > length || count > (length - offset) / sizeof(T)) {
+            return nullptr;
+        }
+        return reinterpret_cast<const T*>(bytes + offset);
+    }
+
+private:
+    const uint8_t* bytes = nullptr;
+    size_t length = 0;
+    bool mapped = false;
+    std::vector<uint8_t> buffer; // used when not memory-mapped
+    std::string path;
+};
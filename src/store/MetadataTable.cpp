@@ -0,0 +1,371 @@
+/*
+ * ofxRAG
+ *
+ * Copyright (c) 2025 Yannick Hofmann
+ * <contact@yannickhofmann.de>
+ *
+ * BSD Simplified License.
+ * For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ * WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include "MetadataTable.h"
+
+#include <cstring>
+
+//--------------------------------------------------------------
+StringTable::StringTable(const StringTable& other) {
+    // The map keys point into 'strings', so a copy re-interns instead of copying them.
+    for (const auto& text : other.strings) {
+        intern(text);
+    }
+}
+
+//--------------------------------------------------------------
+StringTable& StringTable::operator=(StringTable other) {
+    std::swap(strings, other.strings);
+    std::swap(ids, other.ids);
+    return *this;
+}
+
+//--------------------------------------------------------------
+uint32_t StringTable::intern(std::string_view text) {
+    auto it = ids.find(text);
+    if (it != ids.end()) {
+        return it->second;
+    }
+    uint32_t id = (uint32_t)strings.size();
+    strings.emplace_back(text);
+    ids.emplace(std::string_view(strings.back()), id);
+    return id;
+}
+
+//--------------------------------------------------------------
+uint32_t StringTable::find(std::string_view text) const {
+    auto it = ids.find(text);
+    return it == ids.end() ? NOT_FOUND : it->second;
+}
+
+//--------------------------------------------------------------
+void StringTable::clear() {
+    ids.clear();
+    strings.clear();
+}
+
+namespace {
+const size_t ARENA_BLOCK_SIZE = 1 << 20;
+const size_t ARENA_MAX_BLOCK_SIZE = size_t(1) << 31; // in-block offsets are 32-bit
+} // namespace
+
+//--------------------------------------------------------------
+uint64_t StringArena::append(std::string_view text) {
+    if (blocks.empty() || blocks.back().capacity - blocks.back().used < text.size()) {
+        addBlock(std::max(ARENA_BLOCK_SIZE, text.size()));
+    }
+    Block& block = blocks.back();
+    uint64_t handle = ((uint64_t)(blocks.size() - 1) << 32) | block.used;
+    std::memcpy(block.data.get() + block.used, text.data(), text.size());
+    block.used += text.size();
+    return handle;
+}
+
+//--------------------------------------------------------------
+void StringArena::addBlock(size_t capacity) {
+    Block block;
+    block.capacity = std::min(capacity, ARENA_MAX_BLOCK_SIZE);
+    block.data.reset(new char[block.capacity]);
+    block.base = bytes();
+    blocks.push_back(std::move(block));
+}
+
+//--------------------------------------------------------------
+void StringArena::reserve(size_t bytes) {
+    if (bytes > ARENA_BLOCK_SIZE && (blocks.empty() || blocks.back().capacity - blocks.back().used < bytes)) {
+        addBlock(bytes);
+    }
+}
+
+//--------------------------------------------------------------
+void StringArena::write(BinaryWriter& writer) const {
+    for (const auto& block : blocks) {
+        writer.writeBytes(block.data.get(), block.used);
+    }
+}
+
+//--------------------------------------------------------------
+void StringArena::clear() {
+    std::vector<Block>().swap(blocks);
+}
+
+//--------------------------------------------------------------
+size_t MetadataTable::append(int id, std::string_view source, std::string_view type, std::string_view content) {
+    Row row;
+    row.id = id;
+    row.source = internString(source);
+    row.type = internString(type);
+    row.contentLength = (uint32_t)content.size();
+    row.contentOffset = storage->arena.append(content);
+    rows.push_back(row);
+    addToDocument(rows.size() - 1);
+    return rows.size() - 1;
+}
+
+//--------------------------------------------------------------
+size_t MetadataTable::appendMapped(int id, std::string_view source, std::string_view type, uint64_t offset, uint32_t length) {
+    Row row;
+    row.id = id;
+    row.source = internString(source);
+    row.type = internString(type);
+    row.contentLength = length;
+    row.contentOffset = offset | MAPPED_CONTENT;
+    rows.push_back(row);
+    addToDocument(rows.size() - 1);
+    ++mappedCount;
+    mappedBytes += length;
+    return rows.size() - 1;
+}
+
+//--------------------------------------------------------------
+void MetadataTable::setContentFile(std::shared_ptr<const MappedFile> file) {
+    storage->contentFile = std::move(file);
+}
+
+//--------------------------------------------------------------
+uint32_t MetadataTable::internString(std::string_view text) {
+    Storage& s = *storage;
+    uint32_t id = s.strings.intern(text);
+    if (id == s.stringOffsets.size()) {
+        s.stringOffsets.push_back(s.stringsBytes);
+        s.stringsBytes += text.size();
+    }
+    return id;
+}
+
+//--------------------------------------------------------------
+void MetadataTable::addToDocument(size_t row) {
+    uint32_t source = rows[row].source;
+    if (source >= stringDocument.size()) {
+        stringDocument.resize(source + 1, StringTable::NOT_FOUND);
+    }
+    uint32_t doc = stringDocument[source];
+    if (doc == StringTable::NOT_FOUND) {
+        // First row of this interned source; its document may already exist under
+        // another chunk suffix.
+        std::string name = VectorStoreBase::documentSource(this->source(row));
+        auto it = documentIds.find(name);
+        if (it == documentIds.end()) {
+            it = documentIds.emplace(name, (uint32_t)documents.size()).first;
+            documents.emplace_back();
+            documents.back().source = name;
+        }
+        doc = stringDocument[source] = it->second;
+    }
+
+    Document& document = documents[doc];
+    ++document.chunks;
+    document.bytes += rows[row].contentLength;
+    if (!document.ranges.empty() && document.ranges.back().second == row) {
+        ++document.ranges.back().second;
+    } else {
+        document.ranges.push_back({row, row + 1});
+    }
+}
+
+//--------------------------------------------------------------
+void MetadataTable::reserve(size_t rowCount, size_t contentBytes) {
+    rows.reserve(rowCount);
+    storage->arena.reserve(contentBytes);
+}
+
+//--------------------------------------------------------------
+void MetadataTable::clear() {
+    // Fresh storage; leased views keep the old one alive.
+    std::vector<Row>().swap(rows);
+    documents.clear();
+    documentIds.clear();
+    stringDocument.clear();
+    mappedCount = 0;
+    mappedBytes = 0;
+    storage = std::make_shared<Storage>();
+}
+
+//--------------------------------------------------------------
+VectorMetadata MetadataTable::metadata(size_t row) const {
+    VectorMetadata meta;
+    meta.id = rows[row].id;
+    meta.source = source(row);
+    meta.type = type(row);
+    return meta;
+}
+
+//--------------------------------------------------------------
+SearchHit MetadataTable::hit(size_t row, float distance) const {
+    SearchHit hit;
+    hit.id = rows[row].id;
+    hit.distance = distance;
+    hit.row = row;
+    hit.source = source(row);
+    hit.type = type(row);
+    hit.content = content(row);
+    return hit;
+}
+
+//--------------------------------------------------------------
+void MetadataTable::releaseContent(size_t row) {
+    Document& document = documents[stringDocument[rows[row].source]];
+    --document.chunks;
+    document.bytes -= rows[row].contentLength;
+    if (rows[row].contentOffset & MAPPED_CONTENT) {
+        mappedBytes -= rows[row].contentLength;
+    }
+    rows[row].contentLength = 0;
+}
+
+//--------------------------------------------------------------
+void MetadataTable::compact(const std::vector<uint8_t>& deleted) {
+    MetadataTable kept;
+    size_t live = 0;
+    size_t liveBytes = 0;
+    for (size_t i = 0; i < rows.size(); ++i) {
+        if (!deleted[i]) {
+            ++live;
+            liveBytes += (rows[i].contentOffset & MAPPED_CONTENT) ? 0 : rows[i].contentLength;
+        }
+    }
+    kept.reserve(live, liveBytes);
+    kept.setContentFile(storage->contentFile);
+    for (size_t i = 0; i < rows.size(); ++i) {
+        if (deleted[i]) {
+            continue;
+        }
+        if (rows[i].contentOffset & MAPPED_CONTENT) {
+            kept.appendMapped(rows[i].id, source(i), type(i), rows[i].contentOffset & ~MAPPED_CONTENT, rows[i].contentLength);
+        } else {
+            kept.append(rows[i].id, source(i), type(i), content(i));
+        }
+    }
+    *this = std::move(kept);
+}
+
+//--------------------------------------------------------------
+std::vector<size_t> MetadataTable::rowsOf(const std::string& source) const {
+    std::vector<size_t> found;
+    std::string name = VectorStoreBase::documentSource(source);
+    auto it = documentIds.find(name);
+    if (it == documentIds.end() || documents[it->second].chunks == 0) {
+        return found;
+    }
+    // A source with a chunk suffix names only the rows interned under exactly it.
+    uint32_t exact = name == source ? StringTable::NOT_FOUND : storage->strings.find(source);
+    if (name != source && exact == StringTable::NOT_FOUND) {
+        return found;
+    }
+    for (const auto& range : documents[it->second].ranges) {
+        for (size_t row = range.first; row < range.second; ++row) {
+            if (exact == StringTable::NOT_FOUND || rows[row].source == exact) {
+                found.push_back(row);
+            }
+        }
+    }
+    return found;
+}
+
+//--------------------------------------------------------------
+std::vector<std::string> MetadataTable::documentSources() const {
+    std::vector<std::string> sources;
+    for (const auto& document : documents) {
+        if (document.chunks > 0) {
+            sources.push_back(document.source);
+        }
+    }
+    return sources;
+}
+
+//--------------------------------------------------------------
+std::vector<SourceStats> MetadataTable::documentStats() const {
+    std::vector<SourceStats> stats;
+    for (const auto& document : documents) {
+        if (document.chunks > 0) {
+            stats.push_back({document.source, document.chunks, document.bytes});
+        }
+    }
+    return stats;
+}
+
+//--------------------------------------------------------------
+size_t MetadataTable::buildMask(const SearchFilter& filter, const std::vector<uint8_t>& deleted, std::vector<uint8_t>& allowed) const {
+    allowed.assign(rows.size(), 0);
+    const StringTable& strings = storage->strings;
+
+    // Resolve the string terms against the interned table first.
+    std::vector<uint8_t> sourceAllowed;
+    if (!filter.sources.empty()) {
+        sourceAllowed.assign(strings.size(), 0);
+        for (size_t i = 0; i < strings.size(); ++i) {
+            const std::string& source = strings.get((uint32_t)i);
+            sourceAllowed[i] = filter.sources.count(source) || filter.sources.count(VectorStoreBase::documentSource(source));
+        }
+    }
+    uint32_t typeId = StringTable::NOT_FOUND;
+    if (!filter.type.empty()) {
+        typeId = strings.find(filter.type);
+        if (typeId == StringTable::NOT_FOUND) {
+            return 0;
+        }
+    }
+
+    size_t count = 0;
+    for (size_t i = 0; i < rows.size(); ++i) {
+        const Row& row = rows[i];
+        if (deleted[i] || (typeId != StringTable::NOT_FOUND && row.type != typeId) ||
+            (!sourceAllowed.empty() && !sourceAllowed[row.source])) {
+            continue;
+        }
+        if (!filter.idRanges.empty() && std::none_of(filter.idRanges.begin(), filter.idRanges.end(), [&](const std::pair<int, int>& range) {
+                return row.id >= range.first && row.id <= range.second;
+            })) {
+            continue;
+        }
+        allowed[i] = 1;
+        ++count;
+    }
+    return count;
+}
+
+//--------------------------------------------------------------
+uint64_t MetadataTable::blobSize() const {
+    return storage->stringsBytes + storage->arena.bytes() + mappedBytes;
+}
+
+//--------------------------------------------------------------
+std::vector<uint64_t> MetadataTable::contentBlobOffsets() const {
+    std::vector<uint64_t> offsets(rows.size());
+    uint64_t mappedOffset = storage->stringsBytes + storage->arena.bytes();
+    for (size_t i = 0; i < rows.size(); ++i) {
+        if (rows[i].contentOffset & MAPPED_CONTENT) {
+            offsets[i] = mappedOffset;
+            mappedOffset += rows[i].contentLength;
+        } else {
+            offsets[i] = storage->stringsBytes + storage->arena.linearOffset(rows[i].contentOffset);
+        }
+    }
+    return offsets;
+}
+
+//--------------------------------------------------------------
+void MetadataTable::writeBlob(BinaryWriter& writer) const {
+    const StringTable& strings = storage->strings;
+    for (size_t i = 0; i < strings.size(); ++i) {
+        const std::string& text = strings.get((uint32_t)i);
+        writer.writeBytes(text.data(), text.size());
+    }
+    storage->arena.write(writer);
+    if (mappedCount > 0) {
+        for (size_t i = 0; i < rows.size(); ++i) {
+            if (rows[i].contentOffset & MAPPED_CONTENT) {
+                std::string_view text = content(i);
+                writer.writeBytes(text.data(), text.size());
+            }
+        }
+    }
+}
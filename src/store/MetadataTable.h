@@ -0,0 +1,194 @@
+/*
+ * ofxRAG
+ *
+ * Copyright (c) 2025 Yannick Hofmann
+ * <contact@yannickhofmann.de>
+ *
+ * BSD Simplified License.
+ * For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ * WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#include "VectorStoreBase.h"
+#include "BinaryIO.h"
+#include "MappedFile.h"
+
+#include <deque>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+
+// Interns strings into 32-bit ids; every distinct string is stored once.
+class StringTable {
+public:
+    StringTable() = default;
+    StringTable(const StringTable& other);
+    StringTable(StringTable&&) = default;
+    StringTable& operator=(StringTable other);
+
+    uint32_t intern(std::string_view text);
+    // Id of 'text', or NOT_FOUND.
+    uint32_t find(std::string_view text) const;
+    const std::string& get(uint32_t id) const { return strings[id]; }
+    size_t size() const { return strings.size(); }
+    void clear();
+
+    static constexpr uint32_t NOT_FOUND = 0xffffffffu;
+
+private:
+    std::deque<std::string> strings; // stable addresses, the map keys point into them
+    std::unordered_map<std::string_view, uint32_t> ids;
+};
+
+// Append-only storage holding many strings back to back in large blocks. Stored
+// bytes never move, so views into the arena survive later appends.
+class StringArena {
+public:
+    // Returns a handle (block << 32 | offset in block) for view().
+    uint64_t append(std::string_view text);
+    std::string_view view(uint64_t handle, uint32_t length) const {
+        return std::string_view(blocks[handle >> 32].data.get() + (uint32_t)handle, length);
+    }
+    // Position of a handle's bytes when the blocks are written back to back by write().
+    uint64_t linearOffset(uint64_t handle) const { return blocks[handle >> 32].base + (uint32_t)handle; }
+    size_t bytes() const { return blocks.empty() ? 0 : blocks.back().base + blocks.back().used; }
+    // Sizes the next block to hold at least 'bytes' more without starting another one.
+    void reserve(size_t bytes);
+    void write(BinaryWriter& writer) const;
+    void clear();
+
+private:
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t capacity = 0;
+        size_t used = 0;
+        uint64_t base = 0; // linear offset of the block's first byte
+    };
+    void addBlock(size_t capacity);
+
+    std::vector<Block> blocks;
+};
+
+// Compact per-row metadata shared by the vector stores. Sources and types are
+// interned into one string table and rows refer to them by id; contents live in
+// an arena of large blocks. A row costs 24 bytes plus its content, instead of three
+// heap-allocated strings.
+// The strings are owned through a shared block that lease() hands out: views taken
+// from the table stay valid while a lease is held, even after the table is
+// appended to, compacted or cleared.
+class MetadataTable {
+public:
+    MetadataTable() = default;
+    MetadataTable(const MetadataTable&) = delete;
+    MetadataTable& operator=(const MetadataTable&) = delete;
+    MetadataTable(MetadataTable&&) = default;
+    MetadataTable& operator=(MetadataTable&&) = default;
+
+    // Appends a row and returns its index.
+    size_t append(int id, std::string_view source, std::string_view type, std::string_view content);
+    size_t append(const VectorMetadata& metadata, const std::string& content) {
+        return append(metadata.id, metadata.source, metadata.type, content);
+    }
+    // Appends a row whose content stays in the file given to setContentFile(), at
+    // [offset, offset + length). Only the row itself is kept in memory; the bytes
+    // are read from the file when the content is asked for.
+    size_t appendMapped(int id, std::string_view source, std::string_view type, uint64_t offset, uint32_t length);
+    // File that appendMapped() rows refer to. Kept open for as long as the table or
+    // a lease needs it.
+    void setContentFile(std::shared_ptr<const MappedFile> file);
+    void reserve(size_t rows, size_t contentBytes = 0);
+    void clear();
+    size_t size() const { return rows.size(); }
+
+    int id(size_t row) const { return rows[row].id; }
+    uint32_t sourceId(size_t row) const { return rows[row].source; }
+    const std::string& source(size_t row) const { return storage->strings.get(rows[row].source); }
+    const std::string& type(size_t row) const { return storage->strings.get(rows[row].type); }
+    std::string_view content(size_t row) const {
+        const Row& r = rows[row];
+        if (r.contentOffset & MAPPED_CONTENT) {
+            return std::string_view(reinterpret_cast<const char*>(storage->contentFile->data()) + (r.contentOffset & ~MAPPED_CONTENT), r.contentLength);
+        }
+        return storage->arena.view(r.contentOffset, r.contentLength);
+    }
+    // Number of rows whose content is read from the content file.
+    size_t mappedRows() const { return mappedCount; }
+    // Materializes the row as VectorMetadata.
+    VectorMetadata metadata(size_t row) const;
+    // A search hit viewing the row's strings; valid under lease().
+    SearchHit hit(size_t row, float distance) const;
+    // Keeps the current strings alive for as long as the returned handle is held.
+    std::shared_ptr<const void> lease() const { return storage; }
+
+    // Forgets a removed row's content and takes it out of its document's statistics;
+    // call once per removed row. The bytes are reclaimed by the next compact().
+    void releaseContent(size_t row);
+    // Drops the rows marked in 'deleted' and rebuilds the string table and arena
+    // from the remaining rows, keeping their order. Mapped contents stay in their file.
+    void compact(const std::vector<uint8_t>& deleted);
+
+    // --- Documents ---
+    // Rows are grouped by document source as they are appended, so these cost
+    // O(documents) rather than a pass over all rows.
+    // Rows whose source is 'source', or 'source' plus a chunk suffix; may include rows
+    // already removed.
+    std::vector<size_t> rowsOf(const std::string& source) const;
+    // Distinct document sources with live rows, in order of first appearance.
+    std::vector<std::string> documentSources() const;
+    std::vector<SourceStats> documentStats() const;
+
+    // allowed[row] = 1 for every row that is not deleted and passes the filter.
+    // The filter's source and type terms are resolved once per interned string, so
+    // the per-row test only compares ids. Returns the number of allowed rows.
+    size_t buildMask(const SearchFilter& filter, const std::vector<uint8_t>& deleted, std::vector<uint8_t>& allowed) const;
+
+    // --- Binary formats ---
+    // The string blob of a binary store is every interned string once, followed by the
+    // content arena and then the mapped contents in row order. These give a row's
+    // offsets into that blob.
+    uint64_t blobSize() const;
+    uint64_t sourceBlobOffset(size_t row) const { return storage->stringOffsets[rows[row].source]; }
+    uint64_t typeBlobOffset(size_t row) const { return storage->stringOffsets[rows[row].type]; }
+    // Content offsets of all rows, computed in one pass.
+    std::vector<uint64_t> contentBlobOffsets() const;
+    uint32_t contentLength(size_t row) const { return rows[row].contentLength; }
+    void writeBlob(BinaryWriter& writer) const;
+
+private:
+    struct Row {
+        int32_t id;
+        uint32_t source;
+        uint32_t type;
+        uint32_t contentLength;
+        uint64_t contentOffset; // arena handle, or file offset | MAPPED_CONTENT
+    };
+    static const uint64_t MAPPED_CONTENT = 1ull << 63;
+    struct Storage {
+        StringTable strings;
+        std::vector<uint64_t> stringOffsets; // blob offset of each interned string
+        uint64_t stringsBytes = 0;
+        StringArena arena;
+        std::shared_ptr<const MappedFile> contentFile;
+    };
+    // Rows of one document source. 'ranges' are the [begin, end) row runs it was
+    // appended in; removed rows stay inside them until the table is compacted.
+    struct Document {
+        std::string source;
+        size_t chunks = 0;
+        uint64_t bytes = 0;
+        std::vector<std::pair<size_t, size_t>> ranges;
+    };
+    uint32_t internString(std::string_view text);
+    // Adds the last appended row to its document.
+    void addToDocument(size_t row);
+
+    std::vector<Row> rows;
+    std::vector<Document> documents;
+    std::unordered_map<std::string, uint32_t> documentIds;
+    std::vector<uint32_t> stringDocument; // interned string id -> document, for sources
+    size_t mappedCount = 0;
+    uint64_t mappedBytes = 0;
+    std::shared_ptr<Storage> storage = std::make_shared<Storage>();
+};
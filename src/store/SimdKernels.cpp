@@ -0,0 +1,285 @@
+/*
+ * ofxRAG
+ *
+ * Copyright (c) 2025 Yannick Hofmann
+ * <contact@yannickhofmann.de>
+ *
+ * BSD Simplified License.
+ * For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ * WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include "SimdKernels.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define OFXRAG_SIMD_X86 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define OFXRAG_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+using DotFn = float (*)(const float*, const float*, std::size_t);
+using DotInt8Fn = int32_t (*)(const int8_t*, const int8_t*, std::size_t);
+
+//--------------------------------------------------------------
+float dotScalar(const float* a, const float* b, std::size_t n) {
+    // Four independent accumulators let the compiler pipeline the loop.
+    float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 += a[i] * b[i];
+        s1 += a[i + 1] * b[i + 1];
+        s2 += a[i + 2] * b[i + 2];
+        s3 += a[i + 3] * b[i + 3];
+    }
+    for (; i < n; ++i) {
+        s0 += a[i] * b[i];
+    }
+    return (s0 + s1) + (s2 + s3);
+}
+
+//--------------------------------------------------------------
+int32_t dotInt8Scalar(const int8_t* a, const int8_t* b, std::size_t n) {
+    int32_t sum = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        sum += (int32_t)a[i] * (int32_t)b[i];
+    }
+    return sum;
+}
+
+#ifdef OFXRAG_SIMD_X86
+//--------------------------------------------------------------
+__attribute__((target("avx2,fma")))
+float dotAvx2(const float* a, const float* b, std::size_t n) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+    }
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+    }
+    __m256 acc = _mm256_add_ps(acc0, acc1);
+    __m128 lo = _mm256_castps256_ps128(acc);
+    __m128 hi = _mm256_extractf128_ps(acc, 1);
+    __m128 sum = _mm_add_ps(lo, hi);
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 0x1));
+    float result = _mm_cvtss_f32(sum);
+    for (; i < n; ++i) {
+        result += a[i] * b[i];
+    }
+    return result;
+}
+
+//--------------------------------------------------------------
+__attribute__((target("avx512f")))
+float dotAvx512(const float* a, const float* b, std::size_t n) {
+    __m512 acc0 = _mm512_setzero_ps();
+    __m512 acc1 = _mm512_setzero_ps();
+    std::size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+        acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16), acc1);
+    }
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+    }
+    if (i < n) {
+        // Masked load handles the tail without reading past the end.
+        __mmask16 mask = (__mmask16)((1u << (n - i)) - 1u);
+        acc1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, a + i), _mm512_maskz_loadu_ps(mask, b + i), acc1);
+    }
+    alignas(64) float lanes[16];
+    _mm512_store_ps(lanes, _mm512_add_ps(acc0, acc1));
+    float result = 0.0f;
+    for (float lane : lanes) {
+        result += lane;
+    }
+    return result;
+}
+
+//--------------------------------------------------------------
+__attribute__((target("avx2")))
+int32_t dotInt8Avx2(const int8_t* a, const int8_t* b, std::size_t n) {
+    // maddubs multiplies unsigned by signed bytes, so |a| is paired with b carrying
+    // the sign of a. With codes in [-127, 127] each pair sum stays below 2^15.
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i acc = _mm256_setzero_si256();
+    std::size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        __m256i pairs = _mm256_maddubs_epi16(_mm256_sign_epi8(va, va), _mm256_sign_epi8(vb, va));
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(pairs, ones));
+    }
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4e));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xb1));
+    int32_t result = _mm_cvtsi128_si32(sum);
+    for (; i < n; ++i) {
+        result += (int32_t)a[i] * (int32_t)b[i];
+    }
+    return result;
+}
+
+//--------------------------------------------------------------
+__attribute__((target("avx512f,avx512bw,avx512vnni")))
+inline __m512i dpbusdSigned(__m512i acc, __m512i va, __m512i vb) {
+    // vpdpbusd takes unsigned x signed bytes like maddubs, but accumulates four
+    // products straight into 32-bit lanes without intermediate saturation.
+    __mmask64 negative = _mm512_movepi8_mask(va);
+    return _mm512_dpbusd_epi32(acc, _mm512_abs_epi8(va), _mm512_mask_sub_epi8(vb, negative, _mm512_setzero_si512(), vb));
+}
+
+//--------------------------------------------------------------
+__attribute__((target("avx512f,avx512bw,avx512vnni")))
+int32_t dotInt8Avx512Vnni(const int8_t* a, const int8_t* b, std::size_t n) {
+    __m512i acc0 = _mm512_setzero_si512();
+    __m512i acc1 = _mm512_setzero_si512();
+    std::size_t i = 0;
+    for (; i + 128 <= n; i += 128) {
+        acc0 = dpbusdSigned(acc0, _mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i));
+        acc1 = dpbusdSigned(acc1, _mm512_loadu_si512(a + i + 64), _mm512_loadu_si512(b + i + 64));
+    }
+    for (; i + 64 <= n; i += 64) {
+        acc0 = dpbusdSigned(acc0, _mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i));
+    }
+    if (i < n) {
+        // Masked load handles the tail without reading past the end.
+        __mmask64 mask = (__mmask64)(~0ull >> (64 - (n - i)));
+        acc1 = dpbusdSigned(acc1, _mm512_maskz_loadu_epi8(mask, a + i), _mm512_maskz_loadu_epi8(mask, b + i));
+    }
+    alignas(64) int32_t lanes[16];
+    _mm512_store_si512(lanes, _mm512_add_epi32(acc0, acc1));
+    int32_t result = 0;
+    for (int32_t lane : lanes) {
+        result += lane;
+    }
+    return result;
+}
+#endif
+
+#ifdef OFXRAG_SIMD_NEON
+//--------------------------------------------------------------
+float dotNeon(const float* a, const float* b, std::size_t n) {
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    float32x4_t acc2 = vdupq_n_f32(0.0f);
+    float32x4_t acc3 = vdupq_n_f32(0.0f);
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = vfmaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vfmaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+        acc2 = vfmaq_f32(acc2, vld1q_f32(a + i + 8), vld1q_f32(b + i + 8));
+        acc3 = vfmaq_f32(acc3, vld1q_f32(a + i + 12), vld1q_f32(b + i + 12));
+    }
+    for (; i + 4 <= n; i += 4) {
+        acc0 = vfmaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+    }
+    float result = vaddvq_f32(vaddq_f32(vaddq_f32(acc0, acc1), vaddq_f32(acc2, acc3)));
+    for (; i < n; ++i) {
+        result += a[i] * b[i];
+    }
+    return result;
+}
+
+//--------------------------------------------------------------
+int32_t dotInt8Neon(const int8_t* a, const int8_t* b, std::size_t n) {
+    // Widening multiply to 16 bits, pairwise accumulate into 32 bits.
+    int32x4_t acc0 = vdupq_n_s32(0);
+    int32x4_t acc1 = vdupq_n_s32(0);
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        int8x16_t va = vld1q_s8(a + i);
+        int8x16_t vb = vld1q_s8(b + i);
+        acc0 = vpadalq_s16(acc0, vmull_s8(vget_low_s8(va), vget_low_s8(vb)));
+        acc1 = vpadalq_s16(acc1, vmull_s8(vget_high_s8(va), vget_high_s8(vb)));
+    }
+    int32_t result = vaddvq_s32(vaddq_s32(acc0, acc1));
+    for (; i < n; ++i) {
+        result += (int32_t)a[i] * (int32_t)b[i];
+    }
+    return result;
+}
+#endif
+
+//--------------------------------------------------------------
+struct KernelChoice {
+    DotFn dot;
+    const char* name;
+};
+
+struct Int8KernelChoice {
+    DotInt8Fn dot;
+    const char* name;
+};
+
+KernelChoice selectKernel() {
+#ifdef OFXRAG_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return {dotAvx512, "avx512"};
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return {dotAvx2, "avx2"};
+    }
+#endif
+#ifdef OFXRAG_SIMD_NEON
+    return {dotNeon, "neon"};
+#endif
+    return {dotScalar, "scalar"};
+}
+
+Int8KernelChoice selectInt8Kernel() {
+#ifdef OFXRAG_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512vnni") && __builtin_cpu_supports("avx512bw")) {
+        return {dotInt8Avx512Vnni, "avx512vnni"};
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return {dotInt8Avx2, "avx2"};
+    }
+#endif
+#ifdef OFXRAG_SIMD_NEON
+    return {dotInt8Neon, "neon"};
+#endif
+    return {dotInt8Scalar, "scalar"};
+}
+
+const KernelChoice& kernel() {
+    static const KernelChoice choice = selectKernel();
+    return choice;
+}
+
+const Int8KernelChoice& int8Kernel() {
+    static const Int8KernelChoice choice = selectInt8Kernel();
+    return choice;
+}
+
+} // namespace
+
+//--------------------------------------------------------------
+float ofxragDotProduct(const float* a, const float* b, std::size_t n) {
+    return kernel().dot(a, b, n);
+}
+
+//--------------------------------------------------------------
+std::string ofxragSimdKernelName() {
+    return kernel().name;
+}
+
+//--------------------------------------------------------------
+int32_t ofxragDotProductInt8(const int8_t* a, const int8_t* b, std::size_t n) {
+    return int8Kernel().dot(a, b, n);
+}
+
+//--------------------------------------------------------------
+std::string ofxragInt8KernelName() {
+    return int8Kernel().name;
+}
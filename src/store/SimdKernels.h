@@ -0,0 +1,33 @@
+/*
+ * ofxRAG
+ *
+ * Copyright (c) 2025 Yannick Hofmann
+ * <contact@yannickhofmann.de>
+ *
+ * BSD Simplified License.
+ * For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ * WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Dot product of two float vectors of length n.
+// The implementation is picked once at runtime (AVX-512, AVX2/FMA, NEON or
+// scalar), so the addon can be built without -march flags and still use the
+// widest instruction set the CPU supports.
+float ofxragDotProduct(const float* a, const float* b, std::size_t n);
+
+// Returns the name of the kernel selected for ofxragDotProduct, e.g. "avx2".
+std::string ofxragSimdKernelName();
+
+// Dot product of two int8 code vectors of length n, accumulated in 32 bits.
+// Codes must lie in [-127, 127] (never -128) so the AVX2 path can use
+// maddubs without saturating. Uses AVX-512 VNNI, AVX2, NEON or scalar code.
+int32_t ofxragDotProductInt8(const int8_t* a, const int8_t* b, std::size_t n);
+
+// Returns the name of the kernel selected for ofxragDotProductInt8, e.g. "avx512vnni".
+std::string ofxragInt8KernelName();
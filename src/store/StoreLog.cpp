@@ -0,0 +1,284 @@
+/*
+ * ofxRAG
+ *
+ * Copyright (c) 2025 Yannick Hofmann
+ * <contact@yannickhofmann.de>
+ *
+ * BSD Simplified License.
+ * For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ * WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include "StoreLog.h"
+#include "BinaryIO.h"
+#include "MappedFile.h"
+
+#include "ofMain.h"
+
+#include <cstring>
+
+namespace {
+const char LOG_MAGIC[8] = {'O', 'X', 'R', 'A', 'G', 'W', 'L', '1'};
+const size_t RECORD_HEADER_SIZE = 3 * sizeof(uint32_t); // type, payload size, checksum
+
+// FNV-1a over the payload; enough to tell a torn write from a complete record.
+uint32_t checksum(const uint8_t* data, size_t size) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+void putBytes(std::vector<uint8_t>& out, const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    out.insert(out.end(), bytes, bytes + size);
+}
+
+template <typename T>
+void put(std::vector<uint8_t>& out, const T& value) {
+    putBytes(out, &value, sizeof(T));
+}
+
+void putString(std::vector<uint8_t>& out, const std::string& text) {
+    put<uint32_t>(out, (uint32_t)text.size());
+    putBytes(out, text.data(), text.size());
+}
+
+// Bounds-checked cursor over one record's payload.
+struct PayloadReader {
+    const uint8_t* data;
+    size_t size;
+    size_t offset = 0;
+
+    bool readBytes(void* out, size_t count) {
+        if (count > size - offset) {
+            return false;
+        }
+        std::memcpy(out, data + offset, count);
+        offset += count;
+        return true;
+    }
+    template <typename T>
+    bool read(T& value) {
+        return readBytes(&value, sizeof(T));
+    }
+    bool readString(std::string& text) {
+        uint32_t length;
+        if (!read(length) || length > size - offset) {
+            return false;
+        }
+        text.assign(reinterpret_cast<const char*>(data + offset), length);
+        offset += length;
+        return true;
+    }
+};
+} // namespace
+
+//--------------------------------------------------------------
+StoreLog::~StoreLog() {
+    close();
+}
+
+//--------------------------------------------------------------
+bool StoreLog::open(const std::string& path) {
+    close();
+    file = std::fopen(path.c_str(), "ab");
+    if (!file) {
+        ofLogError("StoreLog") << "Could not open log: " << path;
+        return false;
+    }
+    this->path = path;
+    std::fseek(file, 0, SEEK_END);
+    bytes = (uint64_t)std::ftell(file);
+    if (bytes == 0) {
+        std::fwrite(LOG_MAGIC, 1, sizeof(LOG_MAGIC), file);
+        std::fflush(file);
+        bytes = sizeof(LOG_MAGIC);
+    }
+    return true;
+}
+
+//--------------------------------------------------------------
+void StoreLog::close() {
+    if (file) {
+        std::fclose(file);
+        file = nullptr;
+    }
+}
+
+//--------------------------------------------------------------
+bool StoreLog::appendAdd(const std::vector<Embedding>& embeddings, const std::vector<VectorMetadata>& metadata, const std::vector<std::string>& contents) {
+    uint32_t count = (uint32_t)std::min(embeddings.size(), std::min(metadata.size(), contents.size()));
+    size_t reserve = sizeof(uint32_t);
+    for (uint32_t i = 0; i < count; ++i) {
+        reserve += embeddings[i].size() * sizeof(float) + metadata[i].source.size() + metadata[i].type.size() + contents[i].size() + 5 * sizeof(uint32_t);
+    }
+    std::vector<uint8_t> payload;
+    payload.reserve(reserve);
+    put<uint32_t>(payload, count);
+    for (uint32_t i = 0; i < count; ++i) {
+        put<int32_t>(payload, metadata[i].id);
+        putString(payload, metadata[i].source);
+        putString(payload, metadata[i].type);
+        putString(payload, contents[i]);
+        put<uint32_t>(payload, (uint32_t)embeddings[i].size());
+        putBytes(payload, embeddings[i].data(), embeddings[i].size() * sizeof(float));
+    }
+    return appendRecord(RECORD_ADD, payload);
+}
+
+//--------------------------------------------------------------
+bool StoreLog::appendRemove(int id) {
+    std::vector<uint8_t> payload;
+    put<int32_t>(payload, id);
+    return appendRecord(RECORD_REMOVE, payload);
+}
+
+//--------------------------------------------------------------
+bool StoreLog::appendRemoveSource(const std::string& source) {
+    std::vector<uint8_t> payload;
+    putString(payload, source);
+    return appendRecord(RECORD_REMOVE_SOURCE, payload);
+}
+
+//--------------------------------------------------------------
+bool StoreLog::appendClear() {
+    return appendRecord(RECORD_CLEAR, {});
+}
+
+//--------------------------------------------------------------
+bool StoreLog::appendRecord(RecordType type, const std::vector<uint8_t>& payload) {
+    if (!file) {
+        return false;
+    }
+    uint32_t header[3] = {(uint32_t)type, (uint32_t)payload.size(), checksum(payload.data(), payload.size())};
+    bool ok = std::fwrite(header, 1, sizeof(header), file) == sizeof(header) &&
+              std::fwrite(payload.data(), 1, payload.size(), file) == payload.size() &&
+              std::fflush(file) == 0;
+    if (!ok) {
+        ofLogError("StoreLog") << "Could not append to log: " << path;
+        return false;
+    }
+    bytes += sizeof(header) + payload.size();
+    return true;
+}
+
+//--------------------------------------------------------------
+bool StoreLog::reset() {
+    std::string logPath = path;
+    close();
+    // Reopening with "wb" truncates; open() then writes a fresh header.
+    std::FILE* truncated = std::fopen(logPath.c_str(), "wb");
+    if (!truncated) {
+        ofLogError("StoreLog") << "Could not reset log: " << logPath;
+        return false;
+    }
+    std::fclose(truncated);
+    return open(logPath);
+}
+
+//--------------------------------------------------------------
+size_t StoreLog::replay(const std::string& path, VectorStoreBase& store) {
+    MappedFile log;
+    if (!log.open(path, false) || log.size() == 0) {
+        return 0;
+    }
+    if (log.size() < sizeof(LOG_MAGIC) || std::memcmp(log.data(), LOG_MAGIC, sizeof(LOG_MAGIC)) != 0) {
+        ofLogError("StoreLog") << "Not a store log: " << path;
+        return 0;
+    }
+
+    size_t applied = 0;
+    uint64_t offset = sizeof(LOG_MAGIC);
+    while (offset < log.size()) {
+        // Records are packed, so the header is copied out rather than read in place.
+        uint32_t header[3];
+        const uint8_t* raw = log.at<uint8_t>(offset, RECORD_HEADER_SIZE);
+        if (!raw) {
+            break;
+        }
+        std::memcpy(header, raw, RECORD_HEADER_SIZE);
+        const uint8_t* data = log.at<uint8_t>(offset + RECORD_HEADER_SIZE, header[1]);
+        if (!data || checksum(data, header[1]) != header[2]) {
+            break;
+        }
+        PayloadReader payload{data, header[1]};
+        bool ok = true;
+        switch (header[0]) {
+            case RECORD_ADD: {
+                uint32_t count = 0;
+                ok = payload.read(count);
+                std::vector<Embedding> embeddings;
+                std::vector<VectorMetadata> metadata;
+                std::vector<std::string> contents;
+                for (uint32_t i = 0; ok && i < count; ++i) {
+                    VectorMetadata meta;
+                    std::string content;
+                    uint32_t dimension = 0;
+                    int32_t id = 0;
+                    ok = payload.read(id) && payload.readString(meta.source) && payload.readString(meta.type) &&
+                         payload.readString(content) && payload.read(dimension) && dimension <= (payload.size - payload.offset) / sizeof(float);
+                    if (ok) {
+                        meta.id = id;
+                        Embedding embedding(dimension);
+                        payload.readBytes(embedding.data(), dimension * sizeof(float));
+                        embeddings.push_back(std::move(embedding));
+                        metadata.push_back(std::move(meta));
+                        contents.push_back(std::move(content));
+                    }
+                }
+                if (ok) {
+                    // Upsert, so replaying over a snapshot that already has the entry is harmless
+                    for (const auto& meta : metadata) {
+                        store.remove(meta.id);
+                    }
+                    store.addBatch(embeddings, metadata, contents);
+                }
+                break;
+            }
+            case RECORD_REMOVE: {
+                int32_t id = 0;
+                ok = payload.read(id);
+                if (ok) {
+                    store.remove(id);
+                }
+                break;
+            }
+            case RECORD_REMOVE_SOURCE: {
+                std::string source;
+                ok = payload.readString(source);
+                if (ok) {
+                    store.removeBySource(source);
+                }
+                break;
+            }
+            case RECORD_CLEAR:
+                store.clear();
+                break;
+            default:
+                ok = false;
+                break;
+        }
+        if (!ok) {
+            break;
+        }
+        offset += RECORD_HEADER_SIZE + header[1];
+        ++applied;
+    }
+
+    if (offset < log.size()) {
+        // Rewrite the intact prefix so new records do not land behind the damaged one.
+        ofLogWarning("StoreLog") << "Dropping " << log.size() - offset << " damaged bytes at the end of " << path;
+        BinaryWriter writer;
+        if (writer.open(path)) {
+            writer.writeBytes(log.data(), (size_t)offset);
+            log.close();
+            if (!writer.commit()) {
+                ofLogError("StoreLog") << "Could not repair log: " << path;
+            }
+        }
+    }
+    ofLogNotice("StoreLog") << "Replayed " << applied << " log records from: " << path;
+    return applied;
+}
@@ -0,0 +1,65 @@
+/*
+ * ofxRAG
+ *
+ * Copyright (c) 2025 Yannick Hofmann
+ * <contact@yannickhofmann.de>
+ *
+ * BSD Simplified License.
+ * For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ * WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#include "VectorStoreBase.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Append-only log of the changes made to a store since its last snapshot.
+// Every record is length-prefixed and checksummed; a record cut short by a crash
+// is detected on replay and dropped together with anything after it.
+class StoreLog {
+public:
+    StoreLog() = default;
+    ~StoreLog();
+
+    StoreLog(const StoreLog&) = delete;
+    StoreLog& operator=(const StoreLog&) = delete;
+
+    // Opens 'path' for appending, creating it if needed.
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return file != nullptr; }
+    // Bytes in the log, header included.
+    uint64_t size() const { return bytes; }
+
+    // Each call writes one record and flushes it to the OS.
+    bool appendAdd(const std::vector<Embedding>& embeddings, const std::vector<VectorMetadata>& metadata, const std::vector<std::string>& contents);
+    bool appendRemove(int id);
+    bool appendRemoveSource(const std::string& source);
+    bool appendClear();
+
+    // Empties the log after its changes went into a snapshot.
+    bool reset();
+
+    // Applies the records in 'path' to 'store' in order and returns how many were
+    // applied. Adds replace an entry with the same id, so replaying a log over a
+    // snapshot that already contains some of its changes gives the same store.
+    // A damaged tail is cut off the file.
+    static size_t replay(const std::string& path, VectorStoreBase& store);
+
+private:
+    enum RecordType : uint32_t {
+        RECORD_ADD = 1,
+        RECORD_REMOVE = 2,
+        RECORD_REMOVE_SOURCE = 3,
+        RECORD_CLEAR = 4
+    };
+    bool appendRecord(RecordType type, const std::vector<uint8_t>& payload);
+
+    std::FILE* file = nullptr;
+    std::string path;
+    uint64_t bytes = 0;
+};
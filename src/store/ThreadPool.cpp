@@ -0,0 +1,126 @@
+/*
+ * ofxRAG
+ *
+ * Copyright (c) 2025 Yannick Hofmann
+ * <contact@yannickhofmann.de>
+ *
+ * BSD Simplified License.
+ * For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ * WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+//--------------------------------------------------------------
+ThreadPool::ThreadPool(size_t numThreads) {
+    size_t count = resolveThreadCount(numThreads);
+    workers.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        workers.emplace_back([this]() { workerLoop(); });
+    }
+}
+
+//--------------------------------------------------------------
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+//--------------------------------------------------------------
+size_t ThreadPool::resolveThreadCount(size_t requested) {
+    if (requested > 0) {
+        return requested;
+    }
+    return std::max<size_t>(1, std::thread::hardware_concurrency());
+}
+
+//--------------------------------------------------------------
+size_t ThreadPool::getMaxSlots(size_t numTasks) const {
+    return std::max<size_t>(1, std::min(workers.size() + 1, numTasks));
+}
+
+//--------------------------------------------------------------
+void ThreadPool::enqueue(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(std::move(job));
+    }
+    cv.notify_one();
+}
+
+//--------------------------------------------------------------
+void ThreadPool::parallelFor(size_t numTasks, const std::function<void(size_t, size_t)>& fn) {
+    if (numTasks == 0) {
+        return;
+    }
+    if (numTasks == 1 || workers.empty()) {
+        for (size_t i = 0; i < numTasks; ++i) {
+            fn(i, 0);
+        }
+        return;
+    }
+
+    // Shared between the caller and the helpers; helpers that start late only
+    // touch this state, never 'fn', so it is safe for them to outlive the call.
+    struct State {
+        std::atomic<size_t> nextTask{0};
+        std::atomic<size_t> nextSlot{0};
+        size_t done = 0;
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+    auto state = std::make_shared<State>();
+    const size_t total = numTasks;
+
+    auto participate = [state, total, &fn]() {
+        size_t slot = state->nextSlot.fetch_add(1);
+        size_t completed = 0;
+        for (size_t task = state->nextTask.fetch_add(1); task < total; task = state->nextTask.fetch_add(1)) {
+            fn(task, slot);
+            ++completed;
+        }
+        if (completed > 0) {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->done += completed;
+            if (state->done == total) {
+                state->finished.notify_all();
+            }
+        }
+    };
+
+    size_t helpers = getMaxSlots(numTasks) - 1;
+    for (size_t i = 0; i < helpers; ++i) {
+        enqueue(participate);
+    }
+    participate();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&]() { return state->done == total; });
+}
+
+//--------------------------------------------------------------
+void ThreadPool::workerLoop() {
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this]() { return stopping || !jobs.empty(); });
+            if (stopping && jobs.empty()) {
+                return;
+            }
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        job();
+    }
+}
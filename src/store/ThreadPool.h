@@ -0,0 +1,58 @@
+/*
+ * ofxRAG
+ *
+ * Copyright (c) 2025 Yannick Hofmann
+ * <contact@yannickhofmann.de>
+ *
+ * BSD Simplified License.
+ * For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ * WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Small fixed-size worker pool used by the stores to fan work out over cores.
+// Built on std::thread rather than OpenMP so it behaves the same on every
+// platform, whether or not the addon is compiled with -fopenmp.
+class ThreadPool {
+public:
+    // numThreads == 0 uses std::thread::hardware_concurrency().
+    explicit ThreadPool(size_t numThreads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Number of background workers (the calling thread is not counted).
+    size_t getNumThreads() const { return workers.size(); }
+
+    // Upper bound on the 'slot' argument passed by parallelFor, for sizing per-slot state.
+    size_t getMaxSlots(size_t numTasks) const;
+
+    // Runs fn(task, slot) for every task in [0, numTasks) and blocks until all are done.
+    // The calling thread takes part, so this is safe to call from several threads at once.
+    // 'slot' is unique per participating thread within one call and < getMaxSlots(numTasks).
+    void parallelFor(size_t numTasks, const std::function<void(size_t task, size_t slot)>& fn);
+
+    // Queues a fire-and-forget job on a worker thread.
+    void enqueue(std::function<void()> job);
+
+    // Resolves a user-facing thread count setting (0 = all hardware threads).
+    static size_t resolveThreadCount(size_t requested);
+
+private:
+    void workerLoop();
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stopping = false;
+};
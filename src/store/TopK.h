@@ -0,0 +1,89 @@
+/*
+ * ofxRAG
+ *
+ * Copyright (c) 2025 Yannick Hofmann
+ * <contact@yannickhofmann.de>
+ *
+ * BSD Simplified License.
+ * For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ * WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// A scored row index as produced by a store's scan loop.
+struct ScoredRow {
+    float score;
+    int64_t row;
+};
+
+// Bounded top-k selector shared by the vector stores.
+// Keeps the k highest scores seen so far in a min-heap, so a scan costs
+// O(n log k) and never materializes the full similarity array. Stores that
+// rank by distance (smaller is better) push the negated distance.
+class TopKSelector {
+public:
+    explicit TopKSelector(size_t k = 0) { reset(k); }
+
+    // Empties the selector and sets a new capacity.
+    void reset(size_t k) {
+        capacity = k;
+        heap.clear();
+        heap.reserve(k);
+    }
+
+    // Offers a candidate. Cheap rejection once the heap is full.
+    inline void push(float score, int64_t row) {
+        if (heap.size() < capacity) {
+            heap.push_back({score, row});
+            std::push_heap(heap.begin(), heap.end(), worseFirst);
+        } else if (capacity > 0 && better({score, row}, heap.front())) {
+            std::pop_heap(heap.begin(), heap.end(), worseFirst);
+            heap.back() = {score, row};
+            std::push_heap(heap.begin(), heap.end(), worseFirst);
+        }
+    }
+
+    // Lowest score still in the selection, or -infinity while not full.
+    // Scan loops can compare against this to skip work for hopeless candidates.
+    inline float threshold() const {
+        return heap.size() < capacity ? -std::numeric_limits<float>::infinity() : heap.front().score;
+    }
+
+    // Folds another selector's candidates into this one (e.g. per-shard results).
+    void merge(const TopKSelector& other) {
+        for (const auto& item : other.heap) {
+            push(item.score, item.row);
+        }
+    }
+
+    size_t size() const { return heap.size(); }
+    bool empty() const { return heap.empty(); }
+
+    // Returns the selection ordered best first and leaves the selector empty.
+    std::vector<ScoredRow> take() {
+        std::sort_heap(heap.begin(), heap.end(), worseFirst);
+        std::vector<ScoredRow> result;
+        result.swap(heap);
+        heap.reserve(capacity);
+        return result;
+    }
+
+private:
+    // Higher score wins; on ties the lower row index wins, which keeps results deterministic.
+    static bool better(const ScoredRow& a, const ScoredRow& b) {
+        return a.score > b.score || (a.score == b.score && a.row < b.row);
+    }
+    // Heap comparator that puts the worst candidate at the front.
+    static bool worseFirst(const ScoredRow& a, const ScoredRow& b) {
+        return better(a, b);
+    }
+
+    size_t capacity = 0;
+    std::vector<ScoredRow> heap;
+};
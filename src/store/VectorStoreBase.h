@@ -29,6 +29,62 @@ struct SearchResult {
     std::string content;
 };
 
+// A search result that copies nothing: the score plus views into the store's own
+// strings. The views are valid while the SearchHits holding the hit is alive.
+struct SearchHit {
+    int id;
+    float distance; // or similarity score, as in SearchResult
+    size_t row;     // store row; only meaningful until the store is next modified
+    std::string_view source;
+    std::string_view type;
+    std::string_view content;
+
+    VectorMetadata metadata() const { return {id, std::string(source), std::string(type)}; }
+    SearchResult toResult() const { return {metadata(), distance, std::string(content)}; }
+};
+
+// The hits of one query, best first. 'lease' keeps the viewed strings alive, so the
+// hits stay readable even if the store is modified, compacted or cleared meanwhile.
+struct SearchHits {
+    std::vector<SearchHit> hits;
+    std::shared_ptr<const void> lease;
+
+    size_t size() const { return hits.size(); }
+    bool empty() const { return hits.empty(); }
+    const SearchHit& operator[](size_t i) const { return hits[i]; }
+    std::vector<SearchHit>::const_iterator begin() const { return hits.begin(); }
+    std::vector<SearchHit>::const_iterator end() const { return hits.end(); }
+
+    std::vector<SearchResult> toResults() const {
+        std::vector<SearchResult> results;
+        results.reserve(hits.size());
+        for (const auto& hit : hits) {
+            results.push_back(hit.toResult());
+        }
+        return results;
+    }
+};
+
+// Per-document statistics of a store, see VectorStoreBase::getSourceStats().
+struct SourceStats {
+    std::string source; // document source, without a chunk suffix
+    size_t chunks = 0;
+    uint64_t bytes = 0; // content bytes over all chunks
+};
+
+// Restricts a search to a subset of the stored entries. Empty fields don't restrict;
+// all set fields must match. Stores evaluate the filter once per search into a
+// per-row bitmap (MetadataTable::buildMask) that their scan loop checks, so top_k
+// is exact within the subset.
+struct SearchFilter {
+    std::set<std::string> sources;            // document sources, as passed to ofxRAG::addText
+    std::string type;                         // exact type, e.g. "text"
+    std::vector<std::pair<int, int>> idRanges; // inclusive [first, last] id ranges
+
+    bool empty() const { return sources.empty() && type.empty() && idRanges.empty(); }
+    bool matches(const VectorMetadata& metadata) const;
+};
+
 class VectorStoreBase {
 public:
     virtual ~VectorStoreBase() = default;
@@ -36,8 +92,55 @@ public:
     // Adds an embedding, its metadata, and the original text content to the store.
     virtual void add(const Embedding& embedding, const VectorMetadata& metadata, const std::string& content) = 0;
 
-    // Searches the store for the top_k most similar vectors to the query.
-    virtual std::vector<SearchResult> search(const Embedding& query, int top_k) = 0;
+    // Adds several entries at once; the vectors are parallel arrays of equal length.
+    // The default calls add() per entry. Stores override this when they can insert
+    // a batch faster, e.g. in parallel.
+    virtual void addBatch(const std::vector<Embedding>& embeddings, const std::vector<VectorMetadata>& metadata, const std::vector<std::string>& contents) {
+        size_t count = std::min(embeddings.size(), std::min(metadata.size(), contents.size()));
+        for (size_t i = 0; i < count; ++i) {
+            add(embeddings[i], metadata[i], contents[i]);
+        }
+    }
+
+    // Searches the store for the top_k most similar vectors to the query,
+    // considering only entries that pass the filter. The hits view the store's
+    // strings instead of copying them.
+    virtual SearchHits searchHits(const Embedding& query, int top_k, const SearchFilter& filter = SearchFilter()) = 0;
+
+    // Searches for several queries at once; result i belongs to queries[i].
+    // The default runs searchHits() per query. Stores override this when they can
+    // amortize memory traffic across queries.
+    virtual std::vector<SearchHits> searchHitsBatch(const std::vector<Embedding>& queries, int top_k, const SearchFilter& filter = SearchFilter()) {
+        std::vector<SearchHits> results;
+        results.reserve(queries.size());
+        for (const auto& query : queries) {
+            results.push_back(searchHits(query, top_k, filter));
+        }
+        return results;
+    }
+
+    // Looks entries up by metadata id without scoring them: the hits have distance 0
+    // and come in no particular order. Ids that are not stored are skipped.
+    virtual SearchHits getHits(const std::vector<int>& ids) = 0;
+
+    // Owning versions of searchHits()/searchHitsBatch(); every hit's strings are copied.
+    virtual std::vector<SearchResult> search(const Embedding& query, int top_k, const SearchFilter& filter = SearchFilter()) {
+        return searchHits(query, top_k, filter).toResults();
+    }
+    virtual std::vector<std::vector<SearchResult>> searchBatch(const std::vector<Embedding>& queries, int top_k, const SearchFilter& filter = SearchFilter()) {
+        std::vector<std::vector<SearchResult>> results;
+        for (const auto& hits : searchHitsBatch(queries, top_k, filter)) {
+            results.push_back(hits.toResults());
+        }
+        return results;
+    }
+
+    // Removes the entry with the given metadata id. Returns false if there is none.
+    virtual bool remove(int id) = 0;
+
+    // Removes every entry of a source document (as passed to ofxRAG::addText).
+    // Returns the number of removed entries.
+    virtual size_t removeBySource(const std::string& source) = 0;
 
     // Clears all entries from the store.
     virtual void clear() = 0;
@@ -51,4 +154,36 @@ public:
     // Returns the number of items in the store
     virtual size_t size() const = 0;
     virtual std::vector<std::string> getSources() const = 0;
+    // Chunk count and content size of every document, in the order of getSources().
+    // Stores that do not keep them return none.
+    virtual std::vector<SourceStats> getSourceStats() const { return {}; }
+
+    // Largest metadata id in the store, or -1 if it is empty.
+    virtual int getMaxId() const = 0;
+
+    // True when a larger SearchHit::distance means a closer match (similarity scores),
+    // false for real distances such as FAISS's L2. Lets hits from several stores be merged.
+    virtual bool higherIsCloser() const { return true; }
+
+    // Strips the " (chunk ...)" suffix some sources carry, giving the document name.
+    static std::string documentSource(const std::string& source) {
+        size_t pos = source.rfind(" (chunk");
+        return pos == std::string::npos ? source : source.substr(0, pos);
+    }
 };
+
+//--------------------------------------------------------------
+inline bool SearchFilter::matches(const VectorMetadata& metadata) const {
+    if (!type.empty() && metadata.type != type) {
+        return false;
+    }
+    if (!idRanges.empty() && std::none_of(idRanges.begin(), idRanges.end(), [&](const std::pair<int, int>& range) {
+            return metadata.id >= range.first && metadata.id <= range.second;
+        })) {
+        return false;
+    }
+    if (!sources.empty() && !sources.count(metadata.source) && !sources.count(VectorStoreBase::documentSource(metadata.source))) {
+        return false;
+    }
+    return true;
+}
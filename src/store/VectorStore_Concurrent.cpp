@@ -0,0 +1,204 @@
+/*
+ * ofxRAG
+ *
+ * Copyright (c) 2025 Yannick Hofmann
+ * <contact@yannickhofmann.de>
+ *
+ * BSD Simplified License.
+ * For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ * WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include "VectorStore_Concurrent.h"
+
+#include <thread>
+
+//--------------------------------------------------------------
+VectorStore_Concurrent::VectorStore_Concurrent(const Factory& factory) : factory(factory) {
+    replicas[0] = factory();
+    replicas[1] = factory();
+    readers[0].store(0);
+    readers[1].store(0);
+}
+
+//--------------------------------------------------------------
+template <typename Op>
+auto VectorStore_Concurrent::read(Op op) const {
+    // Register on the active replica, then check it is still active: a writer that
+    // swapped in between waits for registered readers, so it would miss this one.
+    int index;
+    while (true) {
+        index = active.load();
+        readers[index].fetch_add(1);
+        if (active.load() == index) {
+            break;
+        }
+        readers[index].fetch_sub(1);
+    }
+    struct Leave {
+        std::atomic<size_t>& count;
+        ~Leave() { count.fetch_sub(1); }
+    } leave{readers[index]};
+    return op(*replicas[index]);
+}
+
+//--------------------------------------------------------------
+void VectorStore_Concurrent::modify(const std::function<void(VectorStoreBase&)>& op) {
+    std::lock_guard<std::mutex> lock(writerMutex);
+    int front = active.load();
+    int back = 1 - front;
+
+    // No reader is on the back replica: change it and make it the one searched.
+    op(*replicas[back]);
+    active.store(back);
+
+    // Readers that entered the old replica before the swap finish on the old state;
+    // once they are gone it can be brought up to date.
+    while (readers[front].load() != 0) {
+        std::this_thread::yield();
+    }
+    op(*replicas[front]);
+}
+
+//--------------------------------------------------------------
+void VectorStore_Concurrent::add(const Embedding& embedding, const VectorMetadata& metadata, const std::string& content) {
+    modify([&](VectorStoreBase& store) {
+        store.add(embedding, metadata, content);
+    });
+}
+
+//--------------------------------------------------------------
+void VectorStore_Concurrent::addBatch(const std::vector<Embedding>& embeddings, const std::vector<VectorMetadata>& metadata, const std::vector<std::string>& contents) {
+    modify([&](VectorStoreBase& store) {
+        store.addBatch(embeddings, metadata, contents);
+    });
+}
+
+//--------------------------------------------------------------
+SearchHits VectorStore_Concurrent::searchHits(const Embedding& query, int top_k, const SearchFilter& filter) {
+    return read([&](VectorStoreBase& store) {
+        return store.searchHits(query, top_k, filter);
+    });
+}
+
+//--------------------------------------------------------------
+std::vector<SearchHits> VectorStore_Concurrent::searchHitsBatch(const std::vector<Embedding>& queries, int top_k, const SearchFilter& filter) {
+    return read([&](VectorStoreBase& store) {
+        return store.searchHitsBatch(queries, top_k, filter);
+    });
+}
+
+//--------------------------------------------------------------
+SearchHits VectorStore_Concurrent::getHits(const std::vector<int>& ids) {
+    return read([&](VectorStoreBase& store) {
+        return store.getHits(ids);
+    });
+}
+
+//--------------------------------------------------------------
+bool VectorStore_Concurrent::remove(int id) {
+    bool removed = false;
+    modify([&](VectorStoreBase& store) {
+        removed = store.remove(id);
+    });
+    return removed;
+}
+
+//--------------------------------------------------------------
+size_t VectorStore_Concurrent::removeBySource(const std::string& source) {
+    size_t removed = 0;
+    modify([&](VectorStoreBase& store) {
+        removed = store.removeBySource(source);
+    });
+    return removed;
+}
+
+//--------------------------------------------------------------
+void VectorStore_Concurrent::clear() {
+    modify([](VectorStoreBase& store) {
+        store.clear();
+    });
+}
+
+//--------------------------------------------------------------
+bool VectorStore_Concurrent::save(const std::string& filepath) {
+    // Saving may compact the store, so it runs on the replica no reader is using.
+    // Both replicas hold the same entries; only their internal layout differs afterwards.
+    std::lock_guard<std::mutex> lock(writerMutex);
+    return replicas[1 - active.load()]->save(filepath);
+}
+
+//--------------------------------------------------------------
+bool VectorStore_Concurrent::load(const std::string& filepath) {
+    std::lock_guard<std::mutex> lock(writerMutex);
+
+    // A store that fails to load may already have cleared itself, so the file is tried
+    // on a spare first: a bad file never reaches the replicas.
+    std::shared_ptr<VectorStoreBase> spare = factory();
+    if (!spare->load(filepath)) {
+        return false;
+    }
+    // A replica that still fails (the file changed or became unreadable meanwhile) is
+    // replaced by the spare, or by a second one once the first is used up.
+    auto loadReplica = [&](int index) {
+        if (replicas[index]->load(filepath)) {
+            return true;
+        }
+        if (!spare) {
+            spare = factory();
+            if (!spare->load(filepath)) {
+                return false;
+            }
+        }
+        ofLogWarning("VectorStore_Concurrent") << "A replica failed to load " << filepath << ", using a spare copy.";
+        replicas[index] = std::move(spare);
+        return true;
+    };
+
+    int front = active.load();
+    int back = 1 - front;
+    loadReplica(back); // cannot fail while the spare is unused
+    active.store(back);
+
+    while (readers[front].load() != 0) {
+        std::this_thread::yield();
+    }
+    if (!loadReplica(front)) {
+        ofLogError("VectorStore_Concurrent") << "Failed to load " << filepath << " into the second replica; the replicas now differ.";
+        return false;
+    }
+    return true;
+}
+
+//--------------------------------------------------------------
+size_t VectorStore_Concurrent::size() const {
+    return read([](VectorStoreBase& store) {
+        return store.size();
+    });
+}
+
+//--------------------------------------------------------------
+std::vector<std::string> VectorStore_Concurrent::getSources() const {
+    return read([](VectorStoreBase& store) {
+        return store.getSources();
+    });
+}
+
+//--------------------------------------------------------------
+std::vector<SourceStats> VectorStore_Concurrent::getSourceStats() const {
+    return read([](VectorStoreBase& store) {
+        return store.getSourceStats();
+    });
+}
+
+//--------------------------------------------------------------
+int VectorStore_Concurrent::getMaxId() const {
+    return read([](VectorStoreBase& store) {
+        return store.getMaxId();
+    });
+}
+
+//--------------------------------------------------------------
+bool VectorStore_Concurrent::higherIsCloser() const {
+    return replicas[0]->higherIsCloser();
+}
@@ -0,0 +1,80 @@
+/*
+ * ofxRAG
+ *
+ * Copyright (c) 2025 Yannick Hofmann
+ * <contact@yannickhofmann.de>
+ *
+ * BSD Simplified License.
+ * For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ * WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#include "VectorStoreBase.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+// Wraps any store so that searches can run on several threads while another thread
+// adds or removes entries, without searches ever waiting for the writer.
+//
+// Two replicas of the wrapped store are kept (left-right concurrency control).
+// Readers always work on the active replica. A writer applies its change to the
+// inactive replica, publishes it as the new active one, waits until the last reader
+// has left the old replica and then replays the change there. A search therefore
+// sees the store either completely before or completely after each write.
+// Writers are serialized; reads are wait-free with respect to them.
+//
+// Memory cost is two full copies of the store. Hits returned by searchHits() hold a
+// lease on the replica's strings, so they stay valid after later writes.
+// Replicas of approximate stores (HNSW) may link their graphs differently and return
+// slightly different neighbours for the same query.
+class VectorStore_Concurrent : public VectorStoreBase {
+public:
+    using Factory = std::function<std::shared_ptr<VectorStoreBase>()>;
+
+    // 'factory' is called twice and must return two identically configured, empty stores.
+    explicit VectorStore_Concurrent(const Factory& factory);
+
+    void add(const Embedding& embedding, const VectorMetadata& metadata, const std::string& content) override;
+    void addBatch(const std::vector<Embedding>& embeddings, const std::vector<VectorMetadata>& metadata, const std::vector<std::string>& contents) override;
+    SearchHits searchHits(const Embedding& query, int top_k, const SearchFilter& filter = SearchFilter()) override;
+    std::vector<SearchHits> searchHitsBatch(const std::vector<Embedding>& queries, int top_k, const SearchFilter& filter = SearchFilter()) override;
+    SearchHits getHits(const std::vector<int>& ids) override;
+    bool remove(int id) override;
+    size_t removeBySource(const std::string& source) override;
+    void clear() override;
+
+    // Saves from the inactive replica, so searches keep running meanwhile.
+    bool save(const std::string& filepath) override;
+    // Loads the file into a spare store from the factory first, so a file that fails to
+    // load leaves the replicas as they are; this briefly needs a third copy in memory.
+    // Each replica then loads the file too. One that still fails (the file changed or
+    // became unreadable meanwhile) is replaced by the spare, which only has the settings
+    // the factory gives it, not ones applied through modify().
+    bool load(const std::string& filepath) override;
+
+    size_t size() const override;
+    std::vector<std::string> getSources() const override;
+    std::vector<SourceStats> getSourceStats() const override;
+    int getMaxId() const override;
+    bool higherIsCloser() const override;
+
+    // Applies 'op' to both replicas as one write; also the way to change store-specific settings:
+    //   store.modify([](VectorStoreBase& s) { static_cast<VectorStore_HNSW&>(s).setEfSearch(128); });
+    void modify(const std::function<void(VectorStoreBase&)>& op);
+
+private:
+    // Runs 'op' on the active replica while registered as one of its readers.
+    template <typename Op>
+    auto read(Op op) const;
+
+    Factory factory;
+    std::shared_ptr<VectorStoreBase> replicas[2];
+    std::atomic<int> active{0};
+    mutable std::atomic<size_t> readers[2];
+    std::mutex writerMutex;
+};
@@ -10,10 +10,56 @@
  */
 
 #include "VectorStore_Cosine.h"
+#include "SimdKernels.h"
+#include "BinaryIO.h"
+
+#include <cstring>
+
+#ifdef USE_BLAS
+// Fortran BLAS entry point; provided by the BLAS that FAISS links
+// (libblas/OpenBLAS on Linux, Accelerate on macOS).
+extern "C" void sgemm_(const char* transa, const char* transb, const int* m, const int* n, const int* k,
+                       const float* alpha, const float* a, const int* lda, const float* b, const int* ldb,
+                       const float* beta, float* c, const int* ldc);
+#endif
+
+namespace {
+
+// Binary store layout (native endianness):
+//   header | pad to 64 | rows (count x stride floats, unit-normalized) | norms (count floats)
+//   | pad to 8 | row records (count) | string blob (each distinct source/type once, then the contents)
+const char COSINE_STORE_MAGIC[8] = {'O', 'F', 'X', 'R', 'A', 'G', 'C', 'S'};
+const uint32_t COSINE_STORE_VERSION = 1;
+
+struct CosineStoreHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t count;
+    uint64_t dimension;
+    uint64_t stride;
+    uint64_t matrixOffset;
+    uint64_t normsOffset;
+    uint64_t recordsOffset;
+    uint64_t stringsOffset;
+    uint64_t stringsSize;
+};
+
+struct CosineRowRecord {
+    int64_t id;
+    uint64_t sourceOffset;
+    uint64_t sourceLength;
+    uint64_t typeOffset;
+    uint64_t typeLength;
+    uint64_t contentOffset;
+    uint64_t contentLength;
+};
+
+} // namespace
 
 //--------------------------------------------------------------
 VectorStore_Cosine::VectorStore_Cosine() {
-    ofLogNotice("VectorStore_Cosine") << "Initialized in-memory cosine vector store.";
+    ofLogNotice("VectorStore_Cosine") << "Initialized in-memory cosine vector store (dot product kernel: " << ofxragSimdKernelName() << ").";
 }
 
 //--------------------------------------------------------------
@@ -27,20 +73,29 @@ void VectorStore_Cosine::add(const Embedding& embedding, const VectorMetadata& m
         ofLogWarning("VectorStore_Cosine") << "Attempted to add empty embedding.";
         return;
     }
-    if (!embeddings.empty() && embedding.size() != embeddings[0].size()) {
-        ofLogWarning("VectorStore_Cosine") << "Embedding dimension mismatch. Expected " << embeddings[0].size() << ", got " << embedding.size();
+    if (dimension != 0 && embedding.size() != dimension) {
+        ofLogWarning("VectorStore_Cosine") << "Embedding dimension mismatch. Expected " << dimension << ", got " << embedding.size();
         return;
     }
-    embeddings.push_back(embedding);
-    metadata.push_back(meta);
-    contents.push_back(content);
-    ofLogVerbose("VectorStore_Cosine") << "Added embedding with ID: " << meta.id << ", current size: " << embeddings.size();
+    if (dimension == 0) {
+        dimension = embedding.size();
+        stride = ofxragPaddedStride(dimension);
+    }
+    // Re-adding an existing id replaces the old entry.
+    auto existing = idToRow.find(meta.id);
+    if (existing != idToRow.end()) {
+        markDeleted(existing->second);
+    }
+    appendRow(embedding.data());
+    idToRow[meta.id] = entries.append(meta, content);
+    deleted.push_back(0);
+    ofLogVerbose("VectorStore_Cosine") << "Added embedding with ID: " << meta.id << ", current size: " << norms.size();
 }
 
 //--------------------------------------------------------------
-std::vector<SearchResult> VectorStore_Cosine::search(const Embedding& query, int top_k) {
-    std::vector<SearchResult> results;
-    if (embeddings.empty()) {
+SearchHits VectorStore_Cosine::searchHits(const Embedding& query, int top_k, const SearchFilter& filter) {
+    SearchHits results;
+    if (size() == 0) {
         ofLogNotice("VectorStore_Cosine") << "Store is empty, no search results.";
         return results;
     }
@@ -48,74 +103,228 @@ std::vector<SearchResult> VectorStore_Cosine::search(const Embedding& query, int
         ofLogWarning("VectorStore_Cosine") << "Query embedding is empty.";
         return results;
     }
-    if (query.size() != embeddings[0].size()) {
-        ofLogWarning("VectorStore_Cosine") << "Query embedding dimension mismatch. Expected " << embeddings[0].size() << ", got " << query.size();
+    if (query.size() != dimension) {
+        ofLogWarning("VectorStore_Cosine") << "Query embedding dimension mismatch. Expected " << dimension << ", got " << query.size();
         return results;
     }
 
-    std::vector<std::pair<float, int>> similarities; // pair: (similarity, index)
-
-    for (size_t i = 0; i < embeddings.size(); ++i) {
-        float sim = cosineSimilarity(query, embeddings[i]);
-        similarities.push_back({sim, i});
+    std::vector<uint8_t> allowed;
+    size_t candidates = 0;
+    const uint8_t* mask = filterMask(filter, allowed, candidates);
+    if (candidates == 0) {
+        return results;
     }
 
-    // Sort by similarity in descending order
-    std::sort(similarities.rbegin(), similarities.rend());
+    AlignedFloatVector q;
+    prepareQuery(query, q);
+
+    // Scan fused with a bounded top-k heap; the full similarity array is never built.
+    size_t k = std::min<size_t>(std::max(top_k, 0), candidates);
+    TopKSelector selector(k);
+    size_t count = norms.size();
+    size_t threads = ThreadPool::resolveThreadCount(numThreads);
 
-    // Collect top_k results
-    for (int i = 0; i < std::min((int)similarities.size(), top_k); ++i) {
-        SearchResult res;
-        res.metadata = metadata[similarities[i].second];
-        res.distance = similarities[i].first; // Using similarity as distance for now
-        res.content = contents[similarities[i].second];
-        results.push_back(res);
+    if (threads <= 1 || count < parallelThreshold) {
+        scanRows(q.data(), 0, count, mask, selector);
+    } else {
+        // Split the matrix into cache-sized shards, scan them on the pool with one
+        // heap per participating thread, then merge the per-thread heaps.
+        std::shared_ptr<ThreadPool> pool = getThreadPool(threads);
+        size_t rowsPerShard = shardRows();
+        size_t numShards = (count + rowsPerShard - 1) / rowsPerShard;
+        std::vector<TopKSelector> partial(pool->getMaxSlots(numShards), TopKSelector(k));
+        pool->parallelFor(numShards, [&](size_t shard, size_t slot) {
+            size_t begin = shard * rowsPerShard;
+            scanRows(q.data(), begin, std::min(begin + rowsPerShard, count), mask, partial[slot]);
+        });
+        for (const auto& heap : partial) {
+            selector.merge(heap);
+        }
     }
-    
+
+    // Collect top_k results, best first
+    results = makeHits(selector.take());
     ofLogVerbose("VectorStore_Cosine") << "Search completed, found " << results.size() << " results.";
     return results;
 }
 
+//--------------------------------------------------------------
+std::vector<SearchHits> VectorStore_Cosine::searchHitsBatch(const std::vector<Embedding>& queries, int top_k, const SearchFilter& filter) {
+    std::vector<SearchHits> results(queries.size());
+    if (size() == 0 || queries.empty()) {
+        return results;
+    }
+    for (const auto& query : queries) {
+        if (query.size() != dimension) {
+            ofLogWarning("VectorStore_Cosine") << "Batch query dimension mismatch. Expected " << dimension << ", got " << query.size();
+            return results;
+        }
+    }
+
+    std::vector<uint8_t> allowed;
+    size_t candidates = 0;
+    const uint8_t* mask = filterMask(filter, allowed, candidates);
+    if (candidates == 0) {
+        return results;
+    }
+
+    // Pack the normalized queries into one row-major block with the same stride as the store.
+    size_t nq = queries.size();
+    AlignedFloatVector packed(nq * stride, 0.0f);
+    AlignedFloatVector q;
+    for (size_t i = 0; i < nq; ++i) {
+        prepareQuery(queries[i], q);
+        std::copy(q.begin(), q.end(), packed.begin() + i * stride);
+    }
+
+    size_t k = std::min<size_t>(std::max(top_k, 0), candidates);
+    size_t count = norms.size();
+    size_t rowsPerShard = shardRows();
+    size_t numShards = (count + rowsPerShard - 1) / rowsPerShard;
+    size_t threads = ThreadPool::resolveThreadCount(numThreads);
+    bool parallel = threads > 1 && count * nq >= parallelThreshold && numShards > 1;
+
+    // One heap per (participating thread, query); merged per query at the end.
+    std::shared_ptr<ThreadPool> pool = parallel ? getThreadPool(threads) : nullptr;
+    size_t slots = pool ? pool->getMaxSlots(numShards) : 1;
+    std::vector<TopKSelector> partial(slots * nq, TopKSelector(k));
+    std::vector<std::vector<float>> scratch(slots);
+
+    auto scanShard = [&](size_t shard, size_t slot) {
+        size_t begin = shard * rowsPerShard;
+        scanRowsBatch(packed.data(), nq, begin, std::min(begin + rowsPerShard, count), mask, &partial[slot * nq], scratch[slot]);
+    };
+    if (parallel) {
+        pool->parallelFor(numShards, scanShard);
+    } else {
+        for (size_t shard = 0; shard < numShards; ++shard) {
+            scanShard(shard, 0);
+        }
+    }
+
+    for (size_t i = 0; i < nq; ++i) {
+        TopKSelector selector(k);
+        for (size_t slot = 0; slot < slots; ++slot) {
+            selector.merge(partial[slot * nq + i]);
+        }
+        results[i] = makeHits(selector.take());
+    }
+    ofLogVerbose("VectorStore_Cosine") << "Batch search completed for " << nq << " queries.";
+    return results;
+}
+
+//--------------------------------------------------------------
+SearchHits VectorStore_Cosine::getHits(const std::vector<int>& ids) {
+    SearchHits results;
+    for (int id : ids) {
+        auto it = idToRow.find(id);
+        if (it != idToRow.end()) {
+            results.hits.push_back(entries.hit(it->second, 0.0f));
+        }
+    }
+    results.lease = entries.lease();
+    return results;
+}
+
+//--------------------------------------------------------------
+bool VectorStore_Cosine::remove(int id) {
+    auto it = idToRow.find(id);
+    if (it == idToRow.end()) {
+        return false;
+    }
+    markDeleted(it->second);
+    compactIfNeeded();
+    return true;
+}
+
+//--------------------------------------------------------------
+size_t VectorStore_Cosine::removeBySource(const std::string& source) {
+    size_t removed = 0;
+    for (size_t row : entries.rowsOf(source)) {
+        if (!deleted[row]) {
+            markDeleted(row);
+            ++removed;
+        }
+    }
+    if (removed > 0) {
+        ofLogNotice("VectorStore_Cosine") << "Removed " << removed << " entries of source: " << source;
+        compactIfNeeded();
+    }
+    return removed;
+}
+
 //--------------------------------------------------------------
 void VectorStore_Cosine::clear() {
-    embeddings.clear();
-    metadata.clear();
-    contents.clear();
+    dimension = 0;
+    stride = 0;
+    matrix.clear();
+    rows = nullptr;
+    mapping.reset();
+    norms.clear();
+    entries.clear();
+    idToRow.clear();
+    deleted.clear();
+    deletedCount = 0;
     ofLogNotice("VectorStore_Cosine") << "Store cleared.";
 }
 
 //--------------------------------------------------------------
 bool VectorStore_Cosine::save(const std::string& filepath) {
+    compact(); // only live rows are written
+    if (ofToLower(ofFilePath::getFileExt(filepath)) == "json") {
+        return exportJson(filepath);
+    }
+    return saveBinary(filepath);
+}
+
+//--------------------------------------------------------------
+bool VectorStore_Cosine::load(const std::string& filepath) {
+    char magic[sizeof(CosineStoreHeader::magic)] = {};
+    std::ifstream probe(filepath, std::ios::binary);
+    if (probe.read(magic, sizeof(magic)) && std::memcmp(magic, COSINE_STORE_MAGIC, sizeof(magic)) == 0) {
+        probe.close();
+        return loadBinary(filepath);
+    }
+    probe.close();
+    return importJson(filepath);
+}
+
+//--------------------------------------------------------------
+void VectorStore_Cosine::setMemoryMapping(bool enabled) {
+    useMemoryMapping = enabled;
+}
+
+//--------------------------------------------------------------
+bool VectorStore_Cosine::exportJson(const std::string& filepath) const {
     ofJson storeJson;
-    storeJson["count"] = embeddings.size();
+    storeJson["count"] = size();
     
     ofJson embeddingsJson = ofJson::array();
-    for(const auto& emb : embeddings) {
-        embeddingsJson.push_back(emb);
-    }
-    storeJson["embeddings"] = embeddingsJson;
-
     ofJson metadataJson = ofJson::array();
-    for(const auto& meta : metadata) {
+    ofJson contentsJson = ofJson::array();
+    for(size_t i = 0; i < norms.size(); ++i) {
+        if (deleted[i]) {
+            continue;
+        }
+        embeddingsJson.push_back(rowEmbedding(i));
+
         ofJson metaItem;
-        metaItem["id"] = meta.id;
-        metaItem["source"] = meta.source;
-        metaItem["type"] = meta.type;
+        metaItem["id"] = entries.id(i);
+        metaItem["source"] = entries.source(i);
+        metaItem["type"] = entries.type(i);
         metadataJson.push_back(metaItem);
-    }
-    storeJson["metadata"] = metadataJson;
 
-    ofJson contentsJson = ofJson::array();
-    for(const auto& content : contents) {
-        contentsJson.push_back(content);
+        contentsJson.push_back(std::string(entries.content(i)));
     }
+    storeJson["embeddings"] = embeddingsJson;
+    storeJson["metadata"] = metadataJson;
     storeJson["contents"] = contentsJson;
 
     return ofSaveJson(filepath, storeJson);
 }
 
 //--------------------------------------------------------------
-bool VectorStore_Cosine::load(const std::string& filepath) {
+bool VectorStore_Cosine::importJson(const std::string& filepath) {
     ofJson storeJson; // Re-declare storeJson
     storeJson = ofLoadJson(filepath);
     if (storeJson.empty()) {
@@ -126,91 +335,437 @@ bool VectorStore_Cosine::load(const std::string& filepath) {
     clear(); // Clear existing data before loading
 
     size_t count = storeJson["count"].get<size_t>();
-    embeddings.reserve(count);
-    metadata.reserve(count);
-    contents.reserve(count);
+    entries.reserve(count);
 
-    ofJson embeddingsJson = storeJson["embeddings"];
+    const ofJson& embeddingsJson = storeJson["embeddings"];
+    Embedding emb;
     for(const auto& embJson : embeddingsJson) {
-        Embedding emb = embJson.get<Embedding>();
-        embeddings.push_back(emb);
+        embJson.get_to(emb);
+        if (emb.empty() || (dimension != 0 && emb.size() != dimension)) {
+            ofLogError("VectorStore_Cosine") << "Inconsistent embedding dimension in " << filepath;
+            clear();
+            return false;
+        }
+        if (dimension == 0) {
+            dimension = emb.size();
+            stride = ofxragPaddedStride(dimension);
+            matrix.reserve(count * stride);
+            norms.reserve(count);
+        }
+        appendRow(emb.data());
+    }
+
+    const ofJson& metadataJson = storeJson["metadata"];
+    // for backwards compatibility, if contents are not present, use the source from metadata
+    bool hasContents = storeJson.contains("contents");
+    if (metadataJson.size() != norms.size() || (hasContents && storeJson["contents"].size() != norms.size())) {
+        ofLogError("VectorStore_Cosine") << "Embedding, metadata and content counts differ in " << filepath;
+        clear();
+        return false;
+    }
+    for (size_t i = 0; i < metadataJson.size(); ++i) {
+        const ofJson& metaJson = metadataJson[i];
+        std::string source = metaJson["source"].get<std::string>();
+        std::string content = hasContents ? storeJson["contents"][i].get<std::string>() : source;
+        size_t row = entries.append(metaJson["id"].get<int>(), source, metaJson["type"].get<std::string>(), content);
+        idToRow[entries.id(row)] = row;
+    }
+    deleted.assign(norms.size(), 0);
+    
+    ofLogNotice("VectorStore_Cosine") << "Loaded " << count << " items from " << filepath;
+    return true;
+}
+
+//--------------------------------------------------------------
+bool VectorStore_Cosine::saveBinary(const std::string& filepath) const {
+    size_t count = norms.size();
+    BinaryWriter writer;
+    if (!writer.open(filepath)) {
+        ofLogError("VectorStore_Cosine") << "Cannot open " << filepath << " for writing.";
+        return false;
     }
 
-    ofJson metadataJson = storeJson["metadata"];
-    for(const auto& metaJson : metadataJson) {
-        VectorMetadata meta;
-        meta.id = metaJson["id"].get<int>();
-        meta.source = metaJson["source"].get<std::string>();
-        meta.type = metaJson["type"].get<std::string>();
-        metadata.push_back(meta);
+    // Header first; offsets are patched in once the sections are written.
+    CosineStoreHeader header = {};
+    std::memcpy(header.magic, COSINE_STORE_MAGIC, sizeof(header.magic));
+    header.version = COSINE_STORE_VERSION;
+    header.headerSize = sizeof(CosineStoreHeader);
+    header.count = count;
+    header.dimension = dimension;
+    header.stride = stride;
+    writer.write(header);
+
+    // Rows are written with their padding so the mapped block can be scanned directly.
+    writer.pad(64);
+    header.matrixOffset = writer.tell();
+    writer.writeBytes(rows, count * stride * sizeof(float));
+
+    header.normsOffset = writer.tell();
+    writer.writeBytes(norms.data(), count * sizeof(float));
+
+    // Offset table: one fixed-size record per row pointing into the string blob.
+    writer.pad(8);
+    header.recordsOffset = writer.tell();
+    std::vector<uint64_t> contentOffsets = entries.contentBlobOffsets();
+    // Rows of the same source share one copy of its string.
+    for (size_t i = 0; i < count; ++i) {
+        CosineRowRecord record = {};
+        record.id = entries.id(i);
+        record.sourceOffset = entries.sourceBlobOffset(i);
+        record.sourceLength = entries.source(i).size();
+        record.typeOffset = entries.typeBlobOffset(i);
+        record.typeLength = entries.type(i).size();
+        record.contentOffset = contentOffsets[i];
+        record.contentLength = entries.contentLength(i);
+        writer.write(record);
     }
 
-    if (storeJson.contains("contents")) {
-        ofJson contentsJson = storeJson["contents"];
-        for(const auto& contentJson : contentsJson) {
-            std::string content = contentJson.get<std::string>();
-            contents.push_back(content);
+    header.stringsOffset = writer.tell();
+    header.stringsSize = entries.blobSize();
+    entries.writeBlob(writer);
+
+    writer.patch(0, header);
+    if (!writer.commit()) {
+        ofLogError("VectorStore_Cosine") << "Failed to write binary store to " << filepath;
+        return false;
+    }
+    ofLogNotice("VectorStore_Cosine") << "Saved " << count << " items (binary) to " << filepath;
+    return true;
+}
+
+//--------------------------------------------------------------
+bool VectorStore_Cosine::loadBinary(const std::string& filepath) {
+    auto file = std::make_unique<MappedFile>();
+    if (!file->open(filepath, useMemoryMapping)) {
+        ofLogError("VectorStore_Cosine") << "Failed to open binary store " << filepath;
+        return false;
+    }
+
+    const CosineStoreHeader* header = file->at<CosineStoreHeader>(0);
+    if (!header || header->version != COSINE_STORE_VERSION || header->headerSize != sizeof(CosineStoreHeader)) {
+        ofLogError("VectorStore_Cosine") << "Unsupported binary store version in " << filepath;
+        return false;
+    }
+    uint64_t count = header->count;
+    const float* mappedRows = file->at<float>(header->matrixOffset, count * header->stride);
+    const float* mappedNorms = file->at<float>(header->normsOffset, count);
+    const CosineRowRecord* records = file->at<CosineRowRecord>(header->recordsOffset, count);
+    const char* strings = file->at<char>(header->stringsOffset, header->stringsSize);
+    if ((count > 0 && (!mappedRows || !mappedNorms || !records || !strings)) ||
+        header->stride != ofxragPaddedStride(header->dimension)) {
+        ofLogError("VectorStore_Cosine") << "Binary store " << filepath << " is truncated or corrupt.";
+        return false;
+    }
+
+    clear(); // Clear existing data before loading
+
+    dimension = header->dimension;
+    stride = header->stride;
+    norms.assign(mappedNorms, mappedNorms + count);
+    // With disk contents only the rows are built here; contents are read from the file on demand.
+    std::shared_ptr<MappedFile> contentFile;
+    if (diskContents) {
+        contentFile = std::make_shared<MappedFile>();
+        if (!contentFile->open(filepath)) {
+            ofLogError("VectorStore_Cosine") << "Failed to map contents of " << filepath;
+            clear();
+            return false;
         }
-    } else {
-        // for backwards compatibility, if contents are not present, use the source from metadata
-        for(const auto& meta : metadata) {
-            contents.push_back(meta.source);
+        entries.setContentFile(contentFile);
+    }
+    entries.reserve(count, contentFile ? 0 : header->stringsSize);
+    uint64_t blobSize = header->stringsSize;
+    auto inBlob = [blobSize](uint64_t offset, uint64_t length) {
+        return offset <= blobSize && length <= blobSize - offset;
+    };
+    for (uint64_t i = 0; i < count; ++i) {
+        const CosineRowRecord& record = records[i];
+        if (!inBlob(record.sourceOffset, record.sourceLength) || !inBlob(record.typeOffset, record.typeLength) ||
+            !inBlob(record.contentOffset, record.contentLength)) {
+            ofLogError("VectorStore_Cosine") << "Binary store " << filepath << " has an invalid string table.";
+            clear();
+            return false;
+        }
+        std::string_view source(strings + record.sourceOffset, record.sourceLength);
+        std::string_view type(strings + record.typeOffset, record.typeLength);
+        if (contentFile) {
+            entries.appendMapped((int)record.id, source, type, header->stringsOffset + record.contentOffset, (uint32_t)record.contentLength);
+        } else {
+            entries.append((int)record.id, source, type, std::string_view(strings + record.contentOffset, record.contentLength));
         }
+        idToRow[(int)record.id] = (size_t)i;
     }
-    
-    ofLogNotice("VectorStore_Cosine") << "Loaded " << count << " items from " << filepath;
+    deleted.assign(count, 0);
+
+    // The float block is used in place; it is only copied if the store is modified later.
+    mapping = std::move(file);
+    rows = mappedRows;
+
+    ofLogNotice("VectorStore_Cosine") << "Loaded " << count << " items (binary" << (mapping->isMapped() ? ", memory-mapped" : "") << ") from " << filepath;
     return true;
 }
 
+//--------------------------------------------------------------
+void VectorStore_Cosine::detachMapping() {
+    if (!mapping) {
+        return;
+    }
+    matrix.assign(rows, rows + norms.size() * stride);
+    rows = matrix.data();
+    mapping.reset();
+}
+
 //--------------------------------------------------------------
 size_t VectorStore_Cosine::size() const {
-    return embeddings.size();
+    return norms.size() - deletedCount;
 }
 
 //--------------------------------------------------------------
 std::vector<std::string> VectorStore_Cosine::getSources() const {
-    std::vector<std::string> sources;
-    std::set<std::string> unique_sources;
-    for (const auto& meta : metadata) {
-        std::string source = meta.source;
-        size_t pos = source.rfind(" (chunk");
-        if (pos != std::string::npos) {
-            source = source.substr(0, pos);
+    return entries.documentSources();
+}
+
+//--------------------------------------------------------------
+std::vector<SourceStats> VectorStore_Cosine::getSourceStats() const {
+    return entries.documentStats();
+}
+
+//--------------------------------------------------------------
+int VectorStore_Cosine::getMaxId() const {
+    int maxId = -1;
+    for (const auto& entry : idToRow) {
+        maxId = std::max(maxId, entry.first);
+    }
+    return maxId;
+}
+
+//--------------------------------------------------------------
+void VectorStore_Cosine::compact() {
+    if (deletedCount == 0) {
+        return;
+    }
+    size_t live = size();
+    AlignedFloatVector compacted;
+    compacted.reserve(live * stride);
+    std::vector<float> keptNorms;
+    keptNorms.reserve(live);
+
+    for (size_t i = 0; i < norms.size(); ++i) {
+        if (deleted[i]) {
+            continue;
         }
-        if (unique_sources.find(source) == unique_sources.end()) {
-            sources.push_back(source);
-            unique_sources.insert(source);
+        compacted.insert(compacted.end(), rows + i * stride, rows + (i + 1) * stride);
+        keptNorms.push_back(norms[i]);
+    }
+
+    matrix.swap(compacted);
+    rows = matrix.data();
+    mapping.reset();
+    norms.swap(keptNorms);
+    entries.compact(deleted);
+
+    idToRow.clear();
+    for (size_t i = 0; i < entries.size(); ++i) {
+        idToRow[entries.id(i)] = i;
+    }
+    deleted.assign(norms.size(), 0);
+    ofLogVerbose("VectorStore_Cosine") << "Compacted store, dropped " << deletedCount << " removed rows.";
+    deletedCount = 0;
+}
+
+//--------------------------------------------------------------
+void VectorStore_Cosine::setCompactionRatio(float ratio) {
+    compactionRatio = ratio;
+}
+
+//--------------------------------------------------------------
+void VectorStore_Cosine::markDeleted(size_t row) {
+    if (deleted[row]) {
+        return;
+    }
+    deleted[row] = 1;
+    ++deletedCount;
+    idToRow.erase(entries.id(row));
+    entries.releaseContent(row);
+}
+
+//--------------------------------------------------------------
+void VectorStore_Cosine::compactIfNeeded() {
+    if (deletedCount > 0 && deletedCount >= compactionRatio * norms.size()) {
+        compact();
+    }
+}
+
+//--------------------------------------------------------------
+void VectorStore_Cosine::setNumThreads(size_t numThreads) {
+    this->numThreads = numThreads;
+    std::lock_guard<std::mutex> lock(poolMutex);
+    threadPool.reset(); // recreated with the new size on the next parallel search
+}
+
+//--------------------------------------------------------------
+size_t VectorStore_Cosine::getNumThreads() const {
+    return ThreadPool::resolveThreadCount(numThreads);
+}
+
+//--------------------------------------------------------------
+void VectorStore_Cosine::setDiskContents(bool enabled) {
+    diskContents = enabled;
+}
+
+//--------------------------------------------------------------
+bool VectorStore_Cosine::getDiskContents() const {
+    return diskContents;
+}
+
+//--------------------------------------------------------------
+void VectorStore_Cosine::setParallelThreshold(size_t minRows) {
+    parallelThreshold = minRows;
+}
+
+//--------------------------------------------------------------
+size_t VectorStore_Cosine::getParallelThreshold() const {
+    return parallelThreshold;
+}
+
+//--------------------------------------------------------------
+const uint8_t* VectorStore_Cosine::filterMask(const SearchFilter& filter, std::vector<uint8_t>& allowed, size_t& count) const {
+    if (filter.empty()) {
+        count = size();
+        return nullptr;
+    }
+    count = entries.buildMask(filter, deleted, allowed);
+    return allowed.data();
+}
+
+//--------------------------------------------------------------
+void VectorStore_Cosine::scanRows(const float* query, size_t begin, size_t end, const uint8_t* allowed, TopKSelector& selector) const {
+    const float* row = rows + begin * stride;
+    if (allowed) {
+        for (size_t i = begin; i < end; ++i, row += stride) {
+            if (allowed[i]) {
+                selector.push(ofxragDotProduct(query, row, stride), (int64_t)i);
+            }
+        }
+        return;
+    }
+    if (deletedCount == 0) {
+        for (size_t i = begin; i < end; ++i, row += stride) {
+            selector.push(ofxragDotProduct(query, row, stride), (int64_t)i);
+        }
+        return;
+    }
+    for (size_t i = begin; i < end; ++i, row += stride) {
+        if (!deleted[i]) {
+            selector.push(ofxragDotProduct(query, row, stride), (int64_t)i);
         }
     }
-    return sources;
 }
 
 //--------------------------------------------------------------
-float VectorStore_Cosine::cosineSimilarity(const Embedding& v1, const Embedding& v2) {
-    if (v1.empty() || v2.empty() || v1.size() != v2.size()) {
-        return 0.0f; // Or throw an error
+void VectorStore_Cosine::scanRowsBatch(const float* queries, size_t nq, size_t begin, size_t end, const uint8_t* allowed, TopKSelector* selectors, std::vector<float>& scratch) const {
+    // Queries are processed in blocks so a block plus the shard stays in cache,
+    // and each score tile is (rows x queries) as produced by one GEMM call.
+    const size_t queryBlock = 64;
+    size_t rowCount = end - begin;
+    scratch.resize(rowCount * std::min(nq, queryBlock));
+    const float* shard = rows + begin * stride;
+
+    for (size_t q0 = 0; q0 < nq; q0 += queryBlock) {
+        size_t qn = std::min(queryBlock, nq - q0);
+        const float* block = queries + q0 * stride;
+#ifdef USE_BLAS
+        // Column-major view: C (rowCount x qn) = shard (rowCount x d) * block^T (d x qn).
+        const char transA = 'T', transB = 'N';
+        const int m = (int)rowCount, n = (int)qn, kDim = (int)dimension, ld = (int)stride;
+        const float alpha = 1.0f, beta = 0.0f;
+        sgemm_(&transA, &transB, &m, &n, &kDim, &alpha, shard, &ld, block, &ld, &beta, scratch.data(), &m);
+#else
+        // Row-outer loop keeps each row in L1 while it meets every query of the block.
+        const float* row = shard;
+        for (size_t r = 0; r < rowCount; ++r, row += stride) {
+            for (size_t j = 0; j < qn; ++j) {
+                scratch[j * rowCount + r] = ofxragDotProduct(block + j * stride, row, stride);
+            }
+        }
+#endif
+        for (size_t j = 0; j < qn; ++j) {
+            const float* scores = scratch.data() + j * rowCount;
+            TopKSelector& selector = selectors[q0 + j];
+            for (size_t r = 0; r < rowCount; ++r) {
+                bool live = allowed ? allowed[begin + r] != 0 : (deletedCount == 0 || !deleted[begin + r]);
+                if (live) {
+                    selector.push(scores[r], (int64_t)(begin + r));
+                }
+            }
+        }
     }
+}
 
-    float dotProduct = 0.0f;
-    for (size_t i = 0; i < v1.size(); ++i) {
-        dotProduct += v1[i] * v2[i];
+//--------------------------------------------------------------
+std::shared_ptr<ThreadPool> VectorStore_Cosine::getThreadPool(size_t threads) {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    if (!threadPool || threadPool->getNumThreads() != threads - 1) {
+        threadPool = std::make_shared<ThreadPool>(threads - 1);
     }
+    return threadPool;
+}
 
-    float mag1 = magnitude(v1);
-    float mag2 = magnitude(v2);
+//--------------------------------------------------------------
+SearchHits VectorStore_Cosine::makeHits(const std::vector<ScoredRow>& best) const {
+    SearchHits results;
+    results.hits.reserve(best.size());
+    for (const auto& hit : best) {
+        results.hits.push_back(entries.hit(hit.row, hit.score)); // Using similarity as distance for now
+    }
+    results.lease = entries.lease();
+    return results;
+}
+
+//--------------------------------------------------------------
+size_t VectorStore_Cosine::shardRows() const {
+    const size_t shardBytes = 256 * 1024;
+    return std::max<size_t>(64, shardBytes / (stride * sizeof(float)));
+}
+
+//--------------------------------------------------------------
+void VectorStore_Cosine::appendRow(const float* values) {
+    detachMapping();
+    size_t offset = matrix.size();
+    matrix.resize(offset + stride, 0.0f);
+    rows = matrix.data();
+    float* row = matrix.data() + offset;
 
-    if (mag1 == 0.0f || mag2 == 0.0f) {
-        return 0.0f;
+    float norm = std::sqrt(ofxragDotProduct(values, values, dimension));
+    norms.push_back(norm);
+    if (norm == 0.0f) {
+        return; // zero vectors stay zero and score 0 against every query
     }
+    float inv = 1.0f / norm;
+    for (size_t i = 0; i < dimension; ++i) {
+        row[i] = values[i] * inv;
+    }
+}
 
-    return dotProduct / (mag1 * mag2);
+//--------------------------------------------------------------
+void VectorStore_Cosine::prepareQuery(const Embedding& query, AlignedFloatVector& out) const {
+    out.assign(stride, 0.0f);
+    float norm = std::sqrt(ofxragDotProduct(query.data(), query.data(), dimension));
+    if (norm == 0.0f) {
+        return;
+    }
+    float inv = 1.0f / norm;
+    for (size_t i = 0; i < dimension; ++i) {
+        out[i] = query[i] * inv;
+    }
 }
 
 //--------------------------------------------------------------
-float VectorStore_Cosine::magnitude(const Embedding& v) {
-    float sumSq = 0.0f;
-    for (float val : v) {
-        sumSq += val * val;
+Embedding VectorStore_Cosine::rowEmbedding(size_t row) const {
+    const float* values = rows + row * stride;
+    Embedding emb(values, values + dimension);
+    for (auto& v : emb) {
+        v *= norms[row];
     }
-    return std::sqrt(sumSq);
+    return emb;
 }
@@ -12,28 +12,121 @@
 #pragma once
 
 #include "VectorStoreBase.h"
+#include "AlignedBuffer.h"
+#include "MappedFile.h"
+#include "MetadataTable.h"
+#include "ThreadPool.h"
+#include "TopK.h"
 #include "ofJson.h"
 
+#include <mutex>
+#include <unordered_map>
+
 class VectorStore_Cosine : public VectorStoreBase {
 public:
     VectorStore_Cosine();
     ~VectorStore_Cosine() override;
 
     void add(const Embedding& embedding, const VectorMetadata& metadata, const std::string& content) override;
-    std::vector<SearchResult> search(const Embedding& query, int top_k) override;
+    SearchHits searchHits(const Embedding& query, int top_k, const SearchFilter& filter = SearchFilter()) override;
+    std::vector<SearchHits> searchHitsBatch(const std::vector<Embedding>& queries, int top_k, const SearchFilter& filter = SearchFilter()) override;
+    SearchHits getHits(const std::vector<int>& ids) override;
+    bool remove(int id) override;
+    size_t removeBySource(const std::string& source) override;
     void clear() override;
+
+    // Saves in the binary format, or as JSON if the path ends in ".json".
     bool save(const std::string& filepath) override;
+    // Loads either format; binary stores are memory-mapped and searched in place
+    // unless memory mapping is disabled.
     bool load(const std::string& filepath) override;
+
+    // JSON import/export, kept for interchange and for stores saved by older versions.
+    bool exportJson(const std::string& filepath) const;
+    bool importJson(const std::string& filepath);
+
+    // When enabled (default), load() maps binary stores instead of reading them into memory.
+    void setMemoryMapping(bool enabled);
+    // When enabled, load() leaves chunk contents in the store file instead of copying
+    // them into memory; only the hits' contents are read from disk. Off by default.
+    void setDiskContents(bool enabled);
+    bool getDiskContents() const;
     size_t size() const override;
     std::vector<std::string> getSources() const override;
+    std::vector<SourceStats> getSourceStats() const override;
+    int getMaxId() const override;
+
+    // Removed rows are tombstoned and skipped by the scan. compact() drops them and
+    // rebuilds the matrix; it runs automatically once the tombstoned fraction of rows
+    // exceeds the compaction ratio (default 0.25), and before saving.
+    void compact();
+    void setCompactionRatio(float ratio);
+
+    // Number of threads used to scan large stores (0 = all hardware threads, 1 = single-threaded).
+    void setNumThreads(size_t numThreads);
+    size_t getNumThreads() const;
+
+    // Stores with fewer rows than this are scanned on the calling thread only,
+    // so small stores don't pay for waking up workers.
+    void setParallelThreshold(size_t minRows);
+    size_t getParallelThreshold() const;
 
 private:
-    // Helper function to calculate cosine similarity
-    static float cosineSimilarity(const Embedding& v1, const Embedding& v2);
-    static float magnitude(const Embedding& v);
-
-    // In-memory storage for embeddings and their metadata
-    std::vector<Embedding> embeddings;
-    std::vector<VectorMetadata> metadata;
-    std::vector<std::string> contents;
+    bool saveBinary(const std::string& filepath) const;
+    bool loadBinary(const std::string& filepath);
+    // Copies mapped rows into owned memory before the store is modified.
+    void detachMapping();
+
+    void markDeleted(size_t row);
+    void compactIfNeeded();
+
+    // Appends a row to the matrix, storing it unit-normalized alongside its original norm.
+    void appendRow(const float* values);
+    // Copies a query into an aligned, padded buffer and normalizes it.
+    void prepareQuery(const Embedding& query, AlignedFloatVector& out) const;
+    // Reconstructs the original (unnormalized) embedding of a row.
+    Embedding rowEmbedding(size_t row) const;
+    // Evaluates a filter into 'allowed'; returns nullptr when it doesn't restrict
+    // (deleted rows are then skipped through 'deleted'). 'count' receives the number of candidate rows.
+    const uint8_t* filterMask(const SearchFilter& filter, std::vector<uint8_t>& allowed, size_t& count) const;
+    // Scores rows [begin, end) against a prepared query into the selector,
+    // skipping rows not set in 'allowed' (if given).
+    void scanRows(const float* query, size_t begin, size_t end, const uint8_t* allowed, TopKSelector& selector) const;
+    // Scores rows [begin, end) against nq prepared queries (row-major, 'stride' apart),
+    // one cache block at a time, pushing into selectors[0..nq). 'scratch' holds a score tile.
+    void scanRowsBatch(const float* queries, size_t nq, size_t begin, size_t end, const uint8_t* allowed, TopKSelector* selectors, std::vector<float>& scratch) const;
+    // Rows per shard, sized so one shard stays resident in L2 cache.
+    size_t shardRows() const;
+    // Returns the worker pool sized for the current thread setting; the caller keeps it
+    // alive while using it, so concurrent searches survive a resize.
+    std::shared_ptr<ThreadPool> getThreadPool(size_t threads);
+    // Builds the owning result list for a selection.
+    SearchHits makeHits(const std::vector<ScoredRow>& best) const;
+
+    // Embeddings live in one row-major matrix. Rows are unit-normalized at add/load
+    // time and padded to 'stride' floats, so a cosine similarity is a single dot product.
+    // 'rows' points either into 'matrix' or into a memory-mapped binary store.
+    size_t dimension = 0;
+    size_t stride = 0;
+    AlignedFloatVector matrix;
+    const float* rows = nullptr;
+    std::vector<float> norms;
+
+    std::unique_ptr<MappedFile> mapping;
+    bool useMemoryMapping = true;
+    bool diskContents = false;
+
+    MetadataTable entries; // ids, interned sources/types and contents per row
+
+    // Stable ids: metadata id -> row, plus a tombstone flag per row.
+    std::unordered_map<int, size_t> idToRow;
+    std::vector<uint8_t> deleted;
+    size_t deletedCount = 0;
+    float compactionRatio = 0.25f;
+
+    // Worker pool for sharded scans, created on first use.
+    size_t numThreads = 0;
+    size_t parallelThreshold = 16384;
+    std::shared_ptr<ThreadPool> threadPool;
+    std::mutex poolMutex;
 };
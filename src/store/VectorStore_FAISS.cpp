@@ -10,15 +10,99 @@
  */
 
 #include "VectorStore_FAISS.h"
+#include "BinaryIO.h"
+#include "MappedFile.h"
+#include "SimdKernels.h"
+#include "TopK.h"
 #include "ofLog.h"
 #include "ofJson.h"
 #include "ofFileUtils.h"
 
+#ifdef USE_FAISS
+#include <faiss/AutoTune.h>
+#include <faiss/IVFlib.h>
+#include <faiss/IndexFlat.h>
+#include <faiss/IndexHNSW.h>
+#include <faiss/IndexIDMap.h>
+#include <faiss/IndexIVF.h>
+#include <faiss/impl/IDSelector.h>
+#include <faiss/impl/io.h>
+#include <faiss/index_factory.h>
+#endif
+
+#include <cstddef>
+#include <cstring>
+#include <unordered_set>
+
+namespace {
+
+// Store file layout (native endianness):
+//   header | index (FAISS serialization) | pad to 8 | row records (count)
+//   | pending ids (pendingCount) | pending vectors (pendingCount x dimension floats)
+//   | string blob (each distinct source/type once, then the contents)
+// Each section has a checksum in the header, and the header has its own.
+const char FAISS_STORE_MAGIC[8] = {'O', 'F', 'X', 'R', 'A', 'G', 'F', 'S'};
+const uint32_t FAISS_STORE_VERSION = 2; // 2 added the row label
+
+struct FaissStoreHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t dimension;
+    uint64_t count;
+    uint64_t pendingCount;
+    uint64_t indexOffset;
+    uint64_t indexSize;
+    uint64_t recordsOffset;
+    uint64_t pendingOffset;
+    uint64_t stringsOffset;
+    uint64_t stringsSize;
+    uint64_t indexChecksum;
+    uint64_t recordsChecksum;
+    uint64_t pendingChecksum;
+    uint64_t stringsChecksum;
+    uint64_t headerChecksum; // over the header bytes before this field
+};
+
+struct FaissRowRecord {
+    int64_t id;
+    uint64_t sourceOffset;
+    uint64_t sourceLength;
+    uint64_t typeOffset;
+    uint64_t typeLength;
+    uint64_t contentOffset;
+    uint64_t contentLength;
+    int64_t label; // label of the row's vector in the index; version 1 records end before it
+};
+
+#ifdef USE_FAISS
+// Lets FAISS read its index straight from the loaded store file.
+struct MemoryIOReader : faiss::IOReader {
+    const uint8_t* data;
+    size_t size;
+    size_t position = 0;
+
+    MemoryIOReader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+    size_t operator()(void* ptr, size_t itemSize, size_t items) override {
+        if (itemSize == 0) {
+            return 0;
+        }
+        size_t count = std::min(items, (size - position) / itemSize);
+        std::memcpy(ptr, data + position, count * itemSize);
+        position += count * itemSize;
+        return count;
+    }
+};
+#endif
+
+} // namespace
+
 //--------------------------------------------------------------
-VectorStore_FAISS::VectorStore_FAISS(int dimension) : dimension(dimension) {
+VectorStore_FAISS::VectorStore_FAISS(int dimension, const std::string& indexFactory) : dimension(dimension), indexFactory(indexFactory) {
 #ifdef USE_FAISS
-    ofLogNotice("VectorStore_FAISS") << "Initializing FAISS vector store with dimension: " << dimension;
-    index = new faiss::IndexFlatL2(dimension);
+    ofLogNotice("VectorStore_FAISS") << "Initializing FAISS vector store with dimension: " << dimension << ", index: " << indexFactory;
+    index = createIndex();
 #else
     ofLogWarning("VectorStore_FAISS") << "FAISS is not enabled. Vector store will not function.";
 #endif
@@ -39,35 +123,78 @@ void VectorStore_FAISS::add(const Embedding& embedding, const VectorMetadata& me
         ofLogError("VectorStore_FAISS") << "Embedding size does not match index dimension.";
         return;
     }
-    index->add(1, embedding.data());
-    metadatas.push_back(metadata);
-    contents.push_back(content);
+    // Labels are the metadata ids (through IndexIDMap2); re-adding an id replaces the old entry.
+    if (idToRow.count(metadata.id)) {
+        remove(metadata.id);
+    }
+    faiss::idx_t label = metadata.id;
+    if (index->is_trained) {
+        if (staleLabels.count(label)) {
+            // The old vector could not be removed and still answers to the id
+            label = nextAlias++;
+            idToAlias[metadata.id] = label;
+            aliasToId[label] = metadata.id;
+        }
+        index->add_with_ids(1, embedding.data(), &label);
+    } else {
+        pendingVectors.insert(pendingVectors.end(), embedding.begin(), embedding.end());
+        pendingIds.push_back(label);
+    }
+    idToRow[metadata.id] = entries.append(metadata, content);
+    deleted.push_back(0);
+
+    if (!index->is_trained && pendingVectors.size() / dimension >= getTrainingSize()) {
+        ofLogNotice("VectorStore_FAISS") << "Collected " << pendingVectors.size() / dimension << " vectors, training index.";
+        train();
+    }
 #endif
 }
 
 //--------------------------------------------------------------
-std::vector<SearchResult> VectorStore_FAISS::search(const Embedding& query, int k) {
-    std::vector<SearchResult> results;
+SearchHits VectorStore_FAISS::searchHits(const Embedding& query, int k, const SearchFilter& filter) {
+    SearchHits results;
 #ifdef USE_FAISS
     if (query.size() != dimension) {
         ofLogError("VectorStore_FAISS") << "Query embedding size does not match index dimension.";
         return results;
     }
+    if (k <= 0) {
+        return results;
+    }
+    if (!index->is_trained) {
+        return searchPending(query, k, filter);
+    }
 
-    std::vector<faiss::idx_t> labels(k);
-    std::vector<float> distances(k);
+    std::vector<SearchHits> batch(1);
+    searchIndex(1, query.data(), k, filter, batch);
+    results = std::move(batch[0]);
+#endif
+    return results;
+}
 
-    index->search(1, query.data(), k, distances.data(), labels.data());
+//--------------------------------------------------------------
+std::vector<SearchHits> VectorStore_FAISS::searchHitsBatch(const std::vector<Embedding>& queries, int k, const SearchFilter& filter) {
+    std::vector<SearchHits> results(queries.size());
+#ifdef USE_FAISS
+    if (queries.empty() || k <= 0) {
+        return results;
+    }
+    if (!index->is_trained) {
+        return VectorStoreBase::searchHitsBatch(queries, k, filter);
+    }
 
-    for (int i = 0; i < k; ++i) {
-        if (labels[i] >= 0 && labels[i] < metadatas.size()) {
-            SearchResult res;
-            res.metadata = metadatas[labels[i]];
-            res.distance = distances[i];
-            res.content = contents[labels[i]];
-            results.push_back(res);
+    // Pack all queries into one matrix so FAISS can run its blocked nq > 1 path.
+    size_t nq = queries.size();
+    std::vector<float> packed(nq * dimension);
+    for (size_t i = 0; i < nq; ++i) {
+        if (queries[i].size() != dimension) {
+            ofLogError("VectorStore_FAISS") << "Batch query embedding size does not match index dimension.";
+            return results;
         }
+        std::copy(queries[i].begin(), queries[i].end(), packed.begin() + i * dimension);
     }
+
+    searchIndex(nq, packed.data(), k, filter, results);
 #endif
     return results;
 }
@@ -75,31 +202,84 @@ std::vector<SearchResult> VectorStore_FAISS::search(const Embedding& query, int
 //--------------------------------------------------------------
 bool VectorStore_FAISS::save(const std::string& path) {
 #ifdef USE_FAISS
+    compactMetadata(); // only live entries are written
     try {
-        // Save FAISS index
-        faiss::write_index(index, path.c_str());
-        ofLogNotice("VectorStore_FAISS") << "FAISS index saved to: " << path;
-
-        // Save metadata
-        ofJson metaJson;
-        for (const auto& meta : metadatas) {
-            ofJson meta_json;
-            meta_json["id"] = meta.id;
-            meta_json["source"] = meta.source;
-            meta_json["type"] = meta.type;
-            metaJson.push_back(meta_json);
-        }
-        ofSaveJson(ofFilePath::removeExt(path) + ".meta", metaJson);
-        ofLogNotice("VectorStore_FAISS") << "Metadata saved to: " << ofFilePath::removeExt(path) + ".meta";
-
-        // Save contents
-        ofJson contentsJson = ofJson::array();
-        for(const auto& content : contents) {
-            contentsJson.push_back(content);
-        }
-        ofSaveJson(ofFilePath::removeExt(path) + ".contents", contentsJson);
-        ofLogNotice("VectorStore_FAISS") << "Contents saved to: " << ofFilePath::removeExt(path) + ".contents";
+        faiss::VectorIOWriter indexBytes;
+        faiss::write_index(index, &indexBytes);
 
+        BinaryWriter writer;
+        if (!writer.open(path)) {
+            ofLogError("VectorStore_FAISS") << "Cannot open " << path << " for writing.";
+            return false;
+        }
+
+        // Header first; offsets and checksums are patched in once the sections are written.
+        FaissStoreHeader header = {};
+        std::memcpy(header.magic, FAISS_STORE_MAGIC, sizeof(header.magic));
+        header.version = FAISS_STORE_VERSION;
+        header.headerSize = sizeof(FaissStoreHeader);
+        header.dimension = dimension;
+        header.count = entries.size();
+        header.pendingCount = pendingIds.size();
+        writer.write(header);
+
+        header.indexOffset = writer.tell();
+        header.indexSize = indexBytes.data.size();
+        header.indexChecksum = ofxragChecksum(indexBytes.data.data(), indexBytes.data.size());
+        writer.writeBytes(indexBytes.data.data(), indexBytes.data.size());
+        std::vector<uint8_t>().swap(indexBytes.data);
+
+        writer.pad(8);
+        header.recordsOffset = writer.tell();
+        Checksum recordsChecksum;
+        writer.track(&recordsChecksum);
+        std::vector<uint64_t> contentOffsets = entries.contentBlobOffsets();
+        for (size_t i = 0; i < entries.size(); ++i) {
+            FaissRowRecord record = {};
+            record.id = entries.id(i);
+            record.sourceOffset = entries.sourceBlobOffset(i);
+            record.sourceLength = entries.source(i).size();
+            record.typeOffset = entries.typeBlobOffset(i);
+            record.typeLength = entries.type(i).size();
+            record.contentOffset = contentOffsets[i];
+            record.contentLength = entries.contentLength(i);
+            record.label = labelOf(entries.id(i));
+            writer.write(record);
+        }
+        header.recordsChecksum = recordsChecksum.value();
+
+        // Vectors waiting for the index to be trained are kept as raw floats
+        header.pendingOffset = writer.tell();
+        Checksum pendingChecksum;
+        writer.track(&pendingChecksum);
+        writer.writeBytes(pendingIds.data(), pendingIds.size() * sizeof(faiss::idx_t));
+        writer.writeBytes(pendingVectors.data(), pendingVectors.size() * sizeof(float));
+        header.pendingChecksum = pendingChecksum.value();
+
+        header.stringsOffset = writer.tell();
+        header.stringsSize = entries.blobSize();
+        Checksum stringsChecksum;
+        writer.track(&stringsChecksum);
+        entries.writeBlob(writer);
+        writer.track(nullptr);
+        header.stringsChecksum = stringsChecksum.value();
+
+        header.headerChecksum = ofxragChecksum(&header, offsetof(FaissStoreHeader, headerChecksum));
+        writer.patch(0, header);
+        if (!writer.commit()) {
+            ofLogError("VectorStore_FAISS") << "Failed to write FAISS store to " << path;
+            return false;
+        }
+
+        // Files of the older multi-file format would be stale next to the new store.
+        std::string base = ofFilePath::removeExt(path);
+        for (const char* ext : {".meta", ".contents", ".pending"}) {
+            if (ofFile::doesFileExist(base + ext, false)) {
+                ofFile::removeFile(base + ext, false);
+            }
+        }
+
+        ofLogNotice("VectorStore_FAISS") << "Saved " << entries.size() << " items (" << pendingIds.size() << " untrained) to " << path;
         return true;
     } catch (const std::exception& e) {
         ofLogError("VectorStore_FAISS") << "Failed to save FAISS index: " << e.what();
@@ -113,38 +293,52 @@ bool VectorStore_FAISS::save(const std::string& path) {
 //--------------------------------------------------------------
 bool VectorStore_FAISS::load(const std::string& path) {
 #ifdef USE_FAISS
+    char magic[sizeof(FaissStoreHeader::magic)] = {};
+    std::ifstream probe(path, std::ios::binary);
+    bool storeFile = probe.read(magic, sizeof(magic)) && std::memcmp(magic, FAISS_STORE_MAGIC, sizeof(magic)) == 0;
+    probe.close();
+
     try {
-        // Load FAISS index
-        faiss::Index* new_index = faiss::read_index(path.c_str());
-        if (new_index->d != dimension) {
-            ofLogError("VectorStore_FAISS") << "Loaded index dimension (" << new_index->d << ") does not match configured dimension (" << dimension << ").";
-            delete new_index;
+        faiss::Index* new_index = storeFile ? readStoreFile(path) : readLegacyFiles(path);
+        if (!new_index) {
             return false;
         }
+
         delete index;
-        index = dynamic_cast<faiss::IndexFlatL2*>(new_index);
-        ofLogNotice("VectorStore_FAISS") << "FAISS index loaded from: " << path;
+        index = new_index;
+        applySearchParameters();
 
-        // Load metadata
-        ofJson metaJson = ofLoadJson(ofFilePath::removeExt(path) + ".meta");
-        metadatas.clear();
-        for (const auto& meta_json : metaJson) {
-            VectorMetadata meta;
-            meta.id = meta_json["id"];
-            meta.source = meta_json["source"];
-            meta.type = meta_json["type"];
-            metadatas.push_back(meta);
+        deleted.assign(entries.size(), 0);
+        deletedCount = 0;
+        idToRow.clear();
+        for (size_t i = 0; i < entries.size(); ++i) {
+            idToRow[entries.id(i)] = i;
         }
-        ofLogNotice("VectorStore_FAISS") << "Metadata loaded from: " << ofFilePath::removeExt(path) + ".meta";
-
-        // Load contents
-        ofJson contentsJson = ofLoadJson(ofFilePath::removeExt(path) + ".contents");
-        contents.clear();
-        for (const auto& contentJson : contentsJson) {
-            contents.push_back(contentJson.get<std::string>());
+        aliasToId.clear();
+        nextAlias = FIRST_ALIAS_LABEL;
+        for (const auto& alias : idToAlias) {
+            aliasToId[alias.second] = alias.first;
+            nextAlias = std::max(nextAlias, alias.second + 1);
+        }
+        // Vectors the index could not remove before it was saved are still in it
+        staleLabels.clear();
+        if (const faiss::IndexIDMap* idMap = dynamic_cast<const faiss::IndexIDMap*>(index)) {
+            std::unordered_set<faiss::idx_t> liveLabels;
+            size_t duplicates = 0;
+            for (faiss::idx_t label : idMap->id_map) {
+                bool live = label >= FIRST_ALIAS_LABEL ? aliasToId.count(label) > 0 : idToRow.count((int)label) > 0 && !idToAlias.count((int)label);
+                if (!live) {
+                    staleLabels.insert(label);
+                    nextAlias = std::max(nextAlias, label + 1);
+                } else if (!liveLabels.insert(label).second) {
+                    ++duplicates;
+                }
+            }
+            if (duplicates > 0) {
+                // Version 1 stores re-added ids under their old label
+                ofLogWarning("VectorStore_FAISS") << path << " holds " << duplicates << " superseded vectors under live ids; rebuild the store to drop them.";
+            }
         }
-        ofLogNotice("VectorStore_FAISS") << "Contents loaded from: " << ofFilePath::removeExt(path) + ".contents";
-
 
         return true;
     } catch (const std::exception& e) {
@@ -156,30 +350,608 @@ bool VectorStore_FAISS::load(const std::string& path) {
 #endif
 }
 
+#ifdef USE_FAISS
+//--------------------------------------------------------------
+faiss::Index* VectorStore_FAISS::readStoreFile(const std::string& path) {
+    // Mapped, so each section is read once while it is verified and parsed; with disk
+    // contents the mapping is kept for the contents.
+    auto file = std::make_shared<MappedFile>();
+    if (!file->open(path)) {
+        ofLogError("VectorStore_FAISS") << "Failed to open FAISS store " << path;
+        return nullptr;
+    }
+    const FaissStoreHeader* header = file->at<FaissStoreHeader>(0);
+    if (!header || (header->version != FAISS_STORE_VERSION && header->version != 1) || header->headerSize != sizeof(FaissStoreHeader)) {
+        ofLogError("VectorStore_FAISS") << "Unsupported FAISS store version in " << path;
+        return nullptr;
+    }
+    if (header->dimension != (uint64_t)dimension) {
+        ofLogError("VectorStore_FAISS") << "Loaded index dimension (" << header->dimension << ") does not match configured dimension (" << dimension << ").";
+        return nullptr;
+    }
+
+    uint64_t count = header->count;
+    uint64_t pendingCount = header->pendingCount;
+    const uint8_t* indexBytes = file->at<uint8_t>(header->indexOffset, header->indexSize);
+    size_t recordSize = header->version == 1 ? offsetof(FaissRowRecord, label) : sizeof(FaissRowRecord);
+    const uint8_t* records = file->at<uint8_t>(header->recordsOffset, count * recordSize);
+    const uint8_t* pending = file->at<uint8_t>(header->pendingOffset, pendingCount * (sizeof(faiss::idx_t) + dimension * sizeof(float)));
+    const char* strings = file->at<char>(header->stringsOffset, header->stringsSize);
+    bool intact = header->headerChecksum == ofxragChecksum(header, offsetof(FaissStoreHeader, headerChecksum)) &&
+                  indexBytes && (records || count == 0) && (pending || pendingCount == 0) && (strings || header->stringsSize == 0);
+    intact = intact && ofxragChecksum(indexBytes, header->indexSize) == header->indexChecksum &&
+             ofxragChecksum(records, count * recordSize) == header->recordsChecksum &&
+             ofxragChecksum(pending, pendingCount * (sizeof(faiss::idx_t) + dimension * sizeof(float))) == header->pendingChecksum &&
+             ofxragChecksum(strings, header->stringsSize) == header->stringsChecksum;
+    if (!intact) {
+        ofLogError("VectorStore_FAISS") << "FAISS store " << path << " is truncated or corrupt.";
+        return nullptr;
+    }
+
+    // Rows are built into a fresh table, so a bad file leaves the store as it was.
+    MetadataTable loaded;
+    std::unordered_map<int, int64_t> aliases;
+    if (diskContents) {
+        loaded.setContentFile(file);
+    }
+    loaded.reserve(count, diskContents ? 0 : header->stringsSize);
+    uint64_t blobSize = header->stringsSize;
+    auto inBlob = [blobSize](uint64_t offset, uint64_t length) {
+        return offset <= blobSize && length <= blobSize - offset;
+    };
+    for (uint64_t i = 0; i < count; ++i) {
+        FaissRowRecord record;
+        std::memcpy(&record, records + i * recordSize, recordSize);
+        if (header->version == 1) {
+            record.label = record.id;
+        }
+        if (!inBlob(record.sourceOffset, record.sourceLength) || !inBlob(record.typeOffset, record.typeLength) ||
+            !inBlob(record.contentOffset, record.contentLength) ||
+            (record.label != record.id && record.label < FIRST_ALIAS_LABEL)) {
+            ofLogError("VectorStore_FAISS") << "FAISS store " << path << " has an invalid row table.";
+            return nullptr;
+        }
+        if (record.label != record.id) {
+            aliases[(int)record.id] = record.label;
+        }
+        std::string_view source(strings + record.sourceOffset, record.sourceLength);
+        std::string_view type(strings + record.typeOffset, record.typeLength);
+        if (diskContents) {
+            loaded.appendMapped((int)record.id, source, type, header->stringsOffset + record.contentOffset, (uint32_t)record.contentLength);
+        } else {
+            loaded.append((int)record.id, source, type, std::string_view(strings + record.contentOffset, record.contentLength));
+        }
+    }
+
+    MemoryIOReader reader(indexBytes, header->indexSize);
+    faiss::Index* new_index = faiss::read_index(&reader);
+    if (new_index->d != dimension) {
+        ofLogError("VectorStore_FAISS") << "Loaded index dimension (" << new_index->d << ") does not match configured dimension (" << dimension << ").";
+        delete new_index;
+        return nullptr;
+    }
+
+    entries = std::move(loaded);
+    idToAlias = std::move(aliases);
+    pendingIds.resize(pendingCount);
+    pendingVectors.resize(pendingCount * dimension);
+    if (pendingCount > 0) {
+        std::memcpy(pendingIds.data(), pending, pendingCount * sizeof(faiss::idx_t));
+        std::memcpy(pendingVectors.data(), pending + pendingCount * sizeof(faiss::idx_t), pendingVectors.size() * sizeof(float));
+    }
+
+    ofLogNotice("VectorStore_FAISS") << "Loaded " << count << " items (" << pendingCount << " untrained) from " << path;
+    return new_index;
+}
+
+//--------------------------------------------------------------
+faiss::Index* VectorStore_FAISS::readLegacyFiles(const std::string& path) {
+    // Everything is read into locals and only swapped in at the end, so a bad store,
+    // including malformed JSON that throws, leaves this one as it was.
+    // Load FAISS index
+    std::unique_ptr<faiss::Index> new_index(faiss::read_index(path.c_str()));
+    if (new_index->d != dimension) {
+        ofLogError("VectorStore_FAISS") << "Loaded index dimension (" << new_index->d << ") does not match configured dimension (" << dimension << ").";
+        return nullptr;
+    }
+    ofLogNotice("VectorStore_FAISS") << "FAISS index loaded from: " << path;
+
+    // Load metadata and contents
+    ofJson metaJson = ofLoadJson(ofFilePath::removeExt(path) + ".meta");
+    ofJson contentsJson = ofLoadJson(ofFilePath::removeExt(path) + ".contents");
+    MetadataTable loaded;
+    loaded.reserve(metaJson.size());
+    for (size_t i = 0; i < metaJson.size(); ++i) {
+        const ofJson& meta_json = metaJson[i];
+        std::string content = i < contentsJson.size() ? contentsJson[i].get<std::string>() : std::string();
+        loaded.append(meta_json["id"].get<int>(), meta_json["source"].get<std::string>(), meta_json["type"].get<std::string>(), content);
+    }
+    ofLogNotice("VectorStore_FAISS") << "Metadata loaded from: " << ofFilePath::removeExt(path) + ".meta";
+    ofLogNotice("VectorStore_FAISS") << "Contents loaded from: " << ofFilePath::removeExt(path) + ".contents";
+
+    // Load vectors that were waiting for training
+    std::vector<float> loadedVectors;
+    std::vector<faiss::idx_t> loadedIds;
+    MappedFile pending;
+    if (pending.open(ofFilePath::removeExt(path) + ".pending", false)) {
+        const uint64_t* count = pending.at<uint64_t>(0);
+        const faiss::idx_t* ids = count ? pending.at<faiss::idx_t>(sizeof(uint64_t), *count) : nullptr;
+        const float* values = count ? pending.at<float>(sizeof(uint64_t) + *count * sizeof(faiss::idx_t), *count * dimension) : nullptr;
+        if (ids && values) {
+            loadedIds.assign(ids, ids + *count);
+            loadedVectors.assign(values, values + *count * dimension);
+        }
+    }
+
+    // Stores written before stable ids used positional labels on a bare IndexFlatL2;
+    // move those vectors into an id-mapped index keyed by the metadata ids.
+    if (!dynamic_cast<faiss::IndexIDMap2*>(new_index.get())) {
+        if ((size_t)new_index->ntotal != loaded.size()) {
+            ofLogError("VectorStore_FAISS") << "FAISS index size (" << new_index->ntotal << ") does not match metadata count (" << loaded.size() << ") in " << path;
+            return nullptr;
+        }
+        std::vector<float> vectors((size_t)new_index->ntotal * dimension);
+        new_index->reconstruct_n(0, new_index->ntotal, vectors.data());
+        std::vector<faiss::idx_t> ids;
+        ids.reserve(loaded.size());
+        for (size_t i = 0; i < loaded.size(); ++i) {
+            ids.push_back(loaded.id(i));
+        }
+        auto converted = std::make_unique<faiss::IndexIDMap2>(new faiss::IndexFlatL2(dimension));
+        converted->own_fields = true;
+        converted->add_with_ids(new_index->ntotal, vectors.data(), ids.data());
+        new_index = std::move(converted);
+        ofLogNotice("VectorStore_FAISS") << "Converted positional index to stable ids.";
+    }
+
+    entries = std::move(loaded);
+    idToAlias.clear();
+    pendingIds = std::move(loadedIds);
+    pendingVectors = std::move(loadedVectors);
+    return new_index.release();
+}
+#endif
+
 //--------------------------------------------------------------
 void VectorStore_FAISS::clear() {
 #ifdef USE_FAISS
     index->reset();
-    metadatas.clear();
-    contents.clear();
+    pendingVectors.clear();
+    pendingIds.clear();
+    entries.clear();
+    deleted.clear();
+    deletedCount = 0;
+    idToAlias.clear();
+    aliasToId.clear();
+    staleLabels.clear();
+    nextAlias = FIRST_ALIAS_LABEL;
+    idToRow.clear();
     ofLogNotice("VectorStore_FAISS") << "FAISS index and metadata cleared.";
 #endif
 }
 
 //--------------------------------------------------------------
 size_t VectorStore_FAISS::size() const {
+    return entries.size() - deletedCount;
+}
+
+//--------------------------------------------------------------
+std::vector<std::string> VectorStore_FAISS::getSources() const {
+    return entries.documentSources();
+}
+
+//--------------------------------------------------------------
+std::vector<SourceStats> VectorStore_FAISS::getSourceStats() const {
+    return entries.documentStats();
+}
+
+//--------------------------------------------------------------
+SearchHits VectorStore_FAISS::getHits(const std::vector<int>& ids) {
+    SearchHits results;
+    for (int id : ids) {
+        auto it = idToRow.find(id);
+        if (it != idToRow.end()) {
+            results.hits.push_back(entries.hit(it->second, 0.0f));
+        }
+    }
+    results.lease = entries.lease();
+    return results;
+}
+
+//--------------------------------------------------------------
+bool VectorStore_FAISS::remove(int id) {
+    std::vector<int> ids = {id};
+    return removeIds(ids) > 0;
+}
+
+//--------------------------------------------------------------
+size_t VectorStore_FAISS::removeBySource(const std::string& source) {
+    std::vector<int> ids;
+    for (size_t row : entries.rowsOf(source)) {
+        if (!deleted[row]) {
+            ids.push_back(entries.id(row));
+        }
+    }
+    size_t removed = removeIds(ids);
+    if (removed > 0) {
+        ofLogNotice("VectorStore_FAISS") << "Removed " << removed << " entries of source: " << source;
+    }
+    return removed;
+}
+
+//--------------------------------------------------------------
+int VectorStore_FAISS::getMaxId() const {
+    int maxId = -1;
+    for (const auto& entry : idToRow) {
+        maxId = std::max(maxId, entry.first);
+    }
+    return maxId;
+}
+
+//--------------------------------------------------------------
+int64_t VectorStore_FAISS::labelOf(int id) const {
+    auto it = idToAlias.find(id);
+    return it != idToAlias.end() ? it->second : id;
+}
+
+//--------------------------------------------------------------
+size_t VectorStore_FAISS::removeIds(const std::vector<int>& ids) {
+    std::vector<int64_t> labels;
+    for (int id : ids) {
+        auto it = idToRow.find(id);
+        if (it == idToRow.end()) {
+            continue;
+        }
+        size_t row = it->second;
+        deleted[row] = 1;
+        ++deletedCount;
+        entries.releaseContent(row);
+        idToRow.erase(it);
+        labels.push_back(labelOf(id));
+        auto alias = idToAlias.find(id);
+        if (alias != idToAlias.end()) {
+            aliasToId.erase(alias->second);
+            idToAlias.erase(alias);
+        }
+    }
+    if (labels.empty()) {
+        return 0;
+    }
+
+#ifdef USE_FAISS
+    if (!index->is_trained) {
+        // Still buffered for training: drop them from the buffer
+        std::unordered_set<int64_t> drop(labels.begin(), labels.end());
+        size_t kept = 0;
+        for (size_t i = 0; i < pendingIds.size(); ++i) {
+            if (drop.count(pendingIds[i])) {
+                continue;
+            }
+            pendingIds[kept] = pendingIds[i];
+            std::copy(pendingVectors.begin() + i * dimension, pendingVectors.begin() + (i + 1) * dimension, pendingVectors.begin() + kept * dimension);
+            ++kept;
+        }
+        pendingIds.resize(kept);
+        pendingVectors.resize(kept * dimension);
+    } else {
+        try {
+            faiss::IDSelectorBatch selector(labels.size(), labels.data());
+            index->remove_ids(selector);
+        } catch (const std::exception& e) {
+            // Some index types (e.g. HNSW) cannot remove vectors; their labels are
+            // filtered out at search time instead.
+            staleLabels.insert(labels.begin(), labels.end());
+            ofLogVerbose("VectorStore_FAISS") << "Index cannot remove vectors (" << e.what() << "), hiding them instead.";
+        }
+    }
+#endif
+
+    if (deletedCount >= compactionRatio * entries.size()) {
+        compactMetadata();
+    }
+    return labels.size();
+}
+
+//--------------------------------------------------------------
+void VectorStore_FAISS::compactMetadata() {
+    if (deletedCount == 0) {
+        return;
+    }
+    entries.compact(deleted);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        idToRow[entries.id(i)] = i;
+    }
+    deleted.assign(entries.size(), 0);
+    deletedCount = 0;
+}
+
+//--------------------------------------------------------------
+void VectorStore_FAISS::setCompactionRatio(float ratio) {
+    compactionRatio = ratio;
+}
+
+//--------------------------------------------------------------
+void VectorStore_FAISS::setDiskContents(bool enabled) {
+    diskContents = enabled;
+}
+
+//--------------------------------------------------------------
+bool VectorStore_FAISS::getDiskContents() const {
+    return diskContents;
+}
+
+//--------------------------------------------------------------
+bool VectorStore_FAISS::isTrained() const {
 #ifdef USE_FAISS
-    return index->ntotal;
+    return index->is_trained;
 #else
-    return 0;
+    return false;
 #endif
 }
 
 //--------------------------------------------------------------
-std::vector<std::string> VectorStore_FAISS::getSources() const {
-    std::set<std::string> unique_sources;
-    for (const auto& metadata : metadatas) {
-        unique_sources.insert(metadata.source);
+bool VectorStore_FAISS::train() {
+#ifdef USE_FAISS
+    if (index->is_trained) {
+        return true;
     }
-    return std::vector<std::string>(unique_sources.begin(), unique_sources.end());
+    size_t n = pendingVectors.size() / dimension;
+    if (n == 0) {
+        ofLogWarning("VectorStore_FAISS") << "No vectors buffered to train on.";
+        return false;
+    }
+    return trainOn(n, pendingVectors.data());
+#else
+    return false;
+#endif
+}
+
+//--------------------------------------------------------------
+bool VectorStore_FAISS::train(const std::vector<Embedding>& samples) {
+#ifdef USE_FAISS
+    std::vector<float> packed;
+    packed.reserve(samples.size() * dimension);
+    for (const auto& sample : samples) {
+        if (sample.size() != dimension) {
+            ofLogError("VectorStore_FAISS") << "Training sample size does not match index dimension.";
+            return false;
+        }
+        packed.insert(packed.end(), sample.begin(), sample.end());
+    }
+    if (samples.empty()) {
+        ofLogWarning("VectorStore_FAISS") << "No training samples given.";
+        return false;
+    }
+    return trainOn(samples.size(), packed.data());
+#else
+    return false;
+#endif
+}
+
+//--------------------------------------------------------------
+void VectorStore_FAISS::setTrainingSize(size_t numVectors) {
+    trainingSize = numVectors;
+}
+
+//--------------------------------------------------------------
+size_t VectorStore_FAISS::getTrainingSize() const {
+    if (trainingSize > 0) {
+        return trainingSize;
+    }
+#ifdef USE_FAISS
+    // FAISS warns below ~39 training points per centroid
+    if (const faiss::IndexIVF* ivf = faiss::ivflib::try_extract_index_ivf(index)) {
+        return 39 * ivf->nlist;
+    }
+#endif
+    return 10000;
+}
+
+//--------------------------------------------------------------
+bool VectorStore_FAISS::setSearchParameter(const std::string& name, double value) {
+    auto it = std::find_if(searchParameters.begin(), searchParameters.end(), [&](const auto& p) { return p.first == name; });
+    if (it != searchParameters.end()) {
+        it->second = value;
+    } else {
+        searchParameters.push_back({name, value});
+    }
+#ifdef USE_FAISS
+    try {
+        faiss::ParameterSpace().set_index_parameter(index, name, value);
+        ofLogNotice("VectorStore_FAISS") << "Search parameter " << name << " set to " << value;
+        return true;
+    } catch (const std::exception& e) {
+        ofLogError("VectorStore_FAISS") << "Cannot set search parameter " << name << ": " << e.what();
+        searchParameters.erase(std::remove_if(searchParameters.begin(), searchParameters.end(), [&](const auto& p) { return p.first == name; }), searchParameters.end());
+        return false;
+    }
+#else
+    return false;
+#endif
 }
+
+//--------------------------------------------------------------
+void VectorStore_FAISS::setNProbe(int nprobe) {
+    setSearchParameter("nprobe", nprobe);
+}
+
+//--------------------------------------------------------------
+void VectorStore_FAISS::setEfSearch(int efSearch) {
+    setSearchParameter("efSearch", efSearch);
+}
+
+//--------------------------------------------------------------
+const std::string& VectorStore_FAISS::getIndexFactory() const {
+    return indexFactory;
+}
+
+#ifdef USE_FAISS
+//--------------------------------------------------------------
+faiss::Index* VectorStore_FAISS::createIndex() const {
+    faiss::Index* inner = nullptr;
+    try {
+        inner = faiss::index_factory(dimension, indexFactory.c_str());
+    } catch (const std::exception& e) {
+        ofLogError("VectorStore_FAISS") << "Invalid index factory string '" << indexFactory << "': " << e.what() << ". Using exact L2 (Flat).";
+        inner = new faiss::IndexFlatL2(dimension);
+    }
+    // IndexIDMap2 labels vectors with the metadata ids and supports remove_ids/reconstruct by id.
+    auto* mapped = new faiss::IndexIDMap2(inner);
+    mapped->own_fields = true;
+    return mapped;
+}
+
+//--------------------------------------------------------------
+bool VectorStore_FAISS::trainOn(size_t n, const float* samples) {
+    try {
+        ofLogNotice("VectorStore_FAISS") << "Training " << indexFactory << " index on " << n << " vectors.";
+        index->train(n, samples);
+        applySearchParameters();
+        // Move buffered vectors into the trained index
+        if (!pendingIds.empty()) {
+            index->add_with_ids(pendingIds.size(), pendingVectors.data(), pendingIds.data());
+            std::vector<float>().swap(pendingVectors);
+            std::vector<faiss::idx_t>().swap(pendingIds);
+        }
+        return true;
+    } catch (const std::exception& e) {
+        ofLogError("VectorStore_FAISS") << "Failed to train FAISS index: " << e.what();
+        return false;
+    }
+}
+
+//--------------------------------------------------------------
+void VectorStore_FAISS::applySearchParameters() {
+    faiss::ParameterSpace space;
+    for (const auto& param : searchParameters) {
+        try {
+            space.set_index_parameter(index, param.first, param.second);
+        } catch (const std::exception& e) {
+            ofLogWarning("VectorStore_FAISS") << "Search parameter " << param.first << " does not apply to this index: " << e.what();
+        }
+    }
+}
+
+//--------------------------------------------------------------
+SearchHits VectorStore_FAISS::searchPending(const Embedding& query, int k, const SearchFilter& filter) const {
+    // |q - x|^2 = |q|^2 + |x|^2 - 2 q.x; ranked through the shared top-k heap by negated distance.
+    size_t n = pendingIds.size();
+    float queryNorm = ofxragDotProduct(query.data(), query.data(), dimension);
+    TopKSelector selector(std::min<size_t>(k, n));
+    std::vector<uint8_t> allowed;
+    if (!filter.empty()) {
+        entries.buildMask(filter, deleted, allowed);
+    }
+    const float* row = pendingVectors.data();
+    for (size_t i = 0; i < n; ++i, row += dimension) {
+        if (!allowed.empty() && !allowed[idToRow.at((int)pendingIds[i])]) {
+            continue;
+        }
+        float distance = queryNorm + ofxragDotProduct(row, row, dimension) - 2.0f * ofxragDotProduct(query.data(), row, dimension);
+        selector.push(-distance, (int64_t)i);
+    }
+
+    SearchHits results;
+    for (const auto& hit : selector.take()) {
+        results.hits.push_back(entries.hit(idToRow.at((int)pendingIds[hit.row]), -hit.score));
+    }
+    results.lease = entries.lease();
+    return results;
+}
+
+//--------------------------------------------------------------
+void VectorStore_FAISS::searchIndex(size_t nq, const float* queries, int k, const SearchFilter& filter, std::vector<SearchHits>& results) const {
+    // The filter becomes the set of the matching live ids' labels.
+    std::vector<faiss::idx_t> ids;
+    std::vector<uint8_t> allowed;
+    if (!filter.empty()) {
+        entries.buildMask(filter, deleted, allowed);
+        for (size_t row = 0; row < allowed.size(); ++row) {
+            if (allowed[row]) {
+                ids.push_back(labelOf(entries.id(row)));
+            }
+        }
+        if (ids.empty()) {
+            return;
+        }
+    }
+
+    // Over-fetch by the number of removed vectors the index could not drop itself
+    faiss::idx_t fetch = std::min<faiss::idx_t>(k + staleLabels.size(), std::max<faiss::idx_t>(index->ntotal, k));
+    std::vector<faiss::idx_t> labels(nq * fetch);
+    std::vector<float> distances(nq * fetch);
+    bool postFilter = false;
+
+    if (ids.empty()) {
+        index->search(nq, queries, fetch, distances.data(), labels.data());
+    } else {
+        faiss::IDSelectorBatch selector(ids.size(), ids.data());
+        std::unique_ptr<faiss::SearchParameters> params = makeSearchParameters(&selector);
+        try {
+            index->search(nq, queries, fetch, distances.data(), labels.data(), params.get());
+        } catch (const std::exception& e) {
+            // Index types without selector support: fetch more and filter the labels here.
+            ofLogVerbose("VectorStore_FAISS") << "Index does not take an ID selector, filtering results instead: " << e.what();
+            size_t spread = (size() + ids.size() - 1) / ids.size();
+            fetch = std::min<faiss::idx_t>(fetch * spread, std::max<faiss::idx_t>(index->ntotal, k));
+            labels.resize(nq * fetch);
+            distances.resize(nq * fetch);
+            index->search(nq, queries, fetch, distances.data(), labels.data());
+            postFilter = true;
+        }
+    }
+
+    for (size_t q = 0; q < nq; ++q) {
+        collectResults(labels.data() + q * fetch, distances.data() + q * fetch, fetch, k, postFilter ? allowed.data() : nullptr, results[q]);
+    }
+}
+
+//--------------------------------------------------------------
+std::unique_ptr<faiss::SearchParameters> VectorStore_FAISS::makeSearchParameters(faiss::IDSelector* selector) const {
+    // IVF and HNSW indexes reject parameters of the wrong type, and explicit parameters
+    // override the ones set on the index, so their current values are carried over.
+    std::unique_ptr<faiss::SearchParameters> params;
+    const faiss::IndexIDMap2* idMap = dynamic_cast<const faiss::IndexIDMap2*>(index);
+    const faiss::IndexHNSW* hnsw = idMap ? dynamic_cast<const faiss::IndexHNSW*>(idMap->index) : nullptr;
+    if (const faiss::IndexIVF* ivf = faiss::ivflib::try_extract_index_ivf(index)) {
+        auto ivfParams = std::make_unique<faiss::SearchParametersIVF>();
+        ivfParams->nprobe = ivf->nprobe;
+        ivfParams->max_codes = ivf->max_codes;
+        params = std::move(ivfParams);
+    } else if (hnsw) {
+        auto hnswParams = std::make_unique<faiss::SearchParametersHNSW>();
+        hnswParams->efSearch = hnsw->hnsw.efSearch;
+        params = std::move(hnswParams);
+    } else {
+        params = std::make_unique<faiss::SearchParameters>();
+    }
+    params->sel = selector;
+    return params;
+}
+
+//--------------------------------------------------------------
+void VectorStore_FAISS::collectResults(const faiss::idx_t* labels, const float* distances, faiss::idx_t n, int k, const uint8_t* allowed, SearchHits& out) const {
+    out.lease = entries.lease();
+    for (faiss::idx_t i = 0; i < n && (int)out.size() < k; ++i) {
+        if (labels[i] < 0 || staleLabels.count(labels[i])) {
+            continue; // removed, but still present in an index that cannot delete
+        }
+        int id = (int)labels[i];
+        if (labels[i] >= FIRST_ALIAS_LABEL) {
+            auto alias = aliasToId.find(labels[i]);
+            if (alias == aliasToId.end()) {
+                continue;
+            }
+            id = alias->second;
+        }
+        auto it = idToRow.find(id);
+        if (it == idToRow.end()) {
+            continue;
+        }
+        if (allowed && !allowed[it->second]) {
+            continue;
+        }
+        out.hits.push_back(entries.hit(it->second, distances[i]));
+    }
+}
+#endif
@@ -12,33 +12,131 @@
 #pragma once
 
 #include "VectorStoreBase.h"
+#include "MetadataTable.h"
+
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
 
 #ifdef USE_FAISS
-#include <faiss/IndexFlat.h>
+#include <faiss/Index.h>
 #include <faiss/index_io.h>
 #endif
 
 class VectorStore_FAISS : public VectorStoreBase {
 public:
-    VectorStore_FAISS(int dimension);
+    // indexFactory is a FAISS index_factory description, e.g. "Flat" (exact L2),
+    // "IVF4096,Flat", "HNSW32" or "IVF1024,PQ64".
+    VectorStore_FAISS(int dimension, const std::string& indexFactory = "Flat");
     ~VectorStore_FAISS() override;
 
     void add(const Embedding& embedding, const VectorMetadata& metadata, const std::string& content) override;
-    std::vector<SearchResult> search(const Embedding& query, int k) override;
+    // Filters are passed to FAISS as an IDSelector over the matching ids, so the index
+    // only scores matching vectors.
+    SearchHits searchHits(const Embedding& query, int k, const SearchFilter& filter = SearchFilter()) override;
+    std::vector<SearchHits> searchHitsBatch(const std::vector<Embedding>& queries, int k, const SearchFilter& filter = SearchFilter()) override;
+    SearchHits getHits(const std::vector<int>& ids) override;
 
+    // save() writes a single file holding the FAISS index, the metadata, the contents
+    // and any vectors still waiting for training, each section with a checksum. It is
+    // written next to 'path' and renamed into place, so a crash leaves the previous
+    // store intact. load() also reads stores saved as an index plus .meta/.contents files.
     bool save(const std::string& path) override;
     bool load(const std::string& path) override;
 
+    bool remove(int id) override;
+    size_t removeBySource(const std::string& source) override;
     void clear() override;
 
     size_t size() const override;
     std::vector<std::string> getSources() const override;
+    std::vector<SourceStats> getSourceStats() const override;
+    int getMaxId() const override;
+    // Distances are squared L2: smaller is closer.
+    bool higherIsCloser() const override { return false; }
+
+    // Removed entries are tombstoned in the metadata table, which is compacted once
+    // the tombstoned fraction exceeds this ratio (default 0.25) and before saving.
+    void setCompactionRatio(float ratio);
+
+    // When enabled, load() leaves chunk contents in the store file instead of copying
+    // them into memory; only the hits' contents are read from disk. Off by default.
+    void setDiskContents(bool enabled);
+    bool getDiskContents() const;
+
+    // --- Training ---
+    // Index types such as IVF and PQ must be trained before vectors can be added.
+    // Until then, added vectors are buffered (and searched exactly) and the index is
+    // trained on them automatically once 'trainingSize' vectors are buffered.
+    bool isTrained() const;
+    // Trains on the buffered vectors and moves them into the index.
+    bool train();
+    // Trains on an explicit sample, then moves any buffered vectors into the index.
+    bool train(const std::vector<Embedding>& samples);
+    // Number of buffered vectors that triggers automatic training
+    // (0 = 39 x nlist for IVF indexes, 10000 otherwise).
+    void setTrainingSize(size_t numVectors);
+    size_t getTrainingSize() const;
+
+    // --- Search-time parameters ---
+    // Sets a FAISS search parameter such as "nprobe" (IVF) or "efSearch" (HNSW).
+    // Parameters are kept and re-applied after load().
+    bool setSearchParameter(const std::string& name, double value);
+    void setNProbe(int nprobe);
+    void setEfSearch(int efSearch);
+
+    const std::string& getIndexFactory() const;
 
 private:
 #ifdef USE_FAISS
-    faiss::IndexFlatL2* index;
+    // Creates an empty index from the factory string (falls back to exact L2 on error).
+    faiss::Index* createIndex() const;
+    // Trains 'index' on n vectors and flushes the buffered vectors into it.
+    bool trainOn(size_t n, const float* samples);
+    void applySearchParameters();
+    // Exact L2 search over the buffered vectors while the index is untrained.
+    SearchHits searchPending(const Embedding& query, int k, const SearchFilter& filter) const;
+    // Searches the trained index with nq packed queries, restricted to the filter if given.
+    void searchIndex(size_t nq, const float* queries, int k, const SearchFilter& filter, std::vector<SearchHits>& results) const;
+    // Search parameters of the index type carrying 'selector', with the index's current settings.
+    std::unique_ptr<faiss::SearchParameters> makeSearchParameters(faiss::IDSelector* selector) const;
+    // Maps up to n FAISS labels to at most k results, skipping stale labels and, if
+    // given, rows not set in 'allowed'.
+    void collectResults(const faiss::idx_t* labels, const float* distances, faiss::idx_t n, int k, const uint8_t* allowed, SearchHits& out) const;
+
+    // Read the store at 'path' into the metadata and pending buffers and return its
+    // index, or nullptr after logging why not.
+    faiss::Index* readStoreFile(const std::string& path);
+    faiss::Index* readLegacyFiles(const std::string& path);
+
+    faiss::Index* index = nullptr;
+    std::vector<faiss::idx_t> pendingIds; // ids of the buffered vectors
 #endif
+    size_t removeIds(const std::vector<int>& ids);
+    void compactMetadata();
+    // Label of a live id's vector in the index.
+    int64_t labelOf(int id) const;
+
     int dimension;
-    std::vector<VectorMetadata> metadatas;
-    std::vector<std::string> contents;
+    std::string indexFactory;
+    size_t trainingSize = 0;
+    std::vector<float> pendingVectors; // row-major, buffered until the index is trained
+    std::vector<std::pair<std::string, double>> searchParameters;
+
+    MetadataTable entries;
+
+    // Stable ids: metadata id -> row in 'entries', with tombstones for removed rows.
+    std::unordered_map<int, size_t> idToRow;
+    std::vector<uint8_t> deleted;
+    size_t deletedCount = 0;
+    // Vectors are labelled with their metadata id. Index types that cannot remove
+    // vectors (e.g. HNSW) keep a removed vector under its label, so an id added again
+    // after that gets a fresh alias label above the int range instead.
+    static constexpr int64_t FIRST_ALIAS_LABEL = (int64_t)1 << 32;
+    std::unordered_map<int, int64_t> idToAlias;
+    std::unordered_map<int64_t, int> aliasToId;
+    std::unordered_set<int64_t> staleLabels; // labels of removed vectors still in the index
+    int64_t nextAlias = FIRST_ALIAS_LABEL;
+    float compactionRatio = 0.25f;
+    bool diskContents = false;
 };
@@ -0,0 +1,906 @@
+/*
+ * ofxRAG
+ *
+ * Copyright (c) 2025 Yannick Hofmann
+ * <contact@yannickhofmann.de>
+ *
+ * BSD Simplified License.
+ * For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ * WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include "VectorStore_HNSW.h"
+#include "SimdKernels.h"
+#include "BinaryIO.h"
+#include "MappedFile.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+// Binary store layout (native endianness):
+//   header | pad to 64 | rows (count x stride floats, unit-normalized) | norms (count floats)
+//   | levels (count int32) | bottom layer links (count x (maxM0 + 1) uint32)
+//   | upper layer links (sum of levels x (M + 1) uint32) | pad to 8 | row records (count)
+//   | string blob (each distinct source/type once, then the contents)
+const char HNSW_STORE_MAGIC[8] = {'O', 'F', 'X', 'R', 'A', 'G', 'H', 'N'};
+const uint32_t HNSW_STORE_VERSION = 1;
+
+struct HnswStoreHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t count;
+    uint64_t dimension;
+    uint64_t stride;
+    uint64_t M;
+    uint64_t maxM0;
+    uint64_t efConstruction;
+    uint32_t entryPoint;
+    int32_t maxLevel;
+    uint64_t matrixOffset;
+    uint64_t normsOffset;
+    uint64_t levelsOffset;
+    uint64_t links0Offset;
+    uint64_t upperLinksOffset;
+    uint64_t upperLinksCount;
+    uint64_t recordsOffset;
+    uint64_t stringsOffset;
+    uint64_t stringsSize;
+};
+
+struct HnswRowRecord {
+    int64_t id;
+    uint64_t sourceOffset;
+    uint64_t sourceLength;
+    uint64_t typeOffset;
+    uint64_t typeLength;
+    uint64_t contentOffset;
+    uint64_t contentLength;
+};
+
+// Below this many nodes a batch is linked on the calling thread.
+const size_t PARALLEL_INSERT_MIN = 256;
+
+} // namespace
+
+//--------------------------------------------------------------
+VectorStore_HNSW::VectorStore_HNSW(size_t M, size_t efConstruction)
+    : M(std::max<size_t>(2, M)), maxM0(2 * std::max<size_t>(2, M)), efConstruction(std::max(efConstruction, M)), levelRng(100) {
+    levelMultiplier = 1.0 / std::log((double)this->M);
+    ofLogNotice("VectorStore_HNSW") << "Initialized HNSW vector store (M: " << this->M << ", efConstruction: " << this->efConstruction << ", dot product kernel: " << ofxragSimdKernelName() << ").";
+}
+
+//--------------------------------------------------------------
+VectorStore_HNSW::~VectorStore_HNSW() {
+    ofLogNotice("VectorStore_HNSW") << "Destructed.";
+}
+
+//--------------------------------------------------------------
+void VectorStore_HNSW::add(const Embedding& embedding, const VectorMetadata& meta, const std::string& content) {
+    addBatch({embedding}, {meta}, {content});
+}
+
+//--------------------------------------------------------------
+void VectorStore_HNSW::addBatch(const std::vector<Embedding>& embeddings, const std::vector<VectorMetadata>& metas, const std::vector<std::string>& texts) {
+    if (embeddings.size() != metas.size() || embeddings.size() != texts.size()) {
+        ofLogError("VectorStore_HNSW") << "Batch sizes differ: " << embeddings.size() << " embeddings, " << metas.size() << " metadata, " << texts.size() << " contents.";
+        return;
+    }
+    NodeId first = (NodeId)levels.size();
+    matrix.reserve((levels.size() + embeddings.size()) * std::max<size_t>(stride, 1));
+    AlignedFloatVector row;
+    for (size_t i = 0; i < embeddings.size(); ++i) {
+        const Embedding& embedding = embeddings[i];
+        if (embedding.empty()) {
+            ofLogWarning("VectorStore_HNSW") << "Attempted to add empty embedding.";
+            continue;
+        }
+        if (dimension != 0 && embedding.size() != dimension) {
+            ofLogWarning("VectorStore_HNSW") << "Embedding dimension mismatch. Expected " << dimension << ", got " << embedding.size();
+            continue;
+        }
+        if (dimension == 0) {
+            dimension = embedding.size();
+            stride = ofxragPaddedStride(dimension);
+            matrix.reserve(embeddings.size() * stride);
+        }
+        auto existing = idToRow.find(metas[i].id);
+        if (existing != idToRow.end()) {
+            markDeleted(existing->second);
+        }
+        prepareQuery(embedding, row);
+        appendNode(row.data(), std::sqrt(ofxragDotProduct(embedding.data(), embedding.data(), dimension)), metas[i].id, metas[i].source, metas[i].type, texts[i]);
+    }
+    insertNodes(first, (NodeId)levels.size());
+    ofLogVerbose("VectorStore_HNSW") << "Added " << levels.size() - first << " embeddings, current size: " << size();
+    compactIfNeeded();
+}
+
+//--------------------------------------------------------------
+SearchHits VectorStore_HNSW::searchHits(const Embedding& query, int top_k, const SearchFilter& filter) {
+    if (size() == 0) {
+        ofLogNotice("VectorStore_HNSW") << "Store is empty, no search results.";
+        return {};
+    }
+    if (query.size() != dimension) {
+        ofLogWarning("VectorStore_HNSW") << "Query embedding dimension mismatch. Expected " << dimension << ", got " << query.size();
+        return {};
+    }
+    std::vector<uint8_t> allowed;
+    size_t allowedCount = filter.empty() ? size() : entries.buildMask(filter, deleted, allowed);
+    AlignedFloatVector q;
+    prepareQuery(query, q);
+    return searchPrepared(q.data(), top_k, filter.empty() ? nullptr : allowed.data(), allowedCount);
+}
+
+//--------------------------------------------------------------
+std::vector<SearchHits> VectorStore_HNSW::searchHitsBatch(const std::vector<Embedding>& queries, int top_k, const SearchFilter& filter) {
+    std::vector<SearchHits> results(queries.size());
+    if (size() == 0 || queries.empty()) {
+        return results;
+    }
+    for (const auto& query : queries) {
+        if (query.size() != dimension) {
+            ofLogWarning("VectorStore_HNSW") << "Batch query dimension mismatch. Expected " << dimension << ", got " << query.size();
+            return results;
+        }
+    }
+    std::vector<uint8_t> allowed;
+    size_t allowedCount = filter.empty() ? size() : entries.buildMask(filter, deleted, allowed);
+    const uint8_t* mask = filter.empty() ? nullptr : allowed.data();
+
+    // Graph walks are independent per query, so the batch is spread over the pool.
+    auto runQuery = [&](size_t i, size_t) {
+        AlignedFloatVector q;
+        prepareQuery(queries[i], q);
+        results[i] = searchPrepared(q.data(), top_k, mask, allowedCount);
+    };
+    size_t threads = ThreadPool::resolveThreadCount(numThreads);
+    if (threads > 1 && queries.size() > 1) {
+        getThreadPool(threads)->parallelFor(queries.size(), runQuery);
+    } else {
+        for (size_t i = 0; i < queries.size(); ++i) {
+            runQuery(i, 0);
+        }
+    }
+    return results;
+}
+
+//--------------------------------------------------------------
+SearchHits VectorStore_HNSW::getHits(const std::vector<int>& ids) {
+    SearchHits results;
+    for (int id : ids) {
+        auto it = idToRow.find(id);
+        if (it != idToRow.end()) {
+            results.hits.push_back(entries.hit(it->second, 0.0f));
+        }
+    }
+    results.lease = entries.lease();
+    return results;
+}
+
+//--------------------------------------------------------------
+bool VectorStore_HNSW::remove(int id) {
+    auto it = idToRow.find(id);
+    if (it == idToRow.end()) {
+        return false;
+    }
+    markDeleted(it->second);
+    compactIfNeeded();
+    return true;
+}
+
+//--------------------------------------------------------------
+size_t VectorStore_HNSW::removeBySource(const std::string& source) {
+    size_t removed = 0;
+    for (size_t row : entries.rowsOf(source)) {
+        if (!deleted[row]) {
+            markDeleted(row);
+            ++removed;
+        }
+    }
+    if (removed > 0) {
+        ofLogNotice("VectorStore_HNSW") << "Removed " << removed << " entries of source: " << source;
+        compactIfNeeded();
+    }
+    return removed;
+}
+
+//--------------------------------------------------------------
+void VectorStore_HNSW::clear() {
+    dimension = 0;
+    stride = 0;
+    matrix.clear();
+    norms.clear();
+    levels.clear();
+    links0.clear();
+    upperLinks.clear();
+    nodeLocks.clear();
+    entryPoint = NO_NODE;
+    maxLevel = -1;
+    entries.clear();
+    idToRow.clear();
+    deleted.clear();
+    deletedCount = 0;
+    ofLogNotice("VectorStore_HNSW") << "Store cleared.";
+}
+
+//--------------------------------------------------------------
+bool VectorStore_HNSW::save(const std::string& filepath) {
+    compact(); // only live nodes are written
+    size_t count = levels.size();
+    BinaryWriter writer;
+    if (!writer.open(filepath)) {
+        ofLogError("VectorStore_HNSW") << "Cannot open " << filepath << " for writing.";
+        return false;
+    }
+
+    HnswStoreHeader header = {};
+    std::memcpy(header.magic, HNSW_STORE_MAGIC, sizeof(header.magic));
+    header.version = HNSW_STORE_VERSION;
+    header.headerSize = sizeof(HnswStoreHeader);
+    header.count = count;
+    header.dimension = dimension;
+    header.stride = stride;
+    header.M = M;
+    header.maxM0 = maxM0;
+    header.efConstruction = efConstruction;
+    header.entryPoint = entryPoint;
+    header.maxLevel = maxLevel;
+    writer.write(header);
+
+    writer.pad(64);
+    header.matrixOffset = writer.tell();
+    writer.writeBytes(matrix.data(), count * stride * sizeof(float));
+    header.normsOffset = writer.tell();
+    writer.writeBytes(norms.data(), count * sizeof(float));
+    header.levelsOffset = writer.tell();
+    for (int level : levels) {
+        writer.write((int32_t)level);
+    }
+    header.links0Offset = writer.tell();
+    writer.writeBytes(links0.data(), links0.size() * sizeof(uint32_t));
+    header.upperLinksOffset = writer.tell();
+    for (const auto& block : upperLinks) {
+        writer.writeBytes(block.data(), block.size() * sizeof(uint32_t));
+        header.upperLinksCount += block.size();
+    }
+
+    writer.pad(8);
+    header.recordsOffset = writer.tell();
+    std::vector<uint64_t> contentOffsets = entries.contentBlobOffsets();
+    for (size_t i = 0; i < count; ++i) {
+        HnswRowRecord record = {};
+        record.id = entries.id(i);
+        record.sourceOffset = entries.sourceBlobOffset(i);
+        record.sourceLength = entries.source(i).size();
+        record.typeOffset = entries.typeBlobOffset(i);
+        record.typeLength = entries.type(i).size();
+        record.contentOffset = contentOffsets[i];
+        record.contentLength = entries.contentLength(i);
+        writer.write(record);
+    }
+
+    header.stringsOffset = writer.tell();
+    header.stringsSize = entries.blobSize();
+    entries.writeBlob(writer);
+
+    writer.patch(0, header);
+    if (!writer.commit()) {
+        ofLogError("VectorStore_HNSW") << "Failed to write store to " << filepath;
+        return false;
+    }
+    ofLogNotice("VectorStore_HNSW") << "Saved " << count << " items to " << filepath;
+    return true;
+}
+
+//--------------------------------------------------------------
+bool VectorStore_HNSW::load(const std::string& filepath) {
+    MappedFile file;
+    if (!file.open(filepath)) {
+        ofLogError("VectorStore_HNSW") << "Failed to open store " << filepath;
+        return false;
+    }
+    const HnswStoreHeader* header = file.at<HnswStoreHeader>(0);
+    if (!header || std::memcmp(header->magic, HNSW_STORE_MAGIC, sizeof(header->magic)) != 0) {
+        ofLogError("VectorStore_HNSW") << filepath << " is not an HNSW store.";
+        return false;
+    }
+    if (header->version != HNSW_STORE_VERSION || header->headerSize != sizeof(HnswStoreHeader)) {
+        ofLogError("VectorStore_HNSW") << "Unsupported store version in " << filepath;
+        return false;
+    }
+    uint64_t count = header->count;
+    const float* fileRows = file.at<float>(header->matrixOffset, count * header->stride);
+    const float* fileNorms = file.at<float>(header->normsOffset, count);
+    const int32_t* fileLevels = file.at<int32_t>(header->levelsOffset, count);
+    const uint32_t* fileLinks0 = file.at<uint32_t>(header->links0Offset, count * (header->maxM0 + 1));
+    const uint32_t* fileUpper = file.at<uint32_t>(header->upperLinksOffset, header->upperLinksCount);
+    const HnswRowRecord* records = file.at<HnswRowRecord>(header->recordsOffset, count);
+    const char* strings = file.at<char>(header->stringsOffset, header->stringsSize);
+    if ((count > 0 && (!fileRows || !fileNorms || !fileLevels || !fileLinks0 || !fileUpper || !records || !strings)) ||
+        header->stride != ofxragPaddedStride(header->dimension) || header->M < 2 || header->maxM0 != 2 * header->M ||
+        (count > 0 && header->entryPoint >= count)) {
+        ofLogError("VectorStore_HNSW") << "Store " << filepath << " is truncated or corrupt.";
+        return false;
+    }
+
+    clear();
+
+    // The graph keeps its build parameters
+    M = header->M;
+    maxM0 = header->maxM0;
+    efConstruction = header->efConstruction;
+    levelMultiplier = 1.0 / std::log((double)M);
+    dimension = header->dimension;
+    stride = header->stride;
+    entryPoint = count > 0 ? header->entryPoint : NO_NODE;
+    maxLevel = count > 0 ? header->maxLevel : -1;
+
+    matrix.assign(fileRows, fileRows + count * stride);
+    norms.assign(fileNorms, fileNorms + count);
+    levels.assign(fileLevels, fileLevels + count);
+    links0.assign(fileLinks0, fileLinks0 + count * (maxM0 + 1));
+    upperLinks.resize(count);
+    uint64_t upperCursor = 0;
+    bool valid = true;
+    for (size_t i = 0; i < count && valid; ++i) {
+        uint64_t blockSize = (uint64_t)std::max(levels[i], 0) * (M + 1);
+        valid = levels[i] >= 0 && levels[i] <= maxLevel && upperCursor + blockSize <= header->upperLinksCount;
+        if (valid) {
+            upperLinks[i].assign(fileUpper + upperCursor, fileUpper + upperCursor + blockSize);
+            upperCursor += blockSize;
+        }
+    }
+    for (size_t i = 0; i < count && valid; ++i) {
+        for (int level = 0; level <= levels[i] && valid; ++level) {
+            const uint32_t* block = linkBlock((NodeId)i, level);
+            valid = block[0] <= maxLinks(level) && std::all_of(block + 1, block + 1 + block[0], [count](uint32_t n) { return n < count; });
+        }
+    }
+    if (!valid) {
+        ofLogError("VectorStore_HNSW") << "Store " << filepath << " has an invalid graph.";
+        clear();
+        return false;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        nodeLocks.emplace_back();
+    }
+
+    // With disk contents only the rows are built here; contents are read from the file on demand.
+    std::shared_ptr<MappedFile> contentFile;
+    if (diskContents) {
+        contentFile = std::make_shared<MappedFile>();
+        if (!contentFile->open(filepath)) {
+            ofLogError("VectorStore_HNSW") << "Failed to map contents of " << filepath;
+            clear();
+            return false;
+        }
+        entries.setContentFile(contentFile);
+    }
+    entries.reserve(count, contentFile ? 0 : header->stringsSize);
+    uint64_t blobSize = header->stringsSize;
+    auto inBlob = [blobSize](uint64_t offset, uint64_t length) {
+        return offset <= blobSize && length <= blobSize - offset;
+    };
+    for (uint64_t i = 0; i < count; ++i) {
+        const HnswRowRecord& record = records[i];
+        if (!inBlob(record.sourceOffset, record.sourceLength) || !inBlob(record.typeOffset, record.typeLength) ||
+            !inBlob(record.contentOffset, record.contentLength)) {
+            ofLogError("VectorStore_HNSW") << "Store " << filepath << " has an invalid string table.";
+            clear();
+            return false;
+        }
+        std::string_view source(strings + record.sourceOffset, record.sourceLength);
+        std::string_view type(strings + record.typeOffset, record.typeLength);
+        if (contentFile) {
+            entries.appendMapped((int)record.id, source, type, header->stringsOffset + record.contentOffset, (uint32_t)record.contentLength);
+        } else {
+            entries.append((int)record.id, source, type, std::string_view(strings + record.contentOffset, record.contentLength));
+        }
+        idToRow[(int)record.id] = (size_t)i;
+    }
+    deleted.assign(count, 0);
+
+    ofLogNotice("VectorStore_HNSW") << "Loaded " << count << " items (M: " << M << ") from " << filepath;
+    return true;
+}
+
+//--------------------------------------------------------------
+size_t VectorStore_HNSW::size() const {
+    return levels.size() - deletedCount;
+}
+
+//--------------------------------------------------------------
+std::vector<std::string> VectorStore_HNSW::getSources() const {
+    return entries.documentSources();
+}
+
+//--------------------------------------------------------------
+std::vector<SourceStats> VectorStore_HNSW::getSourceStats() const {
+    return entries.documentStats();
+}
+
+//--------------------------------------------------------------
+int VectorStore_HNSW::getMaxId() const {
+    int maxId = -1;
+    for (const auto& entry : idToRow) {
+        maxId = std::max(maxId, entry.first);
+    }
+    return maxId;
+}
+
+//--------------------------------------------------------------
+void VectorStore_HNSW::setEfSearch(size_t ef) {
+    efSearch = std::max<size_t>(1, ef);
+}
+
+//--------------------------------------------------------------
+size_t VectorStore_HNSW::getEfSearch() const {
+    return efSearch;
+}
+
+//--------------------------------------------------------------
+size_t VectorStore_HNSW::getM() const {
+    return M;
+}
+
+//--------------------------------------------------------------
+size_t VectorStore_HNSW::getEfConstruction() const {
+    return efConstruction;
+}
+
+//--------------------------------------------------------------
+void VectorStore_HNSW::compact() {
+    if (deletedCount == 0) {
+        return;
+    }
+    // Removed nodes cannot simply be unlinked without hurting the graph,
+    // so the live nodes are re-inserted into a fresh one.
+    AlignedFloatVector oldMatrix;
+    std::vector<float> oldNorms;
+    MetadataTable oldEntries;
+    std::vector<uint8_t> oldDeleted;
+    oldMatrix.swap(matrix);
+    oldNorms.swap(norms);
+    std::swap(oldEntries, entries);
+    oldDeleted.swap(deleted);
+    size_t dropped = deletedCount;
+
+    levels.clear();
+    links0.clear();
+    upperLinks.clear();
+    nodeLocks.clear();
+    entryPoint = NO_NODE;
+    maxLevel = -1;
+    idToRow.clear();
+    deletedCount = 0;
+
+    matrix.reserve((oldNorms.size() - dropped) * stride);
+    for (size_t i = 0; i < oldNorms.size(); ++i) {
+        if (!oldDeleted[i]) {
+            appendNode(oldMatrix.data() + i * stride, oldNorms[i], oldEntries.id(i), oldEntries.source(i), oldEntries.type(i), oldEntries.content(i));
+        }
+    }
+    insertNodes(0, (NodeId)levels.size());
+    ofLogVerbose("VectorStore_HNSW") << "Rebuilt graph, dropped " << dropped << " removed nodes.";
+}
+
+//--------------------------------------------------------------
+void VectorStore_HNSW::setCompactionRatio(float ratio) {
+    compactionRatio = ratio;
+}
+
+//--------------------------------------------------------------
+void VectorStore_HNSW::setNumThreads(size_t numThreads) {
+    this->numThreads = numThreads;
+    std::lock_guard<std::mutex> lock(poolMutex);
+    threadPool.reset();
+}
+
+//--------------------------------------------------------------
+size_t VectorStore_HNSW::getNumThreads() const {
+    return ThreadPool::resolveThreadCount(numThreads);
+}
+
+//--------------------------------------------------------------
+void VectorStore_HNSW::setDiskContents(bool enabled) {
+    diskContents = enabled;
+}
+
+//--------------------------------------------------------------
+bool VectorStore_HNSW::getDiskContents() const {
+    return diskContents;
+}
+
+//--------------------------------------------------------------
+void VectorStore_HNSW::markDeleted(size_t row) {
+    if (deleted[row]) {
+        return;
+    }
+    deleted[row] = 1;
+    ++deletedCount;
+    idToRow.erase(entries.id(row));
+    entries.releaseContent(row);
+}
+
+//--------------------------------------------------------------
+void VectorStore_HNSW::compactIfNeeded() {
+    if (deletedCount > 0 && deletedCount >= compactionRatio * levels.size()) {
+        compact();
+    }
+}
+
+//--------------------------------------------------------------
+void VectorStore_HNSW::VisitedList::reset(size_t nodes) {
+    if (marks.size() < nodes) {
+        marks.resize(nodes, 0);
+    }
+    if (++tag == 0) {
+        std::fill(marks.begin(), marks.end(), 0);
+        tag = 1;
+    }
+}
+
+//--------------------------------------------------------------
+bool VectorStore_HNSW::VisitedList::visit(NodeId node) {
+    if (marks[node] == tag) {
+        return false;
+    }
+    marks[node] = tag;
+    return true;
+}
+
+//--------------------------------------------------------------
+std::unique_ptr<VectorStore_HNSW::VisitedList> VectorStore_HNSW::acquireVisited() const {
+    std::unique_ptr<VisitedList> list;
+    {
+        std::lock_guard<std::mutex> lock(visitedMutex);
+        if (!visitedPool.empty()) {
+            list = std::move(visitedPool.back());
+            visitedPool.pop_back();
+        }
+    }
+    if (!list) {
+        list = std::make_unique<VisitedList>();
+    }
+    list->reset(levels.size());
+    return list;
+}
+
+//--------------------------------------------------------------
+void VectorStore_HNSW::releaseVisited(std::unique_ptr<VisitedList> list) const {
+    std::lock_guard<std::mutex> lock(visitedMutex);
+    visitedPool.push_back(std::move(list));
+}
+
+//--------------------------------------------------------------
+VectorStore_HNSW::NodeId VectorStore_HNSW::appendNode(const float* row, float norm, int id, std::string_view source, std::string_view type, std::string_view content) {
+    NodeId node = (NodeId)levels.size();
+    matrix.insert(matrix.end(), row, row + stride);
+    norms.push_back(norm);
+    int level = randomLevel();
+    levels.push_back(level);
+    links0.resize(links0.size() + maxM0 + 1, 0);
+    upperLinks.emplace_back((size_t)level * (M + 1), 0);
+    nodeLocks.emplace_back();
+    idToRow[id] = node;
+    deleted.push_back(0);
+    entries.append(id, source, type, content);
+    return node;
+}
+
+//--------------------------------------------------------------
+void VectorStore_HNSW::insertNodes(NodeId first, NodeId end) {
+    NodeId next = first;
+    if (entryPoint == NO_NODE && next < end) {
+        insertNode(next++); // the first node only becomes the entry point
+    }
+    size_t pending = end - next;
+    size_t threads = ThreadPool::resolveThreadCount(numThreads);
+    if (threads <= 1 || pending < PARALLEL_INSERT_MIN) {
+        for (NodeId node = next; node < end; ++node) {
+            insertNode(node);
+        }
+        return;
+    }
+    getThreadPool(threads)->parallelFor(pending, [&](size_t task, size_t) {
+        insertNode(next + (NodeId)task);
+    });
+}
+
+//--------------------------------------------------------------
+void VectorStore_HNSW::insertNode(NodeId node) {
+    int level = levels[node];
+    // Held for the whole insertion when this node becomes the new top of the graph.
+    std::unique_lock<std::mutex> entryLock(entryMutex);
+    NodeId entry = entryPoint;
+    int topLevel = maxLevel;
+    if (entry == NO_NODE) {
+        entryPoint = node;
+        maxLevel = level;
+        return;
+    }
+    if (level <= topLevel) {
+        entryLock.unlock();
+    }
+
+    const float* query = rowData(node);
+    NodeId current = descend(query, entry, topLevel, level, true);
+    for (int lc = std::min(level, topLevel); lc >= 0; --lc) {
+        FarthestFirst candidates = searchLayer(query, current, efConstruction, lc, nullptr, false, true);
+        current = connectNeighbors(node, candidates, lc);
+    }
+
+    if (level > topLevel) {
+        entryPoint = node;
+        maxLevel = level;
+    }
+}
+
+//--------------------------------------------------------------
+int VectorStore_HNSW::randomLevel() {
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    double r = 1.0 - uniform(levelRng); // (0, 1]
+    return (int)(-std::log(r) * levelMultiplier);
+}
+
+//--------------------------------------------------------------
+VectorStore_HNSW::FarthestFirst VectorStore_HNSW::searchLayer(const float* query, NodeId entry, size_t ef, int level, const uint8_t* allowed, bool skipDeleted, bool locking) const {
+    std::unique_ptr<VisitedList> visited = acquireVisited();
+    FarthestFirst top;
+    // Closest-first queue of nodes still to expand (distances negated).
+    std::priority_queue<DistanceNode> frontier;
+
+    float entryDistance = distance(query, rowData(entry));
+    float bound = std::numeric_limits<float>::max();
+    auto keep = [&](NodeId node) {
+        return (!allowed || allowed[node]) && (!skipDeleted || !deleted[node]);
+    };
+    if (keep(entry)) {
+        top.emplace(entryDistance, entry);
+        bound = entryDistance;
+    }
+    frontier.emplace(-entryDistance, entry);
+    visited->visit(entry);
+
+    std::vector<uint32_t> neighbors;
+    while (!frontier.empty()) {
+        DistanceNode closest = frontier.top();
+        if (-closest.first > bound && top.size() >= ef) {
+            break;
+        }
+        frontier.pop();
+
+        const uint32_t* block = linkBlock(closest.second, level);
+        if (locking) {
+            std::lock_guard<std::mutex> lock(nodeLocks[closest.second]);
+            neighbors.assign(block + 1, block + 1 + block[0]);
+        } else {
+            neighbors.assign(block + 1, block + 1 + block[0]);
+        }
+
+        for (uint32_t neighbor : neighbors) {
+            if (!visited->visit(neighbor)) {
+                continue;
+            }
+            float d = distance(query, rowData(neighbor));
+            if (top.size() < ef || d < bound) {
+                frontier.emplace(-d, neighbor);
+                if (keep(neighbor)) {
+                    top.emplace(d, neighbor);
+                    if (top.size() > ef) {
+                        top.pop();
+                    }
+                }
+                if (!top.empty()) {
+                    bound = top.top().first;
+                }
+            }
+        }
+    }
+    releaseVisited(std::move(visited));
+    return top;
+}
+
+//--------------------------------------------------------------
+VectorStore_HNSW::NodeId VectorStore_HNSW::descend(const float* query, NodeId entry, int fromLevel, int level, bool locking) const {
+    NodeId current = entry;
+    float currentDistance = distance(query, rowData(current));
+    std::vector<uint32_t> neighbors;
+    for (int lc = fromLevel; lc > level; --lc) {
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            const uint32_t* block = linkBlock(current, lc);
+            if (locking) {
+                std::lock_guard<std::mutex> lock(nodeLocks[current]);
+                neighbors.assign(block + 1, block + 1 + block[0]);
+            } else {
+                neighbors.assign(block + 1, block + 1 + block[0]);
+            }
+            for (uint32_t neighbor : neighbors) {
+                float d = distance(query, rowData(neighbor));
+                if (d < currentDistance) {
+                    currentDistance = d;
+                    current = neighbor;
+                    changed = true;
+                }
+            }
+        }
+    }
+    return current;
+}
+
+//--------------------------------------------------------------
+std::vector<VectorStore_HNSW::NodeId> VectorStore_HNSW::selectNeighbors(FarthestFirst& candidates, size_t maxCount) const {
+    std::vector<DistanceNode> closestFirst;
+    closestFirst.reserve(candidates.size());
+    while (!candidates.empty()) {
+        closestFirst.push_back(candidates.top());
+        candidates.pop();
+    }
+    std::reverse(closestFirst.begin(), closestFirst.end());
+
+    // Keep a candidate only if it is closer to the base node than to every
+    // neighbour kept so far, which spreads the links over different directions.
+    std::vector<NodeId> selected;
+    selected.reserve(maxCount);
+    for (const auto& candidate : closestFirst) {
+        if (selected.size() >= maxCount) {
+            break;
+        }
+        bool keep = true;
+        for (NodeId other : selected) {
+            if (distance(rowData(candidate.second), rowData(other)) < candidate.first) {
+                keep = false;
+                break;
+            }
+        }
+        if (keep) {
+            selected.push_back(candidate.second);
+        }
+    }
+    return selected;
+}
+
+//--------------------------------------------------------------
+VectorStore_HNSW::NodeId VectorStore_HNSW::connectNeighbors(NodeId node, FarthestFirst& candidates, int level) {
+    // Another thread may already have linked this node; never link it to itself.
+    FarthestFirst others;
+    NodeId fallback = candidates.empty() ? node : candidates.top().second;
+    while (!candidates.empty()) {
+        if (candidates.top().second != node) {
+            others.push(candidates.top());
+        }
+        candidates.pop();
+    }
+    std::vector<NodeId> selected = selectNeighbors(others, M);
+    if (selected.empty()) {
+        return fallback;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(nodeLocks[node]);
+        uint32_t* block = linkBlock(node, level);
+        block[0] = (uint32_t)selected.size();
+        std::copy(selected.begin(), selected.end(), block + 1);
+    }
+
+    size_t limit = maxLinks(level);
+    for (NodeId neighbor : selected) {
+        std::lock_guard<std::mutex> lock(nodeLocks[neighbor]);
+        uint32_t* block = linkBlock(neighbor, level);
+        size_t count = block[0];
+        if (std::find(block + 1, block + 1 + count, node) != block + 1 + count) {
+            continue;
+        }
+        if (count < limit) {
+            block[1 + count] = node;
+            block[0] = (uint32_t)(count + 1);
+            continue;
+        }
+        // Full: re-select the neighbour's links from its old links plus the new node.
+        FarthestFirst pool;
+        const float* base = rowData(neighbor);
+        pool.emplace(distance(base, rowData(node)), node);
+        for (size_t i = 1; i <= count; ++i) {
+            pool.emplace(distance(base, rowData(block[i])), block[i]);
+        }
+        std::vector<NodeId> pruned = selectNeighbors(pool, limit);
+        block[0] = (uint32_t)pruned.size();
+        std::copy(pruned.begin(), pruned.end(), block + 1);
+    }
+    return selected.front();
+}
+
+//--------------------------------------------------------------
+uint32_t* VectorStore_HNSW::linkBlock(NodeId node, int level) {
+    if (level == 0) {
+        return links0.data() + (size_t)node * (maxM0 + 1);
+    }
+    return upperLinks[node].data() + (size_t)(level - 1) * (M + 1);
+}
+
+//--------------------------------------------------------------
+const uint32_t* VectorStore_HNSW::linkBlock(NodeId node, int level) const {
+    return const_cast<VectorStore_HNSW*>(this)->linkBlock(node, level);
+}
+
+//--------------------------------------------------------------
+float VectorStore_HNSW::distance(const float* a, const float* b) const {
+    return 1.0f - ofxragDotProduct(a, b, stride);
+}
+
+//--------------------------------------------------------------
+SearchHits VectorStore_HNSW::searchPrepared(const float* query, int top_k, const uint8_t* allowed, size_t allowedCount) const {
+    size_t k = std::min<size_t>(std::max(top_k, 0), allowedCount);
+    if (k == 0 || entryPoint == NO_NODE) {
+        return {};
+    }
+    size_t ef = std::max(efSearch, k);
+    FarthestFirst top;
+
+    // A selective filter leaves few matching nodes along the graph walk, so scanning the
+    // matching rows directly is both exact and cheaper than a wide walk.
+    if (allowed && allowedCount <= std::max(ef * maxM0, levels.size() / 20)) {
+        for (NodeId node = 0; node < (NodeId)levels.size(); ++node) {
+            if (!allowed[node]) {
+                continue;
+            }
+            float d = distance(query, rowData(node));
+            if (top.size() < k) {
+                top.emplace(d, node);
+            } else if (d < top.top().first) {
+                top.pop();
+                top.emplace(d, node);
+            }
+        }
+        return makeHits(top);
+    }
+
+    NodeId current = descend(query, entryPoint, maxLevel, 0, false);
+    top = searchLayer(query, current, ef, 0, allowed, !allowed && deletedCount > 0, false);
+    while (top.size() > k) {
+        top.pop();
+    }
+    return makeHits(top);
+}
+
+//--------------------------------------------------------------
+SearchHits VectorStore_HNSW::makeHits(FarthestFirst& top) const {
+    SearchHits results;
+    results.hits.resize(top.size());
+    for (size_t i = top.size(); i-- > 0;) {
+        // cosine similarity, as VectorStore_Cosine
+        results.hits[i] = entries.hit(top.top().second, 1.0f - top.top().first);
+        top.pop();
+    }
+    results.lease = entries.lease();
+    return results;
+}
+
+//--------------------------------------------------------------
+void VectorStore_HNSW::prepareQuery(const Embedding& query, AlignedFloatVector& out) const {
+    out.assign(stride, 0.0f);
+    float norm = std::sqrt(ofxragDotProduct(query.data(), query.data(), dimension));
+    if (norm == 0.0f) {
+        return;
+    }
+    float inv = 1.0f / norm;
+    for (size_t i = 0; i < dimension; ++i) {
+        out[i] = query[i] * inv;
+    }
+}
+
+//--------------------------------------------------------------
+std::shared_ptr<ThreadPool> VectorStore_HNSW::getThreadPool(size_t threads) {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    if (!threadPool || threadPool->getNumThreads() != threads - 1) {
+        threadPool = std::make_shared<ThreadPool>(threads - 1);
+    }
+    return threadPool;
+}
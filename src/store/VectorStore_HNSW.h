@@ -0,0 +1,173 @@
+/*
+ * ofxRAG
+ *
+ * Copyright (c) 2025 Yannick Hofmann
+ * <contact@yannickhofmann.de>
+ *
+ * BSD Simplified License.
+ * For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ * WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#include "VectorStoreBase.h"
+#include "AlignedBuffer.h"
+#include "MetadataTable.h"
+#include "ThreadPool.h"
+
+#include <deque>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <unordered_map>
+
+// Approximate cosine-similarity store built on an HNSW graph
+// (Malkov & Yashunin, "Hierarchical Navigable Small World graphs").
+// Self-contained: needs no FAISS, OpenMP or BLAS. Scores are cosine
+// similarities, as in VectorStore_Cosine.
+class VectorStore_HNSW : public VectorStoreBase {
+public:
+    // M: links per node on the upper layers (2 x M on the bottom layer).
+    // efConstruction: candidate list size while inserting; higher builds a better graph, slower.
+    VectorStore_HNSW(size_t M = 16, size_t efConstruction = 200);
+    ~VectorStore_HNSW() override;
+
+    void add(const Embedding& embedding, const VectorMetadata& metadata, const std::string& content) override;
+    // Inserts the batch on the worker pool; nodes are linked concurrently under per-node locks.
+    void addBatch(const std::vector<Embedding>& embeddings, const std::vector<VectorMetadata>& metadata, const std::vector<std::string>& contents) override;
+    // Filtered searches walk the graph as usual and only collect matching nodes; when
+    // the filter selects only a small part of the store, its rows are scanned exactly instead.
+    SearchHits searchHits(const Embedding& query, int top_k, const SearchFilter& filter = SearchFilter()) override;
+    // Answers the queries in parallel on the worker pool.
+    std::vector<SearchHits> searchHitsBatch(const std::vector<Embedding>& queries, int top_k, const SearchFilter& filter = SearchFilter()) override;
+    SearchHits getHits(const std::vector<int>& ids) override;
+    bool remove(int id) override;
+    size_t removeBySource(const std::string& source) override;
+    void clear() override;
+
+    // Binary format holding vectors, graph and metadata.
+    bool save(const std::string& filepath) override;
+    bool load(const std::string& filepath) override;
+
+    size_t size() const override;
+    std::vector<std::string> getSources() const override;
+    std::vector<SourceStats> getSourceStats() const override;
+    int getMaxId() const override;
+
+    // Candidate list size at query time (default 64); raised to top_k when smaller.
+    // Higher gives better recall at the cost of speed.
+    void setEfSearch(size_t ef);
+    size_t getEfSearch() const;
+    size_t getM() const;
+    size_t getEfConstruction() const;
+
+    // Removed nodes stay in the graph for navigation but are never returned.
+    // Once their fraction exceeds the ratio (default 0.25), and before saving,
+    // the graph is rebuilt from the live nodes.
+    void compact();
+    void setCompactionRatio(float ratio);
+
+    // When enabled, load() leaves chunk contents in the store file instead of copying
+    // them into memory; only the hits' contents are read from disk. Off by default.
+    void setDiskContents(bool enabled);
+    bool getDiskContents() const;
+
+    // Threads used for batch insertion and batch search (0 = all hardware threads).
+    void setNumThreads(size_t numThreads);
+    size_t getNumThreads() const;
+
+private:
+    using NodeId = uint32_t;
+    // (distance, node); distance = 1 - cosine similarity
+    using DistanceNode = std::pair<float, NodeId>;
+    // Max-heap: farthest node on top
+    using FarthestFirst = std::priority_queue<DistanceNode>;
+
+    // Per-thread visited marks, reset in O(1) by bumping the tag.
+    struct VisitedList {
+        std::vector<uint16_t> marks;
+        uint16_t tag = 0;
+        void reset(size_t nodes);
+        bool visit(NodeId node);
+    };
+    std::unique_ptr<VisitedList> acquireVisited() const;
+    void releaseVisited(std::unique_ptr<VisitedList> list) const;
+
+    // Appends a unit-normalized row and its metadata as a new, not yet linked node.
+    NodeId appendNode(const float* row, float norm, int id, std::string_view source, std::string_view type, std::string_view content);
+    void markDeleted(size_t row);
+    void compactIfNeeded();
+    // Links a node appended by appendNode() into the graph. Safe to call concurrently.
+    void insertNode(NodeId node);
+    // Links nodes [first, end), in parallel when the batch is large enough.
+    void insertNodes(NodeId first, NodeId end);
+    int randomLevel();
+
+    // Greedy search on one layer from 'entry', keeping the 'ef' closest nodes. Every node is
+    // used for navigation, but only nodes set in 'allowed' (if given) and, with skipDeleted,
+    // not deleted are kept.
+    FarthestFirst searchLayer(const float* query, NodeId entry, size_t ef, int level, const uint8_t* allowed, bool skipDeleted, bool locking) const;
+    // Greedy descent through the upper layers down to (and excluding) 'level'.
+    NodeId descend(const float* query, NodeId entry, int fromLevel, int level, bool locking) const;
+    // Picks up to maxLinks diverse neighbours from the candidates (heuristic from the paper).
+    std::vector<NodeId> selectNeighbors(FarthestFirst& candidates, size_t maxLinks) const;
+    // Links 'node' with the selected neighbours at 'level' and returns the closest one.
+    NodeId connectNeighbors(NodeId node, FarthestFirst& candidates, int level);
+
+    // Link block of a node on a level: [count, id0, id1, ...].
+    uint32_t* linkBlock(NodeId node, int level);
+    const uint32_t* linkBlock(NodeId node, int level) const;
+    size_t maxLinks(int level) const { return level == 0 ? maxM0 : M; }
+
+    float distance(const float* a, const float* b) const;
+    const float* rowData(NodeId node) const { return matrix.data() + (size_t)node * stride; }
+    // 'allowed' is nullptr or a filter mask selecting 'allowedCount' nodes.
+    SearchHits searchPrepared(const float* query, int top_k, const uint8_t* allowed, size_t allowedCount) const;
+    SearchHits makeHits(FarthestFirst& top) const;
+    void prepareQuery(const Embedding& query, AlignedFloatVector& out) const;
+    // Returns the worker pool sized for the current thread setting; the caller keeps it
+    // alive while using it, so concurrent searches survive a resize.
+    std::shared_ptr<ThreadPool> getThreadPool(size_t threads);
+
+    static const NodeId NO_NODE = 0xffffffffu;
+
+    // Graph parameters
+    size_t M;
+    size_t maxM0;
+    size_t efConstruction;
+    size_t efSearch = 64;
+    double levelMultiplier;
+
+    // Vectors: unit-normalized rows padded to 'stride' floats, original norms kept for export.
+    size_t dimension = 0;
+    size_t stride = 0;
+    AlignedFloatVector matrix;
+    std::vector<float> norms;
+
+    // Graph: bottom layer in one flat array of (maxM0 + 1) slots per node,
+    // upper layers per node as 'level' blocks of (M + 1) slots.
+    std::vector<int> levels;
+    std::vector<uint32_t> links0;
+    std::vector<std::vector<uint32_t>> upperLinks;
+    mutable std::deque<std::mutex> nodeLocks;
+    std::mutex entryMutex;
+    NodeId entryPoint = NO_NODE;
+    int maxLevel = -1;
+    std::mt19937 levelRng;
+
+    MetadataTable entries;
+    bool diskContents = false;
+
+    std::unordered_map<int, size_t> idToRow;
+    std::vector<uint8_t> deleted;
+    size_t deletedCount = 0;
+    float compactionRatio = 0.25f;
+
+    mutable std::mutex visitedMutex;
+    mutable std::vector<std::unique_ptr<VisitedList>> visitedPool;
+
+    size_t numThreads = 0;
+    std::shared_ptr<ThreadPool> threadPool;
+    std::mutex poolMutex;
+};
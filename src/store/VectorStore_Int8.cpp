@@ -0,0 +1,651 @@
+/*
+ * ofxRAG
+ *
+ * Copyright (c) 2025 Yannick Hofmann
+ * <contact@yannickhofmann.de>
+ *
+ * BSD Simplified License.
+ * For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ * WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include "VectorStore_Int8.h"
+#include "SimdKernels.h"
+#include "BinaryIO.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// Binary store layout (native endianness):
+//   header | pad to 64 | codes (count x codeStride int8) | pad to 64 | rows (count x stride floats,
+//   unit-normalized) | scales (count floats) | norms (count floats) | pad to 8 | row records (count)
+//   | string blob (each distinct source/type once, then the contents)
+const char INT8_STORE_MAGIC[8] = {'O', 'F', 'X', 'R', 'A', 'G', 'Q', '8'};
+const uint32_t INT8_STORE_VERSION = 1;
+
+struct Int8StoreHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t count;
+    uint64_t dimension;
+    uint64_t stride;
+    uint64_t codeStride;
+    uint64_t codesOffset;
+    uint64_t matrixOffset;
+    uint64_t scalesOffset;
+    uint64_t normsOffset;
+    uint64_t recordsOffset;
+    uint64_t stringsOffset;
+    uint64_t stringsSize;
+};
+
+struct Int8RowRecord {
+    int64_t id;
+    uint64_t sourceOffset;
+    uint64_t sourceLength;
+    uint64_t typeOffset;
+    uint64_t typeLength;
+    uint64_t contentOffset;
+    uint64_t contentLength;
+};
+
+// Code rows are padded to whole cache lines, which also suits the 64-byte VNNI loop.
+size_t paddedCodeStride(size_t dimension) {
+    return (size_t)ofxragAlignUp(dimension, 64);
+}
+
+} // namespace
+
+//--------------------------------------------------------------
+VectorStore_Int8::VectorStore_Int8() {
+    ofLogNotice("VectorStore_Int8") << "Initialized int8 vector store (int8 kernel: " << ofxragInt8KernelName() << ", float kernel: " << ofxragSimdKernelName() << ").";
+}
+
+//--------------------------------------------------------------
+VectorStore_Int8::~VectorStore_Int8() {
+    ofLogNotice("VectorStore_Int8") << "Destructed.";
+}
+
+//--------------------------------------------------------------
+void VectorStore_Int8::add(const Embedding& embedding, const VectorMetadata& meta, const std::string& content) {
+    if (embedding.empty()) {
+        ofLogWarning("VectorStore_Int8") << "Attempted to add empty embedding.";
+        return;
+    }
+    if (dimension != 0 && embedding.size() != dimension) {
+        ofLogWarning("VectorStore_Int8") << "Embedding dimension mismatch. Expected " << dimension << ", got " << embedding.size();
+        return;
+    }
+    if (dimension == 0) {
+        dimension = embedding.size();
+        stride = ofxragPaddedStride(dimension);
+        codeStride = paddedCodeStride(dimension);
+    }
+    auto existing = idToRow.find(meta.id);
+    if (existing != idToRow.end()) {
+        markDeleted(existing->second);
+    }
+    appendRow(embedding.data());
+    idToRow[meta.id] = entries.append(meta, content);
+    deleted.push_back(0);
+    ofLogVerbose("VectorStore_Int8") << "Added embedding with ID: " << meta.id << ", current size: " << norms.size();
+}
+
+//--------------------------------------------------------------
+SearchHits VectorStore_Int8::searchHits(const Embedding& query, int top_k, const SearchFilter& filter) {
+    SearchHits results;
+    if (size() == 0) {
+        ofLogNotice("VectorStore_Int8") << "Store is empty, no search results.";
+        return results;
+    }
+    if (query.size() != dimension) {
+        ofLogWarning("VectorStore_Int8") << "Query embedding dimension mismatch. Expected " << dimension << ", got " << query.size();
+        return results;
+    }
+
+    // Normalized float query for rescoring, int8 codes for the first pass
+    AlignedFloatVector q(stride, 0.0f);
+    float norm = std::sqrt(ofxragDotProduct(query.data(), query.data(), dimension));
+    if (norm > 0.0f) {
+        for (size_t i = 0; i < dimension; ++i) {
+            q[i] = query[i] / norm;
+        }
+    }
+    AlignedInt8Vector qCodes(codeStride, 0);
+    float qScale = quantize(q.data(), qCodes.data());
+
+    std::vector<uint8_t> allowed;
+    size_t live = size();
+    const uint8_t* mask = nullptr;
+    if (!filter.empty()) {
+        live = entries.buildMask(filter, deleted, allowed);
+        mask = allowed.data();
+    }
+    if (live == 0) {
+        return results;
+    }
+
+    size_t k = std::min<size_t>(std::max(top_k, 0), live);
+    size_t candidates = rescoreFactor == 0 ? k : std::min(live, k * rescoreFactor);
+    TopKSelector coarse(candidates);
+    size_t count = norms.size();
+    size_t threads = ThreadPool::resolveThreadCount(numThreads);
+
+    if (threads <= 1 || count < parallelThreshold) {
+        scanCodes(qCodes.data(), 0, count, mask, coarse);
+    } else {
+        std::shared_ptr<ThreadPool> pool = getThreadPool(threads);
+        size_t rowsPerShard = shardRows();
+        size_t numShards = (count + rowsPerShard - 1) / rowsPerShard;
+        std::vector<TopKSelector> partial(pool->getMaxSlots(numShards), TopKSelector(candidates));
+        pool->parallelFor(numShards, [&](size_t shard, size_t slot) {
+            size_t begin = shard * rowsPerShard;
+            scanCodes(qCodes.data(), begin, std::min(begin + rowsPerShard, count), mask, partial[slot]);
+        });
+        for (const auto& heap : partial) {
+            coarse.merge(heap);
+        }
+    }
+
+    std::vector<ScoredRow> best;
+    if (rescoreFactor == 0) {
+        best = coarse.take();
+        for (auto& hit : best) {
+            hit.score *= qScale;
+        }
+    } else {
+        // Exact cosine for the candidates; only their float rows are touched.
+        TopKSelector exact(k);
+        for (const auto& hit : coarse.take()) {
+            exact.push(ofxragDotProduct(q.data(), rowPointers[hit.row], stride), hit.row);
+        }
+        best = exact.take();
+    }
+
+    results.hits.reserve(best.size());
+    for (const auto& hit : best) {
+        results.hits.push_back(entries.hit(hit.row, hit.score));
+    }
+    results.lease = entries.lease();
+    ofLogVerbose("VectorStore_Int8") << "Search completed, " << candidates << " candidates, found " << results.size() << " results.";
+    return results;
+}
+
+//--------------------------------------------------------------
+SearchHits VectorStore_Int8::getHits(const std::vector<int>& ids) {
+    SearchHits results;
+    for (int id : ids) {
+        auto it = idToRow.find(id);
+        if (it != idToRow.end()) {
+            results.hits.push_back(entries.hit(it->second, 0.0f));
+        }
+    }
+    results.lease = entries.lease();
+    return results;
+}
+
+//--------------------------------------------------------------
+bool VectorStore_Int8::remove(int id) {
+    auto it = idToRow.find(id);
+    if (it == idToRow.end()) {
+        return false;
+    }
+    markDeleted(it->second);
+    compactIfNeeded();
+    return true;
+}
+
+//--------------------------------------------------------------
+size_t VectorStore_Int8::removeBySource(const std::string& source) {
+    size_t removed = 0;
+    for (size_t row : entries.rowsOf(source)) {
+        if (!deleted[row]) {
+            markDeleted(row);
+            ++removed;
+        }
+    }
+    if (removed > 0) {
+        ofLogNotice("VectorStore_Int8") << "Removed " << removed << " entries of source: " << source;
+        compactIfNeeded();
+    }
+    return removed;
+}
+
+//--------------------------------------------------------------
+void VectorStore_Int8::clear() {
+    dimension = 0;
+    stride = 0;
+    codeStride = 0;
+    codeMatrix.clear();
+    codes = nullptr;
+    codesMapped = false;
+    rowPointers.clear();
+    rowBlocks.clear();
+    blockRowsUsed = 0;
+    mapping.reset();
+    scales.clear();
+    norms.clear();
+    entries.clear();
+    idToRow.clear();
+    deleted.clear();
+    deletedCount = 0;
+    ofLogNotice("VectorStore_Int8") << "Store cleared.";
+}
+
+//--------------------------------------------------------------
+bool VectorStore_Int8::save(const std::string& filepath) {
+    compact(); // only live rows are written
+    size_t count = norms.size();
+    BinaryWriter writer;
+    if (!writer.open(filepath)) {
+        ofLogError("VectorStore_Int8") << "Cannot open " << filepath << " for writing.";
+        return false;
+    }
+
+    Int8StoreHeader header = {};
+    std::memcpy(header.magic, INT8_STORE_MAGIC, sizeof(header.magic));
+    header.version = INT8_STORE_VERSION;
+    header.headerSize = sizeof(Int8StoreHeader);
+    header.count = count;
+    header.dimension = dimension;
+    header.stride = stride;
+    header.codeStride = codeStride;
+    writer.write(header);
+
+    // Codes first so the block scanned by every query is contiguous.
+    writer.pad(64);
+    header.codesOffset = writer.tell();
+    writer.writeBytes(codes, count * codeStride);
+
+    writer.pad(64);
+    header.matrixOffset = writer.tell();
+    for (size_t i = 0; i < count; ++i) {
+        writer.writeBytes(rowPointers[i], stride * sizeof(float));
+    }
+
+    header.scalesOffset = writer.tell();
+    writer.writeBytes(scales.data(), count * sizeof(float));
+    header.normsOffset = writer.tell();
+    writer.writeBytes(norms.data(), count * sizeof(float));
+
+    writer.pad(8);
+    header.recordsOffset = writer.tell();
+    std::vector<uint64_t> contentOffsets = entries.contentBlobOffsets();
+    for (size_t i = 0; i < count; ++i) {
+        Int8RowRecord record = {};
+        record.id = entries.id(i);
+        record.sourceOffset = entries.sourceBlobOffset(i);
+        record.sourceLength = entries.source(i).size();
+        record.typeOffset = entries.typeBlobOffset(i);
+        record.typeLength = entries.type(i).size();
+        record.contentOffset = contentOffsets[i];
+        record.contentLength = entries.contentLength(i);
+        writer.write(record);
+    }
+
+    header.stringsOffset = writer.tell();
+    header.stringsSize = entries.blobSize();
+    entries.writeBlob(writer);
+
+    writer.patch(0, header);
+    if (!writer.commit()) {
+        ofLogError("VectorStore_Int8") << "Failed to write store to " << filepath;
+        return false;
+    }
+    ofLogNotice("VectorStore_Int8") << "Saved " << count << " items to " << filepath;
+
+    // Serve rows from the new file, so rows added since the last load or save leave RAM
+    if (useMemoryMapping) {
+        mapSavedFile(filepath, header.codesOffset, header.matrixOffset);
+    }
+    return true;
+}
+
+//--------------------------------------------------------------
+bool VectorStore_Int8::load(const std::string& filepath) {
+    auto file = std::make_unique<MappedFile>();
+    if (!file->open(filepath, useMemoryMapping)) {
+        ofLogError("VectorStore_Int8") << "Failed to open store " << filepath;
+        return false;
+    }
+
+    const Int8StoreHeader* header = file->at<Int8StoreHeader>(0);
+    if (!header || std::memcmp(header->magic, INT8_STORE_MAGIC, sizeof(header->magic)) != 0) {
+        ofLogError("VectorStore_Int8") << filepath << " is not an int8 store.";
+        return false;
+    }
+    if (header->version != INT8_STORE_VERSION || header->headerSize != sizeof(Int8StoreHeader)) {
+        ofLogError("VectorStore_Int8") << "Unsupported store version in " << filepath;
+        return false;
+    }
+    uint64_t count = header->count;
+    const int8_t* mappedCodes = file->at<int8_t>(header->codesOffset, count * header->codeStride);
+    const float* mappedRows = file->at<float>(header->matrixOffset, count * header->stride);
+    const float* mappedScales = file->at<float>(header->scalesOffset, count);
+    const float* mappedNorms = file->at<float>(header->normsOffset, count);
+    const Int8RowRecord* records = file->at<Int8RowRecord>(header->recordsOffset, count);
+    const char* strings = file->at<char>(header->stringsOffset, header->stringsSize);
+    if ((count > 0 && (!mappedCodes || !mappedRows || !mappedScales || !mappedNorms || !records || !strings)) ||
+        header->stride != ofxragPaddedStride(header->dimension) || header->codeStride != paddedCodeStride(header->dimension)) {
+        ofLogError("VectorStore_Int8") << "Store " << filepath << " is truncated or corrupt.";
+        return false;
+    }
+
+    clear();
+
+    dimension = header->dimension;
+    stride = header->stride;
+    codeStride = header->codeStride;
+    scales.assign(mappedScales, mappedScales + count);
+    norms.assign(mappedNorms, mappedNorms + count);
+    // With disk contents only the rows are built here; contents are read from the file on demand.
+    std::shared_ptr<MappedFile> contentFile;
+    if (diskContents) {
+        contentFile = std::make_shared<MappedFile>();
+        if (!contentFile->open(filepath)) {
+            ofLogError("VectorStore_Int8") << "Failed to map contents of " << filepath;
+            clear();
+            return false;
+        }
+        entries.setContentFile(contentFile);
+    }
+    entries.reserve(count, contentFile ? 0 : header->stringsSize);
+    uint64_t blobSize = header->stringsSize;
+    auto inBlob = [blobSize](uint64_t offset, uint64_t length) {
+        return offset <= blobSize && length <= blobSize - offset;
+    };
+    for (uint64_t i = 0; i < count; ++i) {
+        const Int8RowRecord& record = records[i];
+        if (!inBlob(record.sourceOffset, record.sourceLength) || !inBlob(record.typeOffset, record.typeLength) ||
+            !inBlob(record.contentOffset, record.contentLength)) {
+            ofLogError("VectorStore_Int8") << "Store " << filepath << " has an invalid string table.";
+            clear();
+            return false;
+        }
+        std::string_view source(strings + record.sourceOffset, record.sourceLength);
+        std::string_view type(strings + record.typeOffset, record.typeLength);
+        if (contentFile) {
+            entries.appendMapped((int)record.id, source, type, header->stringsOffset + record.contentOffset, (uint32_t)record.contentLength);
+        } else {
+            entries.append((int)record.id, source, type, std::string_view(strings + record.contentOffset, record.contentLength));
+        }
+        idToRow[(int)record.id] = (size_t)i;
+    }
+    deleted.assign(count, 0);
+
+    // Codes and rows are used in place; the float rows are only paged in for rescoring.
+    mapping = std::move(file);
+    codes = mappedCodes;
+    codesMapped = true;
+    rowPointers.resize(count);
+    for (uint64_t i = 0; i < count; ++i) {
+        rowPointers[i] = mappedRows + i * stride;
+    }
+
+    ofLogNotice("VectorStore_Int8") << "Loaded " << count << " items (" << (mapping->isMapped() ? "memory-mapped" : "in memory") << ") from " << filepath;
+    return true;
+}
+
+//--------------------------------------------------------------
+void VectorStore_Int8::setMemoryMapping(bool enabled) {
+    useMemoryMapping = enabled;
+}
+
+//--------------------------------------------------------------
+size_t VectorStore_Int8::size() const {
+    return norms.size() - deletedCount;
+}
+
+//--------------------------------------------------------------
+std::vector<std::string> VectorStore_Int8::getSources() const {
+    return entries.documentSources();
+}
+
+//--------------------------------------------------------------
+std::vector<SourceStats> VectorStore_Int8::getSourceStats() const {
+    return entries.documentStats();
+}
+
+//--------------------------------------------------------------
+int VectorStore_Int8::getMaxId() const {
+    int maxId = -1;
+    for (const auto& entry : idToRow) {
+        maxId = std::max(maxId, entry.first);
+    }
+    return maxId;
+}
+
+//--------------------------------------------------------------
+void VectorStore_Int8::setRescoreFactor(size_t factor) {
+    rescoreFactor = factor;
+}
+
+//--------------------------------------------------------------
+size_t VectorStore_Int8::getRescoreFactor() const {
+    return rescoreFactor;
+}
+
+//--------------------------------------------------------------
+void VectorStore_Int8::compact() {
+    if (deletedCount == 0) {
+        return;
+    }
+    size_t live = size();
+    AlignedInt8Vector keptCodes;
+    std::vector<const float*> keptRows;
+    std::vector<float> keptScales, keptNorms;
+    keptCodes.reserve(live * codeStride);
+    keptRows.reserve(live);
+    keptScales.reserve(live);
+    keptNorms.reserve(live);
+
+    // Mapped rows stay in the file; rows added since are repacked, so removed ones free their memory
+    std::vector<AlignedFloatVector> oldBlocks;
+    oldBlocks.swap(rowBlocks);
+    blockRowsUsed = 0;
+    const uint8_t* mappedBegin = mapping ? mapping->data() : nullptr;
+    const uint8_t* mappedEnd = mapping ? mapping->data() + mapping->size() : nullptr;
+
+    for (size_t i = 0; i < norms.size(); ++i) {
+        if (deleted[i]) {
+            continue;
+        }
+        keptCodes.insert(keptCodes.end(), codes + i * codeStride, codes + (i + 1) * codeStride);
+        const float* row = rowPointers[i];
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(row);
+        if (!(bytes >= mappedBegin && bytes < mappedEnd)) {
+            float* copy = allocateRow();
+            std::memcpy(copy, row, stride * sizeof(float));
+            row = copy;
+        }
+        keptRows.push_back(row);
+        keptScales.push_back(scales[i]);
+        keptNorms.push_back(norms[i]);
+    }
+
+    codeMatrix.swap(keptCodes);
+    codes = codeMatrix.data();
+    codesMapped = false;
+    rowPointers.swap(keptRows);
+    scales.swap(keptScales);
+    norms.swap(keptNorms);
+    entries.compact(deleted);
+
+    idToRow.clear();
+    for (size_t i = 0; i < entries.size(); ++i) {
+        idToRow[entries.id(i)] = i;
+    }
+    deleted.assign(norms.size(), 0);
+    ofLogVerbose("VectorStore_Int8") << "Compacted store, dropped " << deletedCount << " removed rows.";
+    deletedCount = 0;
+}
+
+//--------------------------------------------------------------
+void VectorStore_Int8::setCompactionRatio(float ratio) {
+    compactionRatio = ratio;
+}
+
+//--------------------------------------------------------------
+void VectorStore_Int8::setNumThreads(size_t numThreads) {
+    this->numThreads = numThreads;
+    std::lock_guard<std::mutex> lock(poolMutex);
+    threadPool.reset();
+}
+
+//--------------------------------------------------------------
+size_t VectorStore_Int8::getNumThreads() const {
+    return ThreadPool::resolveThreadCount(numThreads);
+}
+
+//--------------------------------------------------------------
+void VectorStore_Int8::setDiskContents(bool enabled) {
+    diskContents = enabled;
+}
+
+//--------------------------------------------------------------
+bool VectorStore_Int8::getDiskContents() const {
+    return diskContents;
+}
+
+//--------------------------------------------------------------
+void VectorStore_Int8::setParallelThreshold(size_t minRows) {
+    parallelThreshold = minRows;
+}
+
+//--------------------------------------------------------------
+size_t VectorStore_Int8::getParallelThreshold() const {
+    return parallelThreshold;
+}
+
+//--------------------------------------------------------------
+void VectorStore_Int8::detachCodes() {
+    if (!codesMapped) {
+        return;
+    }
+    codeMatrix.assign(codes, codes + norms.size() * codeStride);
+    codes = codeMatrix.data();
+    codesMapped = false;
+}
+
+//--------------------------------------------------------------
+float* VectorStore_Int8::allocateRow() {
+    if (rowBlocks.empty() || blockRowsUsed == ROWS_PER_BLOCK) {
+        rowBlocks.emplace_back(ROWS_PER_BLOCK * stride, 0.0f);
+        blockRowsUsed = 0;
+    }
+    return rowBlocks.back().data() + (blockRowsUsed++) * stride;
+}
+
+//--------------------------------------------------------------
+bool VectorStore_Int8::mapSavedFile(const std::string& filepath, uint64_t codesOffset, uint64_t matrixOffset) {
+    size_t count = norms.size();
+    auto file = std::make_unique<MappedFile>();
+    // Without mmap the file would only be copied into memory again
+    if (count == 0 || !file->open(filepath) || !file->isMapped()) {
+        return false;
+    }
+    const int8_t* mappedCodes = file->at<int8_t>(codesOffset, count * codeStride);
+    const float* mappedRows = file->at<float>(matrixOffset, count * stride);
+    if (!mappedCodes || !mappedRows) {
+        return false;
+    }
+    codes = mappedCodes;
+    codesMapped = true;
+    AlignedInt8Vector().swap(codeMatrix);
+    for (size_t i = 0; i < count; ++i) {
+        rowPointers[i] = mappedRows + i * stride;
+    }
+    rowBlocks.clear();
+    blockRowsUsed = 0;
+    mapping = std::move(file);
+    return true;
+}
+
+//--------------------------------------------------------------
+void VectorStore_Int8::markDeleted(size_t row) {
+    if (deleted[row]) {
+        return;
+    }
+    deleted[row] = 1;
+    ++deletedCount;
+    idToRow.erase(entries.id(row));
+    entries.releaseContent(row);
+}
+
+//--------------------------------------------------------------
+void VectorStore_Int8::compactIfNeeded() {
+    if (deletedCount > 0 && deletedCount >= compactionRatio * norms.size()) {
+        compact();
+    }
+}
+
+//--------------------------------------------------------------
+void VectorStore_Int8::appendRow(const float* values) {
+    detachCodes();
+    float* row = allocateRow();
+    rowPointers.push_back(row);
+
+    float norm = std::sqrt(ofxragDotProduct(values, values, dimension));
+    norms.push_back(norm);
+    if (norm > 0.0f) {
+        float inv = 1.0f / norm;
+        for (size_t i = 0; i < dimension; ++i) {
+            row[i] = values[i] * inv;
+        }
+    }
+
+    size_t codeOffset = codeMatrix.size();
+    codeMatrix.resize(codeOffset + codeStride, 0);
+    codes = codeMatrix.data();
+    scales.push_back(quantize(row, codeMatrix.data() + codeOffset));
+}
+
+//--------------------------------------------------------------
+float VectorStore_Int8::quantize(const float* values, int8_t* out) const {
+    // Symmetric, per row: the largest component maps to +-127, so the codes never
+    // hit -128 (required by the int8 kernels). value ~= code * scale.
+    float maxAbs = 0.0f;
+    for (size_t i = 0; i < dimension; ++i) {
+        maxAbs = std::max(maxAbs, std::fabs(values[i]));
+    }
+    std::fill(out, out + codeStride, (int8_t)0);
+    if (maxAbs == 0.0f) {
+        return 0.0f;
+    }
+    float inv = 127.0f / maxAbs;
+    for (size_t i = 0; i < dimension; ++i) {
+        long code = std::lround(values[i] * inv);
+        out[i] = (int8_t)std::max(-127L, std::min(127L, code));
+    }
+    return maxAbs / 127.0f;
+}
+
+//--------------------------------------------------------------
+void VectorStore_Int8::scanCodes(const int8_t* query, size_t begin, size_t end, const uint8_t* allowed, TopKSelector& selector) const {
+    // The query scale is the same for every row, so it is left out of the ranking score.
+    const int8_t* row = codes + begin * codeStride;
+    for (size_t i = begin; i < end; ++i, row += codeStride) {
+        if (allowed ? !allowed[i] : (deletedCount > 0 && deleted[i])) {
+            continue;
+        }
+        selector.push((float)ofxragDotProductInt8(query, row, codeStride) * scales[i], (int64_t)i);
+    }
+}
+
+//--------------------------------------------------------------
+size_t VectorStore_Int8::shardRows() const {
+    const size_t shardBytes = 256 * 1024;
+    return std::max<size_t>(64, shardBytes / codeStride);
+}
+
+//--------------------------------------------------------------
+std::shared_ptr<ThreadPool> VectorStore_Int8::getThreadPool(size_t threads) {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    if (!threadPool || threadPool->getNumThreads() != threads - 1) {
+        threadPool = std::make_shared<ThreadPool>(threads - 1);
+    }
+    return threadPool;
+}
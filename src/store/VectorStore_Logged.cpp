@@ -0,0 +1,191 @@
+/*
+ * ofxRAG
+ *
+ * Copyright (c) 2025 Yannick Hofmann
+ * <contact@yannickhofmann.de>
+ *
+ * BSD Simplified License.
+ * For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ * WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include "VectorStore_Logged.h"
+
+#include "ofMain.h"
+
+//--------------------------------------------------------------
+VectorStore_Logged::VectorStore_Logged(std::shared_ptr<VectorStoreBase> store) : store(store) {}
+
+//--------------------------------------------------------------
+void VectorStore_Logged::add(const Embedding& embedding, const VectorMetadata& metadata, const std::string& content) {
+    addBatch({embedding}, {metadata}, {content});
+}
+
+//--------------------------------------------------------------
+void VectorStore_Logged::addBatch(const std::vector<Embedding>& embeddings, const std::vector<VectorMetadata>& metadata, const std::vector<std::string>& contents) {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    // Logged first, so while the log is written a change is on disk before it is visible.
+    if (log.isOpen() && !log.appendAdd(embeddings, metadata, contents)) {
+        stopLogging();
+    }
+    store->addBatch(embeddings, metadata, contents);
+    checkpointIfNeeded();
+}
+
+//--------------------------------------------------------------
+SearchHits VectorStore_Logged::searchHits(const Embedding& query, int top_k, const SearchFilter& filter) {
+    return store->searchHits(query, top_k, filter);
+}
+
+//--------------------------------------------------------------
+std::vector<SearchHits> VectorStore_Logged::searchHitsBatch(const std::vector<Embedding>& queries, int top_k, const SearchFilter& filter) {
+    return store->searchHitsBatch(queries, top_k, filter);
+}
+
+//--------------------------------------------------------------
+SearchHits VectorStore_Logged::getHits(const std::vector<int>& ids) {
+    return store->getHits(ids);
+}
+
+//--------------------------------------------------------------
+bool VectorStore_Logged::remove(int id) {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    if (log.isOpen() && !log.appendRemove(id)) {
+        stopLogging();
+    }
+    bool removed = store->remove(id);
+    checkpointIfNeeded();
+    return removed;
+}
+
+//--------------------------------------------------------------
+size_t VectorStore_Logged::removeBySource(const std::string& source) {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    if (log.isOpen() && !log.appendRemoveSource(source)) {
+        stopLogging();
+    }
+    size_t removed = store->removeBySource(source);
+    checkpointIfNeeded();
+    return removed;
+}
+
+//--------------------------------------------------------------
+void VectorStore_Logged::clear() {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    if (log.isOpen() && !log.appendClear()) {
+        stopLogging();
+    }
+    store->clear();
+}
+
+//--------------------------------------------------------------
+bool VectorStore_Logged::save(const std::string& filepath) {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    return saveLocked(filepath);
+}
+
+//--------------------------------------------------------------
+bool VectorStore_Logged::saveLocked(const std::string& filepath) {
+    if (!store->save(filepath)) {
+        return false;
+    }
+    // A crash before the reset leaves the old log next to the new snapshot; replaying
+    // it again is harmless because adds replace existing ids.
+    if (filepath == snapshotPath && log.isOpen()) {
+        return log.reset();
+    }
+    snapshotPath = filepath;
+    std::string logPath = filepath + ".wal";
+    ofFile::removeFile(logPath, false);
+    return log.open(logPath);
+}
+
+//--------------------------------------------------------------
+bool VectorStore_Logged::load(const std::string& filepath) {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    log.close();
+
+    std::string logPath = filepath + ".wal";
+    bool hasSnapshot = ofFile::doesFileExist(filepath, false);
+    if (hasSnapshot) {
+        if (!store->load(filepath)) {
+            return false;
+        }
+    } else if (ofFile::doesFileExist(logPath, false)) {
+        store->clear();
+    } else {
+        ofLogNotice("VectorStore_Logged") << "No snapshot or log at: " << filepath;
+        return false;
+    }
+
+    StoreLog::replay(logPath, *store);
+    snapshotPath = filepath;
+    return log.open(logPath);
+}
+
+//--------------------------------------------------------------
+size_t VectorStore_Logged::size() const {
+    return store->size();
+}
+
+//--------------------------------------------------------------
+std::vector<std::string> VectorStore_Logged::getSources() const {
+    return store->getSources();
+}
+
+//--------------------------------------------------------------
+std::vector<SourceStats> VectorStore_Logged::getSourceStats() const {
+    return store->getSourceStats();
+}
+
+//--------------------------------------------------------------
+int VectorStore_Logged::getMaxId() const {
+    return store->getMaxId();
+}
+
+//--------------------------------------------------------------
+bool VectorStore_Logged::higherIsCloser() const {
+    return store->higherIsCloser();
+}
+
+//--------------------------------------------------------------
+bool VectorStore_Logged::checkpoint() {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    if (snapshotPath.empty()) {
+        ofLogWarning("VectorStore_Logged") << "No snapshot path yet; call save() or load() first.";
+        return false;
+    }
+    return saveLocked(snapshotPath);
+}
+
+//--------------------------------------------------------------
+bool VectorStore_Logged::isDurable() const {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    return log.isOpen();
+}
+
+//--------------------------------------------------------------
+void VectorStore_Logged::stopLogging() {
+    // Records after a missing one would replay onto the wrong state, so the log ends
+    // here; replaying it restores the store as it was before this change.
+    ofLogError("VectorStore_Logged") << "Failed to append to the log of " << snapshotPath << ", changes are kept in memory only until the next save().";
+    log.close();
+}
+
+//--------------------------------------------------------------
+void VectorStore_Logged::checkpointIfNeeded() {
+    if (checkpointSize > 0 && log.isOpen() && log.size() >= checkpointSize) {
+        ofLogNotice("VectorStore_Logged") << "Log reached " << log.size() << " bytes, writing a checkpoint to: " << snapshotPath;
+        saveLocked(snapshotPath);
+    }
+}
+
+//--------------------------------------------------------------
+void VectorStore_Logged::setCheckpointSize(uint64_t bytes) {
+    checkpointSize = bytes;
+}
+
+//--------------------------------------------------------------
+uint64_t VectorStore_Logged::getCheckpointSize() const {
+    return checkpointSize;
+}
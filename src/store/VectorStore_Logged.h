@@ -0,0 +1,81 @@
+/*
+ * ofxRAG
+ *
+ * Copyright (c) 2025 Yannick Hofmann
+ * <contact@yannickhofmann.de>
+ *
+ * BSD Simplified License.
+ * For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ * WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#include "VectorStoreBase.h"
+#include "StoreLog.h"
+
+#include <memory>
+#include <mutex>
+
+// Wraps any store and persists it incrementally: every add and remove is appended
+// to a write-ahead log next to the snapshot ('<path>.wal'), so keeping the store on
+// disk costs time proportional to the change instead of the whole corpus.
+//
+// load(path) loads the snapshot, if there is one, replays the log on top of it and
+// keeps logging to it. save(path) writes a new snapshot (a checkpoint) and empties
+// the log. A checkpoint also happens on its own once the log outgrows the
+// checkpoint size. Records are flushed to the OS as they are written, so a crashed
+// application loses nothing; a torn last record is dropped on the next load.
+// If a record cannot be written (e.g. the disk is full), the change is still applied
+// but logging stops and isDurable() turns false until the next successful save().
+//
+// To combine with VectorStore_Concurrent, wrap the concurrent store in this one,
+// so that each change is logged once.
+class VectorStore_Logged : public VectorStoreBase {
+public:
+    explicit VectorStore_Logged(std::shared_ptr<VectorStoreBase> store);
+
+    void add(const Embedding& embedding, const VectorMetadata& metadata, const std::string& content) override;
+    void addBatch(const std::vector<Embedding>& embeddings, const std::vector<VectorMetadata>& metadata, const std::vector<std::string>& contents) override;
+    SearchHits searchHits(const Embedding& query, int top_k, const SearchFilter& filter = SearchFilter()) override;
+    std::vector<SearchHits> searchHitsBatch(const std::vector<Embedding>& queries, int top_k, const SearchFilter& filter = SearchFilter()) override;
+    SearchHits getHits(const std::vector<int>& ids) override;
+    bool remove(int id) override;
+    size_t removeBySource(const std::string& source) override;
+    void clear() override;
+
+    // Writes a snapshot to 'filepath' and starts an empty log for it.
+    bool save(const std::string& filepath) override;
+    // Loads the snapshot at 'filepath' (a missing one counts as empty), replays its log
+    // and logs further changes there.
+    bool load(const std::string& filepath) override;
+
+    size_t size() const override;
+    std::vector<std::string> getSources() const override;
+    std::vector<SourceStats> getSourceStats() const override;
+    int getMaxId() const override;
+    bool higherIsCloser() const override;
+
+    // Writes a snapshot to the current path and empties the log.
+    bool checkpoint();
+    // Log size in bytes that triggers a checkpoint (default 64 MiB, 0 = only on save()).
+    void setCheckpointSize(uint64_t bytes);
+    uint64_t getCheckpointSize() const;
+
+    // True while every change since the last save() or load() is in the log.
+    bool isDurable() const;
+
+    std::shared_ptr<VectorStoreBase> getStore() const { return store; }
+
+private:
+    bool saveLocked(const std::string& filepath);
+    void checkpointIfNeeded();
+    // Closes the log after a failed append; expects 'writeMutex' to be held.
+    void stopLogging();
+
+    std::shared_ptr<VectorStoreBase> store;
+    StoreLog log;
+    std::string snapshotPath;
+    uint64_t checkpointSize = 64ull << 20;
+    mutable std::mutex writeMutex; // serializes changes with their log records
+};
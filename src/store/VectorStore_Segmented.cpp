@@ -0,0 +1,416 @@
+/*
+ * ofxRAG
+ *
+ * Copyright (c) 2025 Yannick Hofmann
+ * <contact@yannickhofmann.de>
+ *
+ * BSD Simplified License.
+ * For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ * WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include "VectorStore_Segmented.h"
+#include "BinaryIO.h"
+
+#include <unordered_map>
+
+namespace {
+const int SEGMENTED_MANIFEST_VERSION = 1;
+} // namespace
+
+//--------------------------------------------------------------
+VectorStore_Segmented::VectorStore_Segmented(const Factory& factory, size_t segmentSize)
+    : factory(factory), segmentSize(std::max<size_t>(segmentSize, 1)) {
+    startTail();
+}
+
+//--------------------------------------------------------------
+void VectorStore_Segmented::startTail() {
+    segments.push_back({factory(), nextSegment++, true});
+}
+
+//--------------------------------------------------------------
+void VectorStore_Segmented::add(const Embedding& embedding, const VectorMetadata& metadata, const std::string& content) {
+    if (tail().store->size() >= segmentSize) {
+        startTail();
+    }
+    tail().store->add(embedding, metadata, content);
+    tail().dirty = true;
+}
+
+//--------------------------------------------------------------
+void VectorStore_Segmented::addBatch(const std::vector<Embedding>& embeddings, const std::vector<VectorMetadata>& metadata, const std::vector<std::string>& contents) {
+    size_t count = std::min(embeddings.size(), std::min(metadata.size(), contents.size()));
+    size_t begin = 0;
+    while (begin < count) {
+        size_t filled = tail().store->size();
+        if (filled >= segmentSize) {
+            startTail();
+            continue;
+        }
+        size_t end = std::min(count, begin + (segmentSize - filled));
+        if (begin == 0 && end == count) {
+            tail().store->addBatch(embeddings, metadata, contents);
+        } else {
+            // The batch crosses a seal: hand each segment its slice.
+            tail().store->addBatch(std::vector<Embedding>(embeddings.begin() + begin, embeddings.begin() + end),
+                                   std::vector<VectorMetadata>(metadata.begin() + begin, metadata.begin() + end),
+                                   std::vector<std::string>(contents.begin() + begin, contents.begin() + end));
+        }
+        tail().dirty = true;
+        begin = end;
+    }
+}
+
+//--------------------------------------------------------------
+SearchHits VectorStore_Segmented::searchHits(const Embedding& query, int top_k, const SearchFilter& filter) {
+    std::vector<SearchHits> perSegment(segments.size());
+    forEachSegment([&](size_t i) {
+        perSegment[i] = segments[i].store->searchHits(query, top_k, filter);
+    });
+    return mergeHits(perSegment, top_k);
+}
+
+//--------------------------------------------------------------
+std::vector<SearchHits> VectorStore_Segmented::searchHitsBatch(const std::vector<Embedding>& queries, int top_k, const SearchFilter& filter) {
+    // perSegment[segment][query]
+    std::vector<std::vector<SearchHits>> perSegment(segments.size());
+    forEachSegment([&](size_t i) {
+        perSegment[i] = segments[i].store->searchHitsBatch(queries, top_k, filter);
+    });
+
+    std::vector<SearchHits> results(queries.size());
+    std::vector<SearchHits> column(segments.size());
+    for (size_t q = 0; q < queries.size(); ++q) {
+        for (size_t i = 0; i < segments.size(); ++i) {
+            column[i] = q < perSegment[i].size() ? std::move(perSegment[i][q]) : SearchHits();
+        }
+        results[q] = mergeHits(column, top_k);
+    }
+    return results;
+}
+
+//--------------------------------------------------------------
+SearchHits VectorStore_Segmented::getHits(const std::vector<int>& ids) {
+    std::vector<SearchHits> perSegment(segments.size());
+    for (size_t i = 0; i < segments.size(); ++i) {
+        perSegment[i] = segments[i].store->getHits(ids);
+    }
+    return mergeHits(perSegment, (int)ids.size());
+}
+
+//--------------------------------------------------------------
+void VectorStore_Segmented::forEachSegment(const std::function<void(size_t)>& fn) {
+    size_t threads = ThreadPool::resolveThreadCount(numThreads);
+    if (segments.size() == 1 || threads <= 1) {
+        for (size_t i = 0; i < segments.size(); ++i) {
+            fn(i);
+        }
+        return;
+    }
+    std::shared_ptr<ThreadPool> pool = getThreadPool(threads);
+    pool->parallelFor(segments.size(), [&](size_t i, size_t) {
+        fn(i);
+    });
+}
+
+//--------------------------------------------------------------
+SearchHits VectorStore_Segmented::mergeHits(std::vector<SearchHits>& perSegment, int top_k) const {
+    SearchHits merged;
+    if (perSegment.size() == 1) {
+        merged = std::move(perSegment[0]);
+        return merged;
+    }
+
+    // The merged hits view strings of several segments, so the lease holds all of theirs.
+    auto leases = std::make_shared<std::vector<std::shared_ptr<const void>>>();
+    for (auto& hits : perSegment) {
+        merged.hits.insert(merged.hits.end(), hits.hits.begin(), hits.hits.end());
+        if (hits.lease) {
+            leases->push_back(std::move(hits.lease));
+        }
+    }
+    merged.lease = leases;
+
+    size_t k = std::min<size_t>(std::max(top_k, 0), merged.hits.size());
+    bool higher = higherIsCloser();
+    std::partial_sort(merged.hits.begin(), merged.hits.begin() + k, merged.hits.end(), [higher](const SearchHit& a, const SearchHit& b) {
+        return higher ? a.distance > b.distance : a.distance < b.distance;
+    });
+    merged.hits.resize(k);
+    return merged;
+}
+
+//--------------------------------------------------------------
+bool VectorStore_Segmented::remove(int id) {
+    for (auto& segment : segments) {
+        if (segment.store->remove(id)) {
+            segment.dirty = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+//--------------------------------------------------------------
+size_t VectorStore_Segmented::removeBySource(const std::string& source) {
+    size_t removed = 0;
+    for (auto& segment : segments) {
+        size_t count = segment.store->removeBySource(source);
+        if (count > 0) {
+            segment.dirty = true;
+            removed += count;
+        }
+    }
+    return removed;
+}
+
+//--------------------------------------------------------------
+void VectorStore_Segmented::clear() {
+    segments.clear();
+    startTail();
+}
+
+//--------------------------------------------------------------
+std::string VectorStore_Segmented::segmentFile(const std::string& filepath, uint64_t number) const {
+    // 'store.faiss' -> 'store.seg3.faiss': the segment keeps the extension its store type
+    // looks at, and stores that add sidecar files next to it do not collide.
+    std::string name = ofFilePath::removeExt(ofFilePath::getFileName(filepath)) + ".seg" + ofToString(number);
+    std::string ext = ofFilePath::getFileExt(filepath);
+    return ext.empty() ? name : name + "." + ext;
+}
+
+//--------------------------------------------------------------
+bool VectorStore_Segmented::save(const std::string& filepath) {
+    std::string directory = ofFilePath::getEnclosingDirectory(filepath, false);
+    if (filepath != savedPath) {
+        for (auto& segment : segments) {
+            segment.dirty = true;
+        }
+    }
+
+    // Sealed segments whose entries were all removed are dropped.
+    segments.erase(std::remove_if(segments.begin(), segments.end() - 1, [](const Segment& segment) {
+        return segment.store->size() == 0;
+    }), segments.end() - 1);
+
+    ofJson manifest;
+    manifest["version"] = SEGMENTED_MANIFEST_VERSION;
+    manifest["segments"] = ofJson::array();
+    std::set<std::string> files;
+    std::vector<std::string> written;
+    bool ok = true;
+    for (auto& segment : segments) {
+        if (segment.dirty) {
+            // Changed segments go to files that do not exist yet, so the ones the current
+            // manifest lists stay intact until the new manifest replaces it.
+            while (ofFile::doesFileExist(directory + segmentFile(filepath, segment.number), false)) {
+                segment.number = nextSegment++;
+            }
+            std::string file = segmentFile(filepath, segment.number);
+            if (!segment.store->save(directory + file)) {
+                ofLogError("VectorStore_Segmented") << "Failed to save segment " << file;
+                ok = false;
+                break;
+            }
+            written.push_back(file);
+        }
+        std::string file = segmentFile(filepath, segment.number);
+        manifest["segments"].push_back(file);
+        files.insert(file);
+    }
+
+    // The manifest is replaced last, so a crash leaves the previous one and its files valid.
+    if (ok) {
+        std::string text = manifest.dump(2);
+        BinaryWriter writer;
+        ok = writer.open(filepath);
+        if (ok) {
+            writer.writeBytes(text.data(), text.size());
+            ok = writer.commit();
+        }
+        if (!ok) {
+            ofLogError("VectorStore_Segmented") << "Failed to write manifest " << filepath;
+        }
+    }
+    if (!ok) {
+        // Segments stay dirty and are written to fresh files on the next save.
+        for (const auto& file : written) {
+            ofFile::removeFile(directory + file, false);
+        }
+        return false;
+    }
+    for (auto& segment : segments) {
+        segment.dirty = false;
+    }
+
+    if (filepath == savedPath) {
+        for (const auto& file : savedFiles) {
+            if (!files.count(file)) {
+                ofFile::removeFile(directory + file, false);
+            }
+        }
+    }
+    savedPath = filepath;
+    savedFiles = files;
+    ofLogNotice("VectorStore_Segmented") << "Saved " << segments.size() << " segments (" << written.size() << " written) to " << filepath;
+    return true;
+}
+
+//--------------------------------------------------------------
+bool VectorStore_Segmented::readManifest(const std::string& filepath, std::vector<ManifestEntry>& entries) const {
+    ofJson manifest = ofLoadJson(filepath);
+    if (!manifest.is_object() || !manifest["version"].is_number_integer() || manifest["version"].get<int>() != SEGMENTED_MANIFEST_VERSION
+        || !manifest["segments"].is_array()) {
+        ofLogError("VectorStore_Segmented") << filepath << " is not a segmented store manifest.";
+        return false;
+    }
+
+    // Entries are file names next to the manifest, as segmentFile() builds them: '<stem>.seg<N>[.<ext>]'
+    std::string ext = ofFilePath::getFileExt(filepath);
+    std::string suffix = ext.empty() ? "" : "." + ext;
+    std::set<std::string> seen;
+    entries.clear();
+    for (const auto& entry : manifest["segments"]) {
+        std::string file = entry.is_string() ? entry.get<std::string>() : "";
+        std::string digits;
+        if (file.size() > suffix.size() && file.compare(file.size() - suffix.size(), suffix.size(), suffix) == 0) {
+            std::string stem = file.substr(0, file.size() - suffix.size());
+            size_t pos = stem.rfind(".seg");
+            digits = pos == std::string::npos ? "" : stem.substr(pos + 4);
+        }
+        if (digits.empty() || digits.size() > 19 || digits.find_first_not_of("0123456789") != std::string::npos
+            || file.find_first_of("/\\") != std::string::npos || !seen.insert(file).second) {
+            ofLogError("VectorStore_Segmented") << filepath << " lists an invalid segment: " << entry.dump();
+            return false;
+        }
+        entries.push_back({file, std::stoull(digits)});
+    }
+    return true;
+}
+
+//--------------------------------------------------------------
+bool VectorStore_Segmented::load(const std::string& filepath) {
+    std::vector<ManifestEntry> entries;
+    if (!readManifest(filepath, entries)) {
+        return false;
+    }
+
+    std::string directory = ofFilePath::getEnclosingDirectory(filepath, false);
+    std::vector<Segment> loaded;
+    std::set<std::string> files;
+    uint64_t next = 0;
+    for (const auto& entry : entries) {
+        std::shared_ptr<VectorStoreBase> store = factory();
+        if (!store->load(directory + entry.file)) {
+            ofLogError("VectorStore_Segmented") << "Failed to load segment " << entry.file;
+            return false;
+        }
+        loaded.push_back({store, entry.number, false});
+        files.insert(entry.file);
+        next = std::max(next, entry.number + 1);
+    }
+
+    segments = std::move(loaded);
+    nextSegment = next;
+    if (segments.empty()) {
+        startTail();
+    }
+    savedPath = filepath;
+    savedFiles = files;
+    ofLogNotice("VectorStore_Segmented") << "Loaded " << segments.size() << " segments, " << size() << " items from " << filepath;
+    return true;
+}
+
+//--------------------------------------------------------------
+size_t VectorStore_Segmented::size() const {
+    size_t total = 0;
+    for (const auto& segment : segments) {
+        total += segment.store->size();
+    }
+    return total;
+}
+
+//--------------------------------------------------------------
+std::vector<std::string> VectorStore_Segmented::getSources() const {
+    std::vector<std::string> sources;
+    std::set<std::string> unique_sources;
+    for (const auto& segment : segments) {
+        for (auto& source : segment.store->getSources()) {
+            if (unique_sources.insert(source).second) {
+                sources.push_back(source);
+            }
+        }
+    }
+    return sources;
+}
+
+//--------------------------------------------------------------
+std::vector<SourceStats> VectorStore_Segmented::getSourceStats() const {
+    // A document's chunks may be spread over several segments.
+    std::vector<SourceStats> stats;
+    std::unordered_map<std::string, size_t> index;
+    for (const auto& segment : segments) {
+        for (auto& entry : segment.store->getSourceStats()) {
+            auto it = index.find(entry.source);
+            if (it == index.end()) {
+                index.emplace(entry.source, stats.size());
+                stats.push_back(std::move(entry));
+            } else {
+                stats[it->second].chunks += entry.chunks;
+                stats[it->second].bytes += entry.bytes;
+            }
+        }
+    }
+    return stats;
+}
+
+//--------------------------------------------------------------
+int VectorStore_Segmented::getMaxId() const {
+    int maxId = -1;
+    for (const auto& segment : segments) {
+        maxId = std::max(maxId, segment.store->getMaxId());
+    }
+    return maxId;
+}
+
+//--------------------------------------------------------------
+bool VectorStore_Segmented::higherIsCloser() const {
+    return segments.front().store->higherIsCloser();
+}
+
+//--------------------------------------------------------------
+void VectorStore_Segmented::setSegmentSize(size_t entries) {
+    segmentSize = std::max<size_t>(entries, 1);
+}
+
+//--------------------------------------------------------------
+size_t VectorStore_Segmented::getSegmentSize() const {
+    return segmentSize;
+}
+
+//--------------------------------------------------------------
+size_t VectorStore_Segmented::getSegmentCount() const {
+    return segments.size();
+}
+
+//--------------------------------------------------------------
+void VectorStore_Segmented::setNumThreads(size_t numThreads) {
+    this->numThreads = numThreads;
+    std::lock_guard<std::mutex> lock(poolMutex);
+    threadPool.reset();
+}
+
+//--------------------------------------------------------------
+size_t VectorStore_Segmented::getNumThreads() const {
+    return numThreads;
+}
+
+//--------------------------------------------------------------
+std::shared_ptr<ThreadPool> VectorStore_Segmented::getThreadPool(size_t threads) {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    if (!threadPool || threadPool->getNumThreads() != threads - 1) {
+        threadPool = std::make_shared<ThreadPool>(threads - 1);
+    }
+    return threadPool;
+}
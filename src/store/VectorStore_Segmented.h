@@ -0,0 +1,102 @@
+/*
+ * ofxRAG
+ *
+ * Copyright (c) 2025 Yannick Hofmann
+ * <contact@yannickhofmann.de>
+ *
+ * BSD Simplified License.
+ * For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ * WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#include "VectorStoreBase.h"
+#include "ThreadPool.h"
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+
+// A store made of several smaller stores (segments), for corpora that keep growing.
+// New entries go into the last segment, the tail. Once the tail holds
+// 'segmentSize' entries it is sealed and a new tail is started; sealed segments
+// only ever lose entries. Searches run on all segments in parallel and merge their
+// hits into one global top-k.
+//
+// save(path) writes a small manifest to 'path' and each segment to its own file next
+// to it ('store.bin' -> 'store.seg<N>.bin'). Only segments changed since the last
+// save are written again, so saving a large store mostly costs the tail.
+//
+// Segments come from a factory, so any store type works. Segment stores should use
+// one thread each (setNumThreads(1)); the parallelism is across segments.
+class VectorStore_Segmented : public VectorStoreBase {
+public:
+    using Factory = std::function<std::shared_ptr<VectorStoreBase>()>;
+
+    explicit VectorStore_Segmented(const Factory& factory, size_t segmentSize = 100000);
+
+    void add(const Embedding& embedding, const VectorMetadata& metadata, const std::string& content) override;
+    void addBatch(const std::vector<Embedding>& embeddings, const std::vector<VectorMetadata>& metadata, const std::vector<std::string>& contents) override;
+    SearchHits searchHits(const Embedding& query, int top_k, const SearchFilter& filter = SearchFilter()) override;
+    std::vector<SearchHits> searchHitsBatch(const std::vector<Embedding>& queries, int top_k, const SearchFilter& filter = SearchFilter()) override;
+    SearchHits getHits(const std::vector<int>& ids) override;
+    bool remove(int id) override;
+    size_t removeBySource(const std::string& source) override;
+    void clear() override;
+
+    // Writes the changed segments to new files, then replaces the manifest. Segment
+    // files no longer listed in the manifest are deleted afterwards.
+    bool save(const std::string& filepath) override;
+    bool load(const std::string& filepath) override;
+
+    size_t size() const override;
+    std::vector<std::string> getSources() const override;
+    std::vector<SourceStats> getSourceStats() const override;
+    int getMaxId() const override;
+    bool higherIsCloser() const override;
+
+    // Entries per segment before the tail is sealed. Applies to the next seal.
+    void setSegmentSize(size_t entries);
+    size_t getSegmentSize() const;
+    size_t getSegmentCount() const;
+
+    // Threads used to search segments in parallel (0 = all hardware threads).
+    void setNumThreads(size_t numThreads);
+    size_t getNumThreads() const;
+
+private:
+    struct Segment {
+        std::shared_ptr<VectorStoreBase> store;
+        uint64_t number; // file suffix, never reused
+        bool dirty;      // changed since it was last written to 'savedPath'
+    };
+    Segment& tail() { return segments.back(); }
+    void startTail();
+    // Runs fn(segment index) for every segment, in parallel when there are several.
+    void forEachSegment(const std::function<void(size_t)>& fn);
+    // Merges per-segment hits into the best top_k overall.
+    SearchHits mergeHits(std::vector<SearchHits>& perSegment, int top_k) const;
+    std::string segmentFile(const std::string& filepath, uint64_t number) const;
+    struct ManifestEntry {
+        std::string file;
+        uint64_t number;
+    };
+    // Reads the segment files listed in the manifest at 'filepath'. Returns false,
+    // with an error logged, if it is not a manifest or lists an invalid entry.
+    bool readManifest(const std::string& filepath, std::vector<ManifestEntry>& entries) const;
+    std::shared_ptr<ThreadPool> getThreadPool(size_t threads);
+
+    Factory factory;
+    size_t segmentSize;
+    std::vector<Segment> segments; // sealed segments first, the tail last
+    uint64_t nextSegment = 0;
+
+    std::string savedPath;            // manifest the clean segments were written for
+    std::set<std::string> savedFiles; // segment files listed in that manifest
+
+    size_t numThreads = 0;
+    std::shared_ptr<ThreadPool> threadPool;
+    std::mutex poolMutex;
+};
@@ -11,6 +11,7 @@
 
 #include "ofxRAG_UI.h"
 #include "embeddings/TextEmbedding_T5.h" // Include T5 header
+#include "embeddings/TextEmbedding_Cached.h"
 
 #include "store/VectorStore_Cosine.h" // For default setup
 
@@ -50,6 +51,15 @@ void ofxRAG_UI::draw() {
 void ofxRAG_UI::onTextModelChanged(std::string& modelName) {
     ofLogNotice("ofxRAG_UI") << "Text model selection changed to: " << modelName;
     if (modelName == "T5") {
+        // Loading the model takes a while; keep the embedder that is already there,
+        // also when it sits behind a cache
+        std::shared_ptr<TextEmbeddingBase> current = rag->getTextEmbedder();
+        if (auto cached = std::dynamic_pointer_cast<TextEmbedding_Cached>(current)) {
+            current = cached->getEmbedder();
+        }
+        if (std::dynamic_pointer_cast<TextEmbedding_T5>(current)) {
+            return;
+        }
         rag->setTextEmbedder(std::make_shared<TextEmbedding_T5>());
     } else {
         // Handle other text models here later, or clear if none selected